@@ -0,0 +1,289 @@
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+
+#include "robot.h"
+
+/**
+ * Microbenchmarks of the Robot kernels & (de)serializers. Each kernel runs over a batch of robots per repetition,
+ * after warmup repetitions, and reports the median (& minimum) ns per call over the repetitions. Results can be saved
+ * as a baseline & later compared against it
+ *
+ */
+
+static const int32_t WORLD_SIZE = 1000;
+static const int32_t ROBOT_RANGE = 100;
+static const int32_t FOV = 270;
+static const uint32_t NUM_BLOCKS = 10;
+
+static const int32_t DEFAULT_BATCH_SIZE = 4096;
+static const int32_t DEFAULT_WARMUP_REPETITIONS = 20;
+static const int32_t DEFAULT_REPETITIONS = 200;
+static const int32_t DEFAULT_RANGE_HIT_PERCENT = 25;
+static const int32_t DEFAULT_FOV_HIT_PERCENT = 50;
+
+//Observer position & heading for update_sensors (facing along x)
+static const int32_t OBSERVER_X = WORLD_SIZE / 2;
+static const int32_t OBSERVER_Y = WORLD_SIZE / 2;
+
+struct Result {
+	std::string name;
+	double median_ns;
+	double min_ns;
+};
+
+static int32_t batch_size = DEFAULT_BATCH_SIZE;
+static int32_t warmup_repetitions = DEFAULT_WARMUP_REPETITIONS;
+static int32_t repetitions = DEFAULT_REPETITIONS;
+
+//Keeps results of the measured calls alive
+static volatile uint32_t sink;
+
+static uint64_t get_monotonic_nanoseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//Runs the batch function (which returns the number of calls made) for the warmup & measured repetitions. The setup
+//function runs before each repetition & is not measured
+template<typename Setup, typename Batch>
+static Result measure(const std::string &name, Setup setup, Batch batch) {
+	std::vector<double> ns_per_call;
+	for (int32_t i = 0; i < warmup_repetitions + repetitions; i++) {
+		setup();
+		uint64_t start_ns = get_monotonic_nanoseconds();
+		uint32_t num_calls = batch();
+		uint64_t elapsed_ns = get_monotonic_nanoseconds() - start_ns;
+		if (i >= warmup_repetitions) {
+			ns_per_call.push_back((double) elapsed_ns / num_calls);
+		}
+	}
+	std::sort(ns_per_call.begin(), ns_per_call.end());
+	Result result = { name, ns_per_call.at(ns_per_call.size() / 2), ns_per_call.front() };
+	return result;
+}
+
+static void no_setup() {
+}
+
+//Creates observer/target pairs for update_sensors with the given percentages of targets passing the range checks and,
+//of those, falling within the field of view. Range misses alternate between failing the axis & the distance checks
+static void create_sensor_pairs(int32_t range_hit_percent, int32_t fov_hit_percent, std::vector<Robot> &observers,
+		std::vector<Robot> &targets) {
+	srand48(1);
+	observers.clear();
+	targets.clear();
+	for (int32_t i = 0; i < batch_size; i++) {
+		observers.push_back(Robot(2 * i + 1, OBSERVER_X, OBSERVER_Y, 0));
+
+		int32_t dx, dy;
+		if (drand48() * 100 >= range_hit_percent) {
+			if (i % 2 == 0) {
+				dx = ROBOT_RANGE + 1 + drand48() * ROBOT_RANGE;
+				dy = 0;
+			} else {
+				dx = ROBOT_RANGE * 0.8;
+				dy = ROBOT_RANGE * 0.8;
+			}
+		} else {
+			//Ahead (within the field of view) or behind
+			double distance = 1 + drand48() * (ROBOT_RANGE - 1);
+			double angle = (drand48() - 0.5) * (M_PI / 2);
+			if (drand48() * 100 >= fov_hit_percent) {
+				angle += M_PI;
+			}
+			dx = distance * cos(angle);
+			dy = distance * sin(angle);
+		}
+		targets.push_back(Robot(2 * i + 2, OBSERVER_X + dx, OBSERVER_Y + dy, 0));
+	}
+}
+
+static Result measure_update_sensors(const std::string &name, int32_t range_hit_percent, int32_t fov_hit_percent) {
+	std::vector<Robot> pristine_observers, observers, targets;
+	create_sensor_pairs(range_hit_percent, fov_hit_percent, pristine_observers, targets);
+
+	//Fresh sensors for every repetition, so that the hit rates hold
+	return measure(name, [&]() {
+		observers = pristine_observers;
+	}, [&]() {
+		for (int32_t i = 0; i < batch_size; i++) {
+			observers[i].update_sensors(targets[i]);
+		}
+		return (uint32_t) batch_size;
+	});
+}
+
+static void print_usage(char **argv) {
+	printf("Usage: %s [OPTION]\n", argv[0]);
+	printf("  -n batch_size    Calls per repetition [Default: %d]\n"
+			"  -w repetitions   Warmup repetitions (not measured) [Default: %d]\n"
+			"  -r repetitions   Measured repetitions [Default: %d]\n"
+			"  -R percent       update_sensors/mixed: targets passing the range checks [Default: %d]\n"
+			"  -F percent       update_sensors/mixed: of those, targets within the field of view [Default: %d]\n"
+			"  -o file          Save the results as a baseline\n"
+			"  -c file          Compare the results against a saved baseline\n", DEFAULT_BATCH_SIZE,
+			DEFAULT_WARMUP_REPETITIONS, DEFAULT_REPETITIONS, DEFAULT_RANGE_HIT_PERCENT, DEFAULT_FOV_HIT_PERCENT);
+}
+
+int main(int argc, char** argv) {
+	int32_t range_hit_percent = DEFAULT_RANGE_HIT_PERCENT;
+	int32_t fov_hit_percent = DEFAULT_FOV_HIT_PERCENT;
+	const char *baseline_output_path = NULL;
+	const char *baseline_input_path = NULL;
+
+	int c;
+	while ((c = getopt(argc, argv, "hn:w:r:R:F:o:c:")) != -1) {
+		switch (c) {
+			case 'n':
+				batch_size = atoi(optarg);
+				break;
+			case 'w':
+				warmup_repetitions = atoi(optarg);
+				break;
+			case 'r':
+				repetitions = atoi(optarg);
+				break;
+			case 'R':
+				range_hit_percent = atoi(optarg);
+				break;
+			case 'F':
+				fov_hit_percent = atoi(optarg);
+				break;
+			case 'o':
+				baseline_output_path = optarg;
+				break;
+			case 'c':
+				baseline_input_path = optarg;
+				break;
+			case 'h':
+				print_usage(argv);
+				exit(EXIT_SUCCESS);
+			default:
+				print_usage(argv);
+				exit(EXIT_FAILURE);
+		}
+	}
+	if (batch_size < 1 || warmup_repetitions < 0 || repetitions < 1 || range_hit_percent < 0
+			|| range_hit_percent > 100 || fov_hit_percent < 0 || fov_hit_percent > 100) {
+		fprintf(stderr, "[Err] Invalid benchmark parameters\n");
+		exit(EXIT_FAILURE);
+	}
+
+	Robot::set_world_size(WORLD_SIZE);
+	Robot::range = ROBOT_RANGE;
+	Robot::set_fov(Robot::millidegrees_to_milliradians(FOV * 1000));
+
+	std::vector<Result> results;
+
+	//Sensors
+	results.push_back(measure_update_sensors("update_sensors/range_miss", 0, 0));
+	results.push_back(measure_update_sensors("update_sensors/fov_miss", 100, 0));
+	results.push_back(measure_update_sensors("update_sensors/hit", 100, 100));
+	results.push_back(measure_update_sensors("update_sensors/mixed", range_hit_percent, fov_hit_percent));
+
+	//Positions (cruising robots) & map coordinates
+	std::vector<Robot> robots;
+	for (int32_t i = 1; i <= batch_size; i++) {
+		robots.push_back(Robot::generate(i, 1));
+		robots.back().set_speed_and_direction();
+	}
+	results.push_back(measure("update_position_and_reset_sensors", no_setup, [&]() {
+		uint32_t sum = 0;
+		for (int32_t i = 0; i < batch_size; i++) {
+			sum += robots[i].update_position_and_reset_sensors(NUM_BLOCKS).first;
+		}
+		sink = sum;
+		return (uint32_t) batch_size;
+	}));
+	results.push_back(measure("calc_map_coordinate", no_setup, [&]() {
+		uint32_t sum = 0;
+		for (int32_t i = 0; i < batch_size; i++) {
+			MapCoordinate coordinate = robots[i].calc_map_coordinate(NUM_BLOCKS);
+			sum += coordinate.first + coordinate.second;
+		}
+		sink = sum;
+		return (uint32_t) batch_size;
+	}));
+
+	//Serialization & deserialization of each version
+	std::vector<unsigned char> buffer((size_t) batch_size * Robot::LONG_SERIALIZED_LENGTH);
+	std::vector<Robot> deserialized(batch_size, Robot(0, 0, 0, 0));
+	const char *version_names[] = { "normal", "long", "ghost" };
+	const int versions[] = { Robot::NORMAL_SERIALIZED_VERSION, Robot::LONG_SERIALIZED_VERSION,
+			Robot::GHOST_SERIALIZED_VERSION };
+	const int lengths[] = { Robot::NORMAL_SERIALIZED_LENGTH, Robot::LONG_SERIALIZED_LENGTH,
+			Robot::GHOST_SERIALIZED_LENGTH };
+	for (int v = 0; v < 3; v++) {
+		int version = versions[v];
+		int length = lengths[v];
+		results.push_back(measure(std::string("serialize_") + version_names[v], no_setup, [&]() {
+			for (int32_t i = 0; i < batch_size; i++) {
+				unsigned char *location = &buffer[(size_t) i * length];
+				if (version == Robot::NORMAL_SERIALIZED_VERSION) {
+					robots[i].serialize_normal(location);
+				} else if (version == Robot::LONG_SERIALIZED_VERSION) {
+					robots[i].serialize_long(location);
+				} else {
+					robots[i].serialize_ghost(location);
+				}
+			}
+			sink = buffer[0];
+			return (uint32_t) batch_size;
+		}));
+		results.push_back(measure(std::string("deserialize_") + version_names[v], no_setup, [&]() {
+			for (int32_t i = 0; i < batch_size; i++) {
+				deserialized[i] = Robot(&buffer[(size_t) i * length], version);
+			}
+			sink = deserialized[batch_size - 1].get_x_position();
+			return (uint32_t) batch_size;
+		}));
+	}
+
+	//Baseline to compare against
+	std::map<std::string, double> baseline;
+	if (baseline_input_path != NULL) {
+		std::ifstream baseline_file(baseline_input_path);
+		if (!baseline_file.is_open()) {
+			fprintf(stderr, "[Err] Failed to open baseline file '%s'\n", baseline_input_path);
+			exit(EXIT_FAILURE);
+		}
+		std::string name;
+		double median_ns;
+		while (baseline_file >> name >> median_ns) {
+			baseline[name] = median_ns;
+		}
+	}
+
+	printf("%-36s %12s %12s %12s %9s\n", "Kernel", "ns/call", "(min)", "baseline", "change");
+	for (unsigned int i = 0; i < results.size(); i++) {
+		Result &result = results.at(i);
+		printf("%-36s %12.3f %12.3f", result.name.c_str(), result.median_ns, result.min_ns);
+		std::map<std::string, double>::iterator entry = baseline.find(result.name);
+		if (entry != baseline.end()) {
+			printf(" %12.3f %+8.1f%%\n", entry->second, (result.median_ns / entry->second - 1.0) * 100.0);
+		} else {
+			printf(" %12s %9s\n", "-", "-");
+		}
+	}
+
+	if (baseline_output_path != NULL) {
+		std::ofstream baseline_file(baseline_output_path);
+		if (!baseline_file.is_open()) {
+			fprintf(stderr, "[Err] Failed to open baseline file '%s'\n", baseline_output_path);
+			exit(EXIT_FAILURE);
+		}
+		for (unsigned int i = 0; i < results.size(); i++) {
+			baseline_file << results.at(i).name << ' ' << results.at(i).median_ns << '\n';
+		}
+		printf("Baseline saved to '%s'\n", baseline_output_path);
+	}
+}
@@ -0,0 +1,271 @@
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "robot.h"
+#include "robot_map.h"
+
+/**
+ * Drives a single RobotMap covering the whole world through the worker's frame phases in one process. The halo
+ * exchange is synthetic: the map's ghost strips & moved robots are written to buffers (as for io_uring) and added back
+ * to the map itself, as if it were the only worker in the ring. Reports per phase ns/robot & frames per second as JSON
+ *
+ */
+
+static const int32_t DEFAULT_POPULATION_SIZE = 10000;
+static const int32_t DEFAULT_WORLD_SIZE = 1000;
+static const int32_t DEFAULT_ROBOT_RANGE = 100;
+static const int32_t DEFAULT_FOV = 270;
+static const int32_t DEFAULT_NUM_FRAMES = 200;
+static const int32_t DEFAULT_WARMUP_FRAMES = 20;
+static const uint32_t DEFAULT_SEED = 1;
+
+//Clustered populations: number of clusters & spread (standard deviation) as a fraction of the world size
+static const int CLUSTER_COUNT = 8;
+static const double CLUSTER_SPREAD = 1.0 / 32;
+
+//Ring populations: radius & thickness (standard deviation) as a fraction of the world size
+static const double RING_RADIUS = 1.0 / 4;
+static const double RING_THICKNESS = 1.0 / 64;
+
+//Size of each synthetic halo buffer (matching the io_uring halo exchange)
+static const uint32_t HALO_BUFFER_SIZE = 12582912;
+
+//Frame phases, in the order of Worker::simulation_loop
+enum Phase {
+	CLEAR_GHOST_STRIPS, UPDATE_POSITIONS, HALO_EXCHANGE, UPDATE_SENSORS, SET_SPEEDS, NUM_PHASES
+};
+static const char* PHASE_NAMES[NUM_PHASES] = { "clear_ghost_strips", "update_positions", "halo_exchange",
+		"update_sensors", "set_speeds" };
+
+static uint64_t get_monotonic_nanoseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+//A normally distributed offset (Box-Muller)
+static double normal_offset(double standard_deviation) {
+	double u = 1.0 - drand48();
+	double v = drand48();
+	return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v) * standard_deviation;
+}
+
+//Wraps a position around the torus
+static int32_t wrap_position(double position, int32_t world_size) {
+	int64_t wrapped = (int64_t) floor(position) % world_size;
+	return wrapped < 0 ? wrapped + world_size : wrapped;
+}
+
+//Creates the population with the given density distribution. Returns false for an unknown distribution
+static bool create_population(const std::string &distribution, int32_t population_size, int32_t world_size,
+		uint32_t seed, std::vector<Robot*> &robots) {
+	if (distribution == "uniform") {
+		for (int32_t i = 1; i <= population_size; i++) {
+			robots.push_back(new Robot(Robot::generate(i, seed)));
+		}
+		return true;
+	}
+
+	srand48(seed);
+	double cluster_x[CLUSTER_COUNT], cluster_y[CLUSTER_COUNT];
+	for (int i = 0; i < CLUSTER_COUNT; i++) {
+		cluster_x[i] = drand48() * world_size;
+		cluster_y[i] = drand48() * world_size;
+	}
+	for (int32_t i = 1; i <= population_size; i++) {
+		double x, y;
+		if (distribution == "clustered") {
+			int cluster = lrand48() % CLUSTER_COUNT;
+			x = cluster_x[cluster] + normal_offset(CLUSTER_SPREAD * world_size);
+			y = cluster_y[cluster] + normal_offset(CLUSTER_SPREAD * world_size);
+		} else if (distribution == "ring") {
+			double angle = drand48() * 2.0 * M_PI;
+			double radius = (RING_RADIUS + normal_offset(RING_THICKNESS)) * world_size;
+			x = world_size / 2.0 + radius * cos(angle);
+			y = world_size / 2.0 + radius * sin(angle);
+		} else {
+			return false;
+		}
+		int32_t a_position = drand48() * 6283;
+		robots.push_back(new Robot(i, wrap_position(x, world_size), wrap_position(y, world_size), a_position));
+	}
+	return true;
+}
+
+static void print_usage(char **argv) {
+	printf("Usage: %s [OPTION]\n", argv[0]);
+	printf("  -p pop_size      The number of robots [Default: %d]\n"
+			"  -s world_size    The side length of the (square) world [Default: %d]\n"
+			"  -r robot_range   A robot's sensor field of view range [Default: %d]\n"
+			"  -f fov           The field of view of a robot's sensors in degrees [Default: %d]\n"
+			"  -b num_blocks    The number of blocks to subdivide the 2D space into (NxN) [Default: Maximum possible]\n"
+			"  -d distribution  Robot density: uniform, clustered or ring [Default: uniform]\n"
+			"  -u num_frames    The number of measured frames [Default: %d]\n"
+			"  -w num_frames    The number of warmup frames (not measured) [Default: %d]\n"
+			"  -S seed          Seed for the population [Default: %u]\n", DEFAULT_POPULATION_SIZE, DEFAULT_WORLD_SIZE,
+			DEFAULT_ROBOT_RANGE, DEFAULT_FOV, DEFAULT_NUM_FRAMES, DEFAULT_WARMUP_FRAMES, DEFAULT_SEED);
+}
+
+int main(int argc, char** argv) {
+	int32_t population_size = DEFAULT_POPULATION_SIZE;
+	int32_t world_size = DEFAULT_WORLD_SIZE;
+	int32_t robot_range = DEFAULT_ROBOT_RANGE;
+	int32_t fov = DEFAULT_FOV;
+	int32_t num_blocks = -1;
+	int32_t num_frames = DEFAULT_NUM_FRAMES;
+	int32_t warmup_frames = DEFAULT_WARMUP_FRAMES;
+	uint32_t seed = DEFAULT_SEED;
+	std::string distribution = "uniform";
+
+	int c;
+	while ((c = getopt(argc, argv, "hp:s:r:f:b:d:u:w:S:")) != -1) {
+		switch (c) {
+			case 'p':
+				population_size = atoi(optarg);
+				break;
+			case 's':
+				world_size = atoi(optarg);
+				break;
+			case 'r':
+				robot_range = atoi(optarg);
+				break;
+			case 'f':
+				fov = atoi(optarg);
+				break;
+			case 'b':
+				num_blocks = atoi(optarg);
+				break;
+			case 'd':
+				distribution = optarg;
+				break;
+			case 'u':
+				num_frames = atoi(optarg);
+				break;
+			case 'w':
+				warmup_frames = atoi(optarg);
+				break;
+			case 'S':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'h':
+				print_usage(argv);
+				exit(EXIT_SUCCESS);
+			default:
+				print_usage(argv);
+				exit(EXIT_FAILURE);
+		}
+	}
+	if (population_size < 1 || world_size < 1 || robot_range < 1 || robot_range > world_size || fov < 1 || fov > 360
+			|| num_frames < 1 || warmup_frames < 0) {
+		fprintf(stderr, "[Err] Invalid benchmark parameters\n");
+		exit(EXIT_FAILURE);
+	}
+
+	//Same block constraints as the master (blocks no smaller than the range, evenly dividing the world)
+	int32_t max_num_blocks = world_size / robot_range;
+	while (world_size % max_num_blocks != 0) {
+		max_num_blocks--;
+	}
+	if (num_blocks < 0) {
+		num_blocks = max_num_blocks;
+	} else if (num_blocks < 1 || num_blocks > max_num_blocks || world_size % num_blocks != 0) {
+		fprintf(stderr, "[Err] The world size of '%d' cannot be divided into '%dx%d' blocks of at least the range\n",
+				world_size, num_blocks, num_blocks);
+		exit(EXIT_FAILURE);
+	}
+
+	Robot::set_world_size(world_size);
+	Robot::range = robot_range;
+	Robot::set_fov(Robot::millidegrees_to_milliradians(fov * 1000));
+
+	std::vector<Robot*> robots;
+	if (!create_population(distribution, population_size, world_size, seed, robots)) {
+		fprintf(stderr, "[Err] Unknown density distribution '%s'\n", distribution.c_str());
+		exit(EXIT_FAILURE);
+	}
+	RobotMap map(num_blocks, 0, num_blocks - 1);
+	for (unsigned int i = 0; i < robots.size(); i++) {
+		map.add_robot(*robots.at(i));
+	}
+
+	std::vector<unsigned char> left_buffer(HALO_BUFFER_SIZE);
+	std::vector<unsigned char> right_buffer(HALO_BUFFER_SIZE);
+	RingState ring_state = { 0, 0 };
+
+	uint64_t phase_ns[NUM_PHASES] = { 0 };
+	uint64_t start_ns = 0;
+	for (int32_t frame = 0; frame < warmup_frames + num_frames; frame++) {
+		if (frame == warmup_frames) {
+			memset(phase_ns, 0, sizeof phase_ns);
+			start_ns = get_monotonic_nanoseconds();
+		}
+		uint64_t phase_start_ns = get_monotonic_nanoseconds();
+		uint64_t now_ns;
+
+		map.clear_ghost_strips();
+		now_ns = get_monotonic_nanoseconds();
+		phase_ns[CLEAR_GHOST_STRIPS] += now_ns - phase_start_ns;
+		phase_start_ns = now_ns;
+
+		map.update_robot_positions_and_reset_sensors();
+		now_ns = get_monotonic_nanoseconds();
+		phase_ns[UPDATE_POSITIONS] += now_ns - phase_start_ns;
+		phase_start_ns = now_ns;
+
+		//Our own edges are our neighbours' ghost strips, moved robots come back to us
+		if (map.write_left_ghost_strip_message(&left_buffer[0], HALO_BUFFER_SIZE, ring_state) == 0
+				|| map.write_right_ghost_strip_message(&right_buffer[0], HALO_BUFFER_SIZE, ring_state) == 0) {
+			fprintf(stderr, "[Err] Halo buffer size is too small for ghost strips\n");
+			exit(EXIT_FAILURE);
+		}
+		map.add_right_ghost_strip_message(&left_buffer[4]);
+		map.add_left_ghost_strip_message(&right_buffer[4]);
+		if (map.write_left_moved_robots(&left_buffer[0], HALO_BUFFER_SIZE) == 0
+				|| map.write_right_moved_robots(&right_buffer[0], HALO_BUFFER_SIZE) == 0) {
+			fprintf(stderr, "[Err] Halo buffer size is too small for moved robots\n");
+			exit(EXIT_FAILURE);
+		}
+		map.add_robots_message(&left_buffer[4]);
+		map.add_robots_message(&right_buffer[4]);
+		now_ns = get_monotonic_nanoseconds();
+		phase_ns[HALO_EXCHANGE] += now_ns - phase_start_ns;
+		phase_start_ns = now_ns;
+
+		map.update_robot_sensors();
+		now_ns = get_monotonic_nanoseconds();
+		phase_ns[UPDATE_SENSORS] += now_ns - phase_start_ns;
+		phase_start_ns = now_ns;
+
+		map.set_robot_speeds_and_directions();
+		now_ns = get_monotonic_nanoseconds();
+		phase_ns[SET_SPEEDS] += now_ns - phase_start_ns;
+	}
+	uint64_t elapsed_ns = get_monotonic_nanoseconds() - start_ns;
+
+	double robot_frames = (double) population_size * num_frames;
+	printf("{\n");
+	printf("  \"population_size\": %d,\n", population_size);
+	printf("  \"world_size\": %d,\n", world_size);
+	printf("  \"robot_range\": %d,\n", robot_range);
+	printf("  \"fov\": %d,\n", fov);
+	printf("  \"num_blocks\": %d,\n", num_blocks);
+	printf("  \"distribution\": \"%s\",\n", distribution.c_str());
+	printf("  \"seed\": %u,\n", seed);
+	printf("  \"warmup_frames\": %d,\n", warmup_frames);
+	printf("  \"frames\": %d,\n", num_frames);
+	printf("  \"elapsed_seconds\": %.6f,\n", elapsed_ns / 1e9);
+	printf("  \"fps\": %.3f,\n", num_frames / (elapsed_ns / 1e9));
+	printf("  \"ns_per_robot\": {\n");
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		printf("    \"%s\": %.3f,\n", PHASE_NAMES[phase], phase_ns[phase] / robot_frames);
+	}
+	printf("    \"total\": %.3f\n", elapsed_ns / robot_frames);
+	printf("  }\n");
+	printf("}\n");
+}
@@ -0,0 +1,211 @@
+#!/usr/bin/env python3
+"""
+Localhost cluster scaling benchmark. Runs the master (without the enter prompt) & N workers on this machine for each
+configuration of a sweep, and prints strong scaling (fixed population) & weak scaling (fixed robots per worker) tables:
+frames per second, parallel efficiency, halo bytes per frame per link & startup time.
+
+Weak scaling keeps the world size, so the robot density grows with the workers (as does the halo traffic). Runs are
+sequential & each runs in a scratch directory (the master writes its final positions to the working directory).
+Configurations the master rejects (e.g. blocks not evenly split between the workers) are reported as skipped.
+
+Usage: bench_src/scaling_bench.py [-w 2,4,5,10] [-p 20000] [-b 10] [-W 5000] [-u 500] [-- master options]
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+#Master port (protocol::SERVER_PORT)
+SERVER_PORT = 2828
+TCP_LISTEN_STATE = "0A"
+
+READY_PATTERN = re.compile(r"Universe is ready after ([0-9.]+) seconds")
+FPS_PATTERN = re.compile(r"Average FPS: ([0-9.]+)")
+HALO_PATTERN = re.compile(r"Halo bytes received per frame: left ([0-9.]+), right ([0-9.]+)")
+
+
+def parse_list(text):
+	return [int(value) for value in text.split(",") if value]
+
+
+def is_listening(port):
+	"""Is anything listening on the TCP port? (Connecting would join the master's lobby as a worker)"""
+	for table in ("/proc/net/tcp", "/proc/net/tcp6"):
+		try:
+			with open(table) as lines:
+				next(lines)
+				for line in lines:
+					fields = line.split()
+					if int(fields[1].rsplit(":", 1)[1], 16) == port and fields[3] == TCP_LISTEN_STATE:
+						return True
+		except OSError:
+			pass
+	return False
+
+
+def wait_until(condition, timeout):
+	deadline = time.monotonic() + timeout
+	while time.monotonic() < deadline:
+		if condition():
+			return True
+		time.sleep(0.01)
+	return False
+
+
+def stop(processes):
+	for process in processes:
+		if process.poll() is None:
+			process.kill()
+	for process in processes:
+		process.wait()
+
+
+def run(options, num_workers, population_size, num_blocks):
+	"""Runs one configuration. Returns the result, with 'error' set if it failed or was rejected"""
+	result = {"workers": num_workers, "population": population_size, "blocks": num_blocks}
+	master_args = [options.master, "-N", "-n", str(num_workers), "-p", str(population_size), "-u", str(options.updates)]
+	if num_blocks > 0:
+		master_args += ["-b", str(num_blocks)]
+	master_args += options.master_options
+
+	if not wait_until(lambda: not is_listening(SERVER_PORT), options.timeout):
+		result["error"] = "master port %d in use" % SERVER_PORT
+		return result
+
+	directory = tempfile.mkdtemp(prefix="scaling_bench_")
+	processes = []
+	try:
+		master_log = open(os.path.join(directory, "master.log"), "w+")
+		master = subprocess.Popen(master_args, cwd=directory, stdin=subprocess.DEVNULL, stdout=master_log,
+				stderr=subprocess.STDOUT)
+		processes.append(master)
+		if not wait_until(lambda: is_listening(SERVER_PORT) or master.poll() is not None, options.timeout) \
+				or master.poll() is not None:
+			master.wait()
+			master_log.seek(0)
+			lines = master_log.read().strip().splitlines()
+			result["error"] = lines[-1] if lines else "master exited"
+			return result
+
+		worker_logs = []
+		for i in range(num_workers):
+			worker_log = open(os.path.join(directory, "worker%d.log" % (i + 1)), "w+")
+			worker_logs.append(worker_log)
+			processes.append(subprocess.Popen([options.worker, "localhost"], cwd=directory, stdin=subprocess.DEVNULL,
+					stdout=worker_log, stderr=subprocess.STDOUT))
+
+		try:
+			master.wait(options.timeout)
+		except subprocess.TimeoutExpired:
+			result["error"] = "timed out after %d seconds" % options.timeout
+			return result
+		for process in processes[1:]:
+			try:
+				process.wait(options.timeout)
+			except subprocess.TimeoutExpired:
+				result["error"] = "worker timed out"
+				return result
+
+		master_log.seek(0)
+		output = master_log.read()
+		ready = READY_PATTERN.search(output)
+		fps = FPS_PATTERN.search(output)
+		if master.returncode != 0 or ready is None or fps is None:
+			result["error"] = "master failed (exit %d)" % master.returncode
+			return result
+		result["startup_seconds"] = float(ready.group(1))
+		result["fps"] = float(fps.group(1))
+
+		#Each ring link (worker i to its right neighbour) carries what i receives from the right & i + 1 from the left
+		received = []
+		for worker_log in worker_logs:
+			worker_log.seek(0)
+			halo = HALO_PATTERN.search(worker_log.read())
+			if halo is None:
+				result["error"] = "worker reported no halo traffic"
+				return result
+			received.append((float(halo.group(1)), float(halo.group(2))))
+		links = [received[i][1] + received[(i + 1) % num_workers][0] for i in range(num_workers)]
+		result["link_bytes_per_frame"] = sum(links) / num_workers
+		result["max_link_bytes_per_frame"] = max(links)
+		return result
+	finally:
+		stop(processes)
+		shutil.rmtree(directory, ignore_errors=True)
+
+
+def print_table(title, results, per_worker):
+	"""Efficiency is relative to the smallest worker count that ran for the same configuration: speedup over the ideal
+	(strong scaling) or FPS held (weak scaling)"""
+	print("\n%s" % title)
+	print("%8s %10s %7s %10s %11s %14s %14s %10s" % ("workers", "population", "blocks", "fps", "efficiency",
+			"bytes/frame", "(max link)", "startup s"))
+	baselines = {}
+	for result in results:
+		key = result["blocks"] if per_worker else (result["population"], result["blocks"])
+		line = "%8d %10d %7s" % (result["workers"], result["population"], result["blocks"] or "max")
+		if "error" in result:
+			print("%s   skipped: %s" % (line, result["error"]))
+			continue
+		baseline = baselines.setdefault(key, result)
+		ideal_fps = baseline["fps"] if per_worker else baseline["fps"] * result["workers"] / baseline["workers"]
+		result["efficiency"] = result["fps"] / ideal_fps
+		print("%s %10.1f %10.1f%% %14.1f %14.1f %10.3f" % (line, result["fps"], result["efficiency"] * 100,
+				result["link_bytes_per_frame"], result["max_link_bytes_per_frame"], result["startup_seconds"]))
+
+
+def main():
+	root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+	parser = argparse.ArgumentParser(description="Localhost master & workers scaling benchmark",
+			epilog="Options after '--' are passed on to the master (e.g. -- -U -a -S 1)")
+	parser.add_argument("-w", "--workers", type=parse_list, default=[2, 4, 5, 10],
+			help="Worker counts to sweep [Default: 2,4,5,10]")
+	parser.add_argument("-p", "--populations", type=parse_list, default=[20000],
+			help="Strong scaling: population sizes to sweep [Default: 20000]")
+	parser.add_argument("-b", "--blocks", type=parse_list, default=[0],
+			help="Block counts (NxN) to sweep, 0: maximum possible [Default: 0]")
+	parser.add_argument("-W", "--robots-per-worker", type=int, default=5000,
+			help="Weak scaling: robots per worker, 0: no weak scaling [Default: 5000]")
+	parser.add_argument("-u", "--updates", type=int, default=500, help="Frames per run [Default: 500]")
+	parser.add_argument("-t", "--timeout", type=int, default=300, help="Seconds before a run is abandoned [Default: 300]")
+	parser.add_argument("-o", "--output", help="Also write the results as JSON to the file")
+	parser.add_argument("--master", default=os.path.join(root, "master"), help="Master executable")
+	parser.add_argument("--worker", default=os.path.join(root, "worker"), help="Worker executable")
+	parser.add_argument("master_options", nargs="*", help=argparse.SUPPRESS)
+	options = parser.parse_args()
+	options.master = os.path.abspath(options.master)
+	options.worker = os.path.abspath(options.worker)
+
+	for executable in (options.master, options.worker):
+		if not os.access(executable, os.X_OK):
+			sys.exit("[Err] '%s' is not executable (build with make)" % executable)
+
+	strong = []
+	for population_size in options.populations:
+		for num_blocks in options.blocks:
+			for num_workers in options.workers:
+				strong.append(run(options, num_workers, population_size, num_blocks))
+	print_table("Strong scaling (%d frames)" % options.updates, strong, False)
+
+	weak = []
+	if options.robots_per_worker > 0:
+		for num_blocks in options.blocks:
+			for num_workers in options.workers:
+				weak.append(run(options, num_workers, options.robots_per_worker * num_workers, num_blocks))
+		print_table("Weak scaling (%d robots per worker, %d frames)" % (options.robots_per_worker, options.updates),
+				weak, True)
+
+	if options.output:
+		with open(options.output, "w") as output:
+			json.dump({"updates": options.updates, "master_options": options.master_options, "strong": strong,
+					"weak": weak}, output, indent=2)
+
+
+if __name__ == "__main__":
+	main()
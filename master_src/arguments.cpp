@@ -5,6 +5,8 @@
 #include <cstdlib>
 
 #include "robot.h"
+#include "population_file.h"
+#include "manifest.h"
 
 Arguments::Arguments(int argc, char **argv) {
 	// Set default options
@@ -16,12 +18,34 @@ Arguments::Arguments(int argc, char **argv) {
 	direction_inverted = Arguments::DEFAULT_INVERT_DIRECTION;
 	worker_debug_enabled = Arguments::DEFAULT_WORKER_DEBUG_ENABLED;
 	visualization_enabled = Arguments::DEFAULT_VISUALIZATION_ENABLED;
+	io_uring_enabled = Arguments::DEFAULT_IO_URING_ENABLED;
+	frame_aggregation_enabled = Arguments::DEFAULT_FRAME_AGGREGATION_ENABLED;
+	progress_frames = Arguments::DEFAULT_PROGRESS_FRAMES;
+	progress_ms = Arguments::DEFAULT_PROGRESS_MS;
+	stats_pool_size = Arguments::DEFAULT_STATS_POOL_SIZE;
+	stats_interval = Arguments::DEFAULT_STATS_INTERVAL;
+	image_output_dir = NULL;
+	robot_seed_provided = false;
+	robot_seed = 0;
+	population_input_path = NULL;
+	population_input_shared = false;
+	population_output_path = NULL;
+	positions_output_dir = NULL;
+	checkpoint_interval = Arguments::DEFAULT_CHECKPOINT_INTERVAL;
+	checkpoint_dir = NULL;
+	restart_manifest_path = NULL;
+	elastic_enabled = Arguments::DEFAULT_ELASTIC_ENABLED;
+	auto_start_enabled = Arguments::DEFAULT_AUTO_START_ENABLED;
+	trace_output_path = NULL;
+	metrics_port = 0;
+	perf_counters_interval = 0;
+	start_frame = 0;
 
 	bool num_workers_provided = false;
 	bool population_size_provided = false;
 
 	int c;
-	while ((c = getopt(argc, argv, "hn:p:u:s:r:b:f:idv")) != -1) {
+	while ((c = getopt(argc, argv, "hn:p:u:s:r:b:f:idvUaP:T:k:I:H:S:L:MO:D:c:C:R:eNt:m:W:")) != -1) {
 		switch (c) {
 			case 'h':
 				print_usage(argv);
@@ -99,6 +123,116 @@ Arguments::Arguments(int argc, char **argv) {
 				visualization_enabled = true;
 				break;
 
+			case 'U':
+				io_uring_enabled = true;
+				break;
+
+			case 'a':
+				frame_aggregation_enabled = true;
+				break;
+
+			case 'P':
+				progress_frames = atoi(optarg);
+				if (progress_frames < 1) {
+					fprintf(stderr, "Progress reporting interval must be >= 1 frame\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
+			case 'T':
+				progress_ms = atoi(optarg);
+				if (progress_ms < 1) {
+					fprintf(stderr, "Progress reporting interval must be >= 1 ms\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
+			case 'k':
+				stats_pool_size = atoi(optarg);
+				if (stats_pool_size < 1) {
+					fprintf(stderr, "Stats pool size must be >= 1\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
+			case 'I':
+				stats_interval = atoi(optarg);
+				if (stats_interval < 1) {
+					fprintf(stderr, "Stats interval must be >= 1\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
+			case 'H':
+				image_output_dir = optarg;
+				visualization_enabled = true;
+				break;
+
+			case 'S':
+				robot_seed = strtoul(optarg, NULL, 10);
+				robot_seed_provided = true;
+				break;
+
+			case 'L':
+				population_input_path = optarg;
+				break;
+
+			case 'M':
+				population_input_shared = true;
+				break;
+
+			case 'O':
+				population_output_path = optarg;
+				break;
+
+			case 'D':
+				positions_output_dir = optarg;
+				break;
+
+			case 'c':
+				checkpoint_interval = atoi(optarg);
+				if (checkpoint_interval < 1) {
+					fprintf(stderr, "Checkpoint interval must be >= 1\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
+			case 'C':
+				checkpoint_dir = optarg;
+				break;
+
+			case 'R':
+				restart_manifest_path = optarg;
+				break;
+
+			case 'e':
+				elastic_enabled = true;
+				break;
+
+			case 'N':
+				auto_start_enabled = true;
+				break;
+
+			case 't':
+				trace_output_path = optarg;
+				break;
+
+			case 'm':
+				metrics_port = atoi(optarg);
+				if (metrics_port < 1 || metrics_port > 65535) {
+					fprintf(stderr, "Metrics port must be between 1 and 65535\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
+			case 'W':
+				perf_counters_interval = atoi(optarg);
+				if (perf_counters_interval < 1) {
+					fprintf(stderr, "Performance counter interval must be >= 1\n");
+					exit (EXIT_FAILURE);
+				}
+				break;
+
 			default:
 				print_usage(argv);
 				exit (EXIT_FAILURE);
@@ -111,18 +245,100 @@ Arguments::Arguments(int argc, char **argv) {
 		fprintf(stderr, "Number of workers not supplied\n");
 		exit (EXIT_FAILURE);
 	}
-	if (!population_size_provided) {
+	if (population_input_path != NULL && restart_manifest_path != NULL) {
+		fprintf(stderr, "A population file cannot be combined with a restart checkpoint\n");
+		exit (EXIT_FAILURE);
+	}
+	if (population_input_path != NULL) {
+		validate_population_input(population_size_provided);
+	} else if (restart_manifest_path != NULL) {
+		validate_restart_manifest(population_size_provided);
+	} else if (!population_size_provided) {
 		fprintf(stderr, "Population size not supplied\n");
 		exit (EXIT_FAILURE);
 	}
 
+	//Only one source of robots, and only robots created by the master can be saved
+	if ((population_input_path != NULL || restart_manifest_path != NULL) && robot_seed_provided) {
+		fprintf(stderr, "A population file or restart checkpoint cannot be combined with a robot seed\n");
+		exit (EXIT_FAILURE);
+	}
+	if (population_input_shared && population_input_path == NULL) {
+		fprintf(stderr, "Shared population input requires a population file\n");
+		exit (EXIT_FAILURE);
+	}
+	if (population_output_path != NULL
+			&& (population_input_path != NULL || restart_manifest_path != NULL || robot_seed_provided)) {
+		fprintf(stderr, "Only a population generated by the master can be saved\n");
+		exit (EXIT_FAILURE);
+	}
+
+	if ((checkpoint_interval > 0) != (checkpoint_dir != NULL)) {
+		fprintf(stderr, "A checkpoint interval & checkpoint directory must be supplied together\n");
+		exit (EXIT_FAILURE);
+	}
+
+	//Per worker reports are needed for block stats & slowest worker tracking
+	if (frame_aggregation_enabled && (visualization_enabled || worker_debug_enabled)) {
+		fprintf(stderr, "Frame aggregation cannot be combined with visualization or worker debugging\n");
+		exit (EXIT_FAILURE);
+	}
+	if (is_progress_reporting_enabled() && (visualization_enabled || worker_debug_enabled || frame_aggregation_enabled)) {
+		fprintf(stderr,
+				"Progress reporting intervals cannot be combined with visualization, worker debugging or frame aggregation\n");
+		exit (EXIT_FAILURE);
+	}
+
 	validate_block_size();
 	validate_num_workers();
+	validate_stats_pool_size();
 }
 
 Arguments::~Arguments() {
 }
 
+void Arguments::validate_population_input(bool population_size_provided) {
+	PopulationFile population_file;
+	if (population_file.open(population_input_path) != 0) {
+		exit (EXIT_FAILURE);
+	}
+	if ((int32_t) population_file.get_world_size() != world_size) {
+		fprintf(stderr, "The population file is for a world size of '%u', not '%d'\n", population_file.get_world_size(),
+				world_size);
+		exit (EXIT_FAILURE);
+	}
+	if (population_size_provided && (uint32_t) population_size != population_file.get_population_size()) {
+		fprintf(stderr, "The population file holds '%u' robots, not '%d'\n", population_file.get_population_size(),
+				population_size);
+		exit (EXIT_FAILURE);
+	}
+	population_size = population_file.get_population_size();
+}
+
+void Arguments::validate_restart_manifest(bool population_size_provided) {
+	Manifest manifest;
+	if (manifest.read(restart_manifest_path) != 0) {
+		exit (EXIT_FAILURE);
+	}
+	if ((int32_t) manifest.world_size != world_size) {
+		fprintf(stderr, "The checkpoint is for a world size of '%u', not '%d'\n", manifest.world_size, world_size);
+		exit (EXIT_FAILURE);
+	}
+	if (population_size_provided && (uint32_t) population_size != manifest.population_size) {
+		fprintf(stderr, "The checkpoint holds '%u' robots, not '%d'\n", manifest.population_size, population_size);
+		exit (EXIT_FAILURE);
+	}
+
+	//The final frame (num_updates) must still be ahead of us
+	if (num_updates >= 0 && manifest.frame > (uint32_t) num_updates) {
+		fprintf(stderr, "The checkpoint is at frame '%u', past the number of updates '%d'\n", manifest.frame,
+				num_updates);
+		exit (EXIT_FAILURE);
+	}
+	population_size = manifest.population_size;
+	start_frame = manifest.frame;
+}
+
 void Arguments::validate_block_size() {
 
 	// Calculate the max number of blocks possible that the space can be evenly divided into
@@ -191,15 +407,29 @@ void Arguments::validate_num_workers() {
 	}
 }
 
+void Arguments::validate_stats_pool_size() {
+	int32_t slice_blocks = get_worker_slice_size() / get_block_size();
+	if (slice_blocks % stats_pool_size != 0) {
+		fprintf(stderr, "A worker slice of '%d' blocks is not evenly divisible by a stats pool size of '%d'\n",
+				slice_blocks, stats_pool_size);
+		exit (EXIT_FAILURE);
+	}
+	if (num_blocks % stats_pool_size != 0) {
+		fprintf(stderr, "The '%dx%d' blocks cannot be evenly pooled into '%dx%d' stats\n", num_blocks, num_blocks,
+				stats_pool_size, stats_pool_size);
+		exit (EXIT_FAILURE);
+	}
+}
+
 void Arguments::print_usage(char **argv) {
-	static const char usage[] = "Usage: %s [OPTION] -n num_workers -p pop_size\n";
+	static const char usage[] = "Usage: %s [OPTION] -n num_workers (-p pop_size | -L population_file | -R manifest)\n";
 	printf(usage, argv[0]);
 }
 
 void Arguments::print_help() {
 	static const char mandatory_args[] = "Mandatory arguments:\n"
 			"  -n num_workers   The number of worker nodes to use\n"
-			"  -p pop_size      The number of robots in the universe\n";
+			"  -p pop_size      The number of robots in the universe (unless loaded with -L or -R)\n";
 
 	static const char optional_args[] =
 			"Optional arguments:\n"
@@ -210,7 +440,34 @@ void Arguments::print_help() {
 					"  -f fov           The field of view of a robot's sensors in degrees [Default: 270]\n"
 					"  -i               Invert robot direction behavior. Move toward others instead of away [Default: no]\n"
 					"  -d               Enable worker debugging to identify a slow worker (in combination with '-u') [Default: no]\n"
-					"  -v               Enable visualization [Default: no]\n";
+					"  -v               Enable visualization [Default: no]\n"
+					"  -U               Use io_uring for the workers' halo exchange where available [Default: no]\n"
+					"  -a               Aggregate frame completion along the worker ring, only the last worker reports [Default: no]\n"
+					"  -P num_frames    Workers report progress & phase timings every N frames instead of every frame [Default: Off]\n"
+					"  -T ms            Workers report progress & phase timings at least every T milliseconds [Default: Off]\n"
+					"  -k pool_size     Pool KxK blocks into one value for visualization stats [Default: 1]\n"
+					"  -I interval      Send visualization stats every N frames [Default: 1]\n"
+					"  -H output_dir    Headless visualization, writes stats frames as PPM images to the directory [Default: no]\n"
+					"  -S seed          Workers generate the robots in their slices from the seed [Default: Master sends robots]\n"
+					"  -L file          Load the robots from a binary population file (sets the population size) [Default: no]\n"
+					"  -M               The population file is on shared storage, workers map it themselves [Default: no]\n"
+					"  -O file          Save the initial population to a binary population file [Default: no]\n"
+					"  -D output_dir    Workers write binary final position shards & master a manifest to the (shared) directory\n"
+					"                   instead of the master writing text positions [Default: no]\n"
+					"  -c interval      Workers checkpoint every N frames, only the latest is kept (requires '-C') [Default: Off]\n"
+					"  -C dir           Directory for checkpoints, on each worker & the master (manifest) [Default: no]\n"
+					"  -R manifest      Restart from a checkpoint (on any number of workers), '-u' counts from frame 0 [Default: no]\n"
+					"  -e               Workers may join (connect) or leave (SIGTERM) during the run, one at a time: a joining\n"
+					"                   worker takes half of the columns of the worker with the most, a leaving one hands its\n"
+					"                   columns to a neighbour, while the rest of the ring keeps running [Default: no]\n"
+					"  -N               Begin the simulation as soon as the universe is ready, without waiting for enter\n"
+					"                   (scripted runs) [Default: no]\n"
+					"  -t file          Trace the workers' & master's threads, written as Chrome trace event JSON to the file\n"
+					"                   (the last events of each thread, elastic runs: of the last workers) [Default: no]\n"
+					"  -m port          Serve Prometheus text metrics of the run over HTTP on the port, per worker metrics\n"
+					"                   require '-P' or '-T' [Default: no]\n"
+					"  -W interval      Workers sample hardware performance counters (cycles, instructions, cache & branch\n"
+					"                   misses) around each phase, printing them every N frames & for the run [Default: no]\n";
 
 	puts(mandatory_args);
 	puts(optional_args);
@@ -227,6 +484,21 @@ void Arguments::print_arguments() {
 	printf("   Robot range:        %d\n", robot_range);
 	printf("   Robot FOV:          %d mrad (%d deg)\n", fov, Robot::milliradians_to_millidegrees(fov) / 1000);
 	printf("   Inverted:           %s\n", direction_inverted ? "Yes" : "No");
+	if (robot_seed_provided) {
+		printf("   Robots:             Generated by workers (seed %u)\n", robot_seed);
+	} else if (population_input_path != NULL) {
+		printf("   Robots:             Loaded from '%s' by %s\n", population_input_path,
+				population_input_shared ? "workers" : "master");
+	} else if (restart_manifest_path != NULL) {
+		printf("   Robots:             Restarted from '%s' (frame %u)\n", restart_manifest_path, start_frame);
+	} else {
+		printf("   Robots:             Sent by master\n");
+	}
+	if (positions_output_dir != NULL) {
+		printf("   Final positions:    Shards written by workers to '%s'\n", positions_output_dir);
+	} else {
+		printf("   Final positions:    Text file written by master\n");
+	}
 	if (num_updates < 0) {
 		printf("   Number of updates:  No limit\n");
 	} else {
@@ -237,7 +509,43 @@ void Arguments::print_arguments() {
 	printf("   Number of workers:  %d\n", num_workers);
 	printf("   Worker slice size:  %d (%dx%d blocks)\n", slice_size, slice_size / block_size, num_blocks);
 	printf("   Worker debugging:   %s\n", worker_debug_enabled ? "Yes" : "No");
-	printf("   Visualization:      %s\n", visualization_enabled ? "Yes" : "No");
+	if (image_output_dir != NULL) {
+		printf("   Visualization:      Headless ('%s')\n", image_output_dir);
+	} else {
+		printf("   Visualization:      %s\n", visualization_enabled ? "Yes" : "No");
+	}
+	if (visualization_enabled) {
+		printf("   Stats resolution:   %dx%d (every %d frames)\n", num_blocks / stats_pool_size,
+				num_blocks / stats_pool_size, stats_interval);
+	}
+	printf("   Halo exchange:      %s\n", io_uring_enabled ? "io_uring (where available)" : "Sockets");
+	printf("   Frame aggregation:  %s\n", frame_aggregation_enabled ? "Yes" : "No");
+	if (is_progress_reporting_enabled()) {
+		printf("   Progress interval:  %d frames, %d ms (0: none)\n", progress_frames, progress_ms);
+	} else {
+		printf("   Progress interval:  Every frame\n");
+	}
+	if (checkpoint_interval > 0) {
+		printf("   Checkpoints:        Every %d frames ('%s')\n", checkpoint_interval, checkpoint_dir);
+	} else {
+		printf("   Checkpoints:        No\n");
+	}
+	printf("   Elastic workers:    %s\n", elastic_enabled ? "Yes (workers join & leave the running ring)" : "No");
+	if (trace_output_path != NULL) {
+		printf("   Tracing:            '%s'\n", trace_output_path);
+	} else {
+		printf("   Tracing:            No\n");
+	}
+	if (metrics_port > 0) {
+		printf("   Metrics port:       %d\n", metrics_port);
+	} else {
+		printf("   Metrics port:       No\n");
+	}
+	if (perf_counters_interval > 0) {
+		printf("   Perf counters:      Every %d frames\n", perf_counters_interval);
+	} else {
+		printf("   Perf counters:      No\n");
+	}
 	printf("**************************************************\n");
 }
 
@@ -269,6 +577,10 @@ uint32_t Arguments::get_num_workers() {
 	return num_workers;
 }
 
+void Arguments::set_num_workers(uint32_t num_workers) {
+	this->num_workers = num_workers;
+}
+
 uint32_t Arguments::get_worker_slice_size() {
 	return world_size / num_workers;
 }
@@ -289,3 +601,98 @@ bool Arguments::is_visualization_enabled() {
 	return visualization_enabled;
 }
 
+bool Arguments::is_io_uring_enabled() {
+	return io_uring_enabled;
+}
+
+bool Arguments::is_frame_aggregation_enabled() {
+	return frame_aggregation_enabled;
+}
+
+uint32_t Arguments::get_progress_frames() {
+	return progress_frames;
+}
+
+uint32_t Arguments::get_progress_ms() {
+	return progress_ms;
+}
+
+bool Arguments::is_progress_reporting_enabled() {
+	return progress_frames > 0 || progress_ms > 0;
+}
+
+uint32_t Arguments::get_stats_pool_size() {
+	return stats_pool_size;
+}
+
+uint32_t Arguments::get_stats_interval() {
+	return stats_interval;
+}
+
+const char* Arguments::get_image_output_dir() {
+	return image_output_dir;
+}
+
+bool Arguments::is_robot_generation_enabled() {
+	return robot_seed_provided;
+}
+
+uint32_t Arguments::get_robot_seed() {
+	return robot_seed;
+}
+
+const char* Arguments::get_population_input_path() {
+	return population_input_path;
+}
+
+bool Arguments::is_population_input_shared() {
+	return population_input_shared;
+}
+
+const char* Arguments::get_population_output_path() {
+	return population_output_path;
+}
+
+const char* Arguments::get_positions_output_dir() {
+	return positions_output_dir;
+}
+
+uint32_t Arguments::get_checkpoint_interval() {
+	return checkpoint_interval;
+}
+
+const char* Arguments::get_checkpoint_dir() {
+	return checkpoint_dir;
+}
+
+const char* Arguments::get_restart_manifest_path() {
+	return restart_manifest_path;
+}
+
+uint32_t Arguments::get_start_frame() {
+	return start_frame;
+}
+
+bool Arguments::is_elastic_enabled() {
+	return elastic_enabled;
+}
+
+bool Arguments::is_auto_start_enabled() {
+	return auto_start_enabled;
+}
+
+const char* Arguments::get_trace_output_path() {
+	return trace_output_path;
+}
+
+bool Arguments::is_tracing_enabled() {
+	return trace_output_path != NULL;
+}
+
+uint32_t Arguments::get_metrics_port() {
+	return metrics_port;
+}
+
+uint32_t Arguments::get_perf_counters_interval() {
+	return perf_counters_interval;
+}
@@ -22,6 +22,17 @@ class Arguments {
 		static const bool DEFAULT_INVERT_DIRECTION = false;
 		static const bool DEFAULT_WORKER_DEBUG_ENABLED = false;
 		static const bool DEFAULT_VISUALIZATION_ENABLED = false;
+		static const bool DEFAULT_IO_URING_ENABLED = false;
+		static const bool DEFAULT_FRAME_AGGREGATION_ENABLED = false;
+		static const bool DEFAULT_ELASTIC_ENABLED = false;
+		static const bool DEFAULT_AUTO_START_ENABLED = false;
+		// 0 = No interval
+		static const int32_t DEFAULT_PROGRESS_FRAMES = 0;
+		static const int32_t DEFAULT_PROGRESS_MS = 0;
+		static const int32_t DEFAULT_STATS_POOL_SIZE = 1;
+		static const int32_t DEFAULT_STATS_INTERVAL = 1;
+		// 0 = No checkpoints
+		static const int32_t DEFAULT_CHECKPOINT_INTERVAL = 0;
 
 		int32_t num_updates;
 		int32_t population_size;
@@ -33,6 +44,28 @@ class Arguments {
 		bool direction_inverted;
 		bool worker_debug_enabled;
 		bool visualization_enabled;
+		bool io_uring_enabled;
+		bool frame_aggregation_enabled;
+		int32_t progress_frames;
+		int32_t progress_ms;
+		int32_t stats_pool_size;
+		int32_t stats_interval;
+		const char *image_output_dir;
+		bool robot_seed_provided;
+		uint32_t robot_seed;
+		const char *population_input_path;
+		bool population_input_shared;
+		const char *population_output_path;
+		const char *positions_output_dir;
+		int32_t checkpoint_interval;
+		const char *checkpoint_dir;
+		const char *restart_manifest_path;
+		uint32_t start_frame;
+		bool elastic_enabled;
+		bool auto_start_enabled;
+		const char *trace_output_path;
+		int32_t metrics_port;
+		int32_t perf_counters_interval;
 
 		static void print_usage(char **argv);
 		static void print_help();
@@ -40,9 +73,18 @@ class Arguments {
 		//Ensure the block size is no smaller than a robot's range
 		void validate_block_size();
 
+		//Takes the population size from the input population file & checks it was saved for the same world size
+		void validate_population_input(bool population_size_provided);
+
+		//Ensure a restart checkpoint matches the configuration & take the population size & start frame from it
+		void validate_restart_manifest(bool population_size_provided);
+
 		//Checks if we can split the grid into N slices (N workers) where slice boundaries fall on block boundaries
 		void validate_num_workers();
 
+		//Ensure pooled visualization stats cover whole blocks within each worker slice
+		void validate_stats_pool_size();
+
 	public:
 		Arguments(int argc, char **argv);
 		~Arguments();
@@ -73,6 +115,66 @@ class Arguments {
 		bool is_worker_debug_enabled();
 
 		bool is_visualization_enabled();
+
+		bool is_io_uring_enabled();
+
+		bool is_frame_aggregation_enabled();
+
+		//Progress reporting intervals (0: no interval)
+		uint32_t get_progress_frames();
+		uint32_t get_progress_ms();
+
+		//Do workers send batched PROGRESS records instead of FRAME_FINISHED every frame?
+		bool is_progress_reporting_enabled();
+
+		//Visualization stats pool k x k blocks & are sent every N frames
+		uint32_t get_stats_pool_size();
+		uint32_t get_stats_interval();
+
+		//Directory for headless visualization images (NULL: draw to a window)
+		const char* get_image_output_dir();
+
+		//Do workers generate the robots themselves from a seed (instead of the master sending them)?
+		bool is_robot_generation_enabled();
+		uint32_t get_robot_seed();
+
+		//Binary population file to load the robots from (NULL: none). Workers map it themselves if it is shared
+		const char* get_population_input_path();
+		bool is_population_input_shared();
+
+		//Binary population file to save the initial population to (NULL: none)
+		const char* get_population_output_path();
+
+		//Directory the workers write binary final position shards to (NULL: master writes the text positions file)
+		const char* get_positions_output_dir();
+
+		//Workers checkpoint their robots every N frames to the directory (local to each worker, the master keeps the
+		//manifest of the last checkpoint all workers have written in its own). 0: No checkpoints
+		uint32_t get_checkpoint_interval();
+		const char* get_checkpoint_dir();
+
+		//Manifest of the checkpoint to restart from (NULL: start from frame 0) & the frames simulated before it
+		const char* get_restart_manifest_path();
+		uint32_t get_start_frame();
+
+		//Can workers join or leave during the run? (Spliced into or out of the running ring)
+		bool is_elastic_enabled();
+
+		//Does the simulation begin as soon as the universe is ready? (Else once enter is pressed)
+		bool is_auto_start_enabled();
+
+		//File to write the trace of the workers' & master's events to (NULL: no tracing)
+		const char* get_trace_output_path();
+		bool is_tracing_enabled();
+
+		//Port serving Prometheus text metrics during the run (0: none)
+		uint32_t get_metrics_port();
+
+		//Workers print the hardware performance counters of each phase every N frames & for the run (0: not sampled)
+		uint32_t get_perf_counters_interval();
+
+		//The number of workers in the ring once a worker has joined or left (elastic runs)
+		void set_num_workers(uint32_t num_workers);
 };
 
 #endif /* ARGUMENTS_H_ */
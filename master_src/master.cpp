@@ -1,24 +1,32 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/epoll.h>
 #include <netdb.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <pthread.h>
+#include <errno.h>
 #include <string>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstdarg>
 
 #include "master.h"
 #include "netutils.h"
 #include "protocol.h"
 #include "arguments.h"
 #include "visualization.h"
+#include "population_file.h"
+#include "manifest.h"
+#include "profiling.h"
 
 const char* Master::POSITIONS_DUMP_FILE = "robot_positions.txt";
+const char* Master::POSITIONS_MANIFEST_FILE = "manifest.txt";
+const char* Master::CHECKPOINT_MANIFEST_FILE = "checkpoint.txt";
 
 Master::Master(Arguments &args) {
 
@@ -81,77 +89,119 @@ Master::Master(Arguments &args) {
 		exit(EXIT_FAILURE);
 	}
 
+	//Create the epoll instance and watch the listen socket (identified by a NULL data pointer)
+	if ((epoll_fd = epoll_create1(0)) < 0) {
+		fprintf(stderr, "[Err] Failed to create epoll instance\n");
+		exit(EXIT_FAILURE);
+	}
+	struct epoll_event event;
+	memset(&event, 0, sizeof event);
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0) {
+		fprintf(stderr, "[Err] Failed to add listen socket to epoll\n");
+		exit(EXIT_FAILURE);
+	}
+
 	//Initialize
-	worker_connections.reserve(args.get_num_workers());
-	slowest_connection_count.resize(args.get_num_workers(), 0);
+	metrics_server = NULL;
+	checkpoint_frame = 0;
+	simulation_running = false;
+	reconfiguration_pending = false;
+	reconfiguration_requested = false;
+	joining_connection = NULL;
+	leaving_connection = NULL;
+	num_reconfigured = 0;
+	reconfiguration_frame = 0;
+	joining_connection_ready = false;
+	reset_worker_state();
+}
+
+void Master::reset_worker_state() {
+	uint32_t num_workers = args->get_num_workers();
+	uint32_t start_frame = args->get_start_frame();
+
+	worker_connections.clear();
+	worker_connections.reserve(num_workers);
+	slowest_connection_count.assign(num_workers, 0);
+	worker_completed_frames.assign(num_workers, start_frame);
+	worker_phase_timings.assign(num_workers, FrameTimings());
+	worker_message_stats.assign(num_workers, std::vector<MessageStats>(MessageStats::NUM_CONNECTIONS));
+	worker_num_robots.assign(num_workers, 0);
+	worker_recent_timings.assign(num_workers, FrameTimings());
+	worker_halo_bytes_per_frame.assign(num_workers, 0);
+	worker_halo_bytes_sent.assign(num_workers, 0);
+	shard_sizes.assign(num_workers, 0);
+	worker_checkpoints.assign(num_workers, std::map<uint32_t, uint32_t>());
+	worker_checkpoint_shards.assign(num_workers, 0);
+	worker_leaving.assign(num_workers, false);
+	worker_traces.assign(num_workers, std::vector<ThreadTrace>());
+	straggler_detector.reset(num_workers);
 	worker_count = 0;
-	worker_connections_working.resize(args.get_num_workers(), true);
-	num_worker_connections_working = args.get_num_workers();
-	update_count = 0;
-	robots = NULL;
+	num_worker_connections_working = num_workers;
+	update_count = start_frame * num_workers;
+	last_fps_frame = start_frame;
+	current_frame = start_frame;
+	last_fps = 0;
 
 	struct timeval start;
 	gettimeofday(&start, NULL);
 	last_fps_seconds = start.tv_sec + start.tv_usec / 1e6;
-
-	if (pthread_mutex_init(&connections_mutex, NULL) != 0 || pthread_mutex_init(&synchronization, NULL) != 0) {
-		fprintf(stderr, "[Err] Failed to initialize mutexes\n");
-		exit(EXIT_FAILURE);
-	}
-
-	if (pthread_cond_init(&master_done, NULL) != 0 || pthread_cond_init(&all_worker_connections_done, NULL) != 0) {
-		fprintf(stderr, "[Err] Failed to initialize conditions\n");
-		exit(EXIT_FAILURE);
-	}
-
-	//Get synchonization lock
-	pthread_mutex_lock(&synchronization);
 }
 
 void Master::start() {
+	struct timeval start;
+	gettimeofday(&start, NULL);
 	printf("Universe Master '%s'\nWaiting for workers to join (%d)...\n", hostname, args->get_num_workers());
 
 	//Setup visualization if applicable
 	if (args->is_visualization_enabled()) {
-		visualization::start(args->get_num_blocks(), args->get_population_size());
+		visualization::start(args->get_num_blocks() / args->get_stats_pool_size(), args->get_population_size(),
+				args->get_image_output_dir());
 	}
 
-	struct sockaddr_storage new_addr;
-	socklen_t addr_len = sizeof(new_addr);
-
 	//Set the socket in non-blocking mode
 	fcntl(listen_fd, F_SETFL, O_NONBLOCK);
 
-	//Startup lobby...accepting connections
-	while (worker_count < args->get_num_workers()) {
-		int new_fd = accept(listen_fd, (sockaddr *) &new_addr, &addr_len);
-		if (new_fd < 0) {
-			usleep(100000);
-			continue;
-		}
-
-		//Set TCP no delay on socket for performance
-		if (netutils::disable_nagle_algorithm(new_fd) != 0) {
-			fprintf(stderr, "[Err] Failed to set TCP_NODELAY flag on socket\n");
+	//Serve metrics from the start, through startup & any reconfigurations
+	if (args->get_metrics_port() > 0) {
+		metrics_server = new MetricsServer(*this, args->get_metrics_port());
+		struct epoll_event event;
+		memset(&event, 0, sizeof event);
+		event.events = EPOLLIN;
+		event.data.ptr = metrics_server;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, metrics_server->get_fd(), &event) != 0) {
+			fprintf(stderr, "[Err] Failed to add metrics server to epoll\n");
 			exit(EXIT_FAILURE);
 		}
+		printf("Serving metrics on port %u\n", args->get_metrics_port());
+	}
 
-		pthread_t thread;
-		char *ip_address = new char[netutils::IP_ADDRESS_LENGTH];
-		netutils::get_ip_textual(&new_addr, ip_address);
-		WorkerConnection *wc = new WorkerConnection(new_fd, *this, ip_address, args->get_num_updates());
+	initialize_workers();
 
-#ifdef NET_DEBUG
-		printf("[NET_DEBUG] New TCP connection with '%s'\n", wc->get_ip_address());
-#endif
+	//Startup: workers joining, peer connections, parameters & robots
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	double startup_seconds = (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) / 1e6;
+	if (args->is_auto_start_enabled()) {
+		printf("Universe is ready after %.3f seconds, beginning simulation...\n", startup_seconds);
+	} else {
+		printf("Universe is ready after %.3f seconds, press enter to begin simulation...", startup_seconds);
+		std::cin.ignore();
+	}
 
-		if (pthread_create(&thread, NULL, &handle_connection, (void*) wc) != 0) {
-			fprintf(stderr, "[Err] Failed to create thread to handle connection\n");
-			exit(EXIT_FAILURE);
-		}
+	simulation_loop();
+}
+
+void Master::initialize_workers() {
+	//Startup lobby...accepting connections. Each worker connection waits on us once it has joined
+	while (worker_count < args->get_num_workers()) {
+		process_events();
+	}
+	//Everyone has connected, stop listening (elastic runs keep accepting workers, which wait to join)
+	if (!args->is_elastic_enabled()) {
+		close(listen_fd);
 	}
-	//Everyone has connected, stop listening
-	close(listen_fd);
 
 	printf("All workers have joined, initializing...\n");
 
@@ -166,171 +216,671 @@ void Master::start() {
 		worker_connections.at(i)->set_right_neighbour(*right);
 	}
 
-	//Start workers and wait until workers notify us that all neighbours are set
-	start_wait_worker_connections();
+	//Wait until every worker is listening for its left neighbour
+	wait_on_worker_connections();
+
+	//Send workers their right neighbours and wait until workers notify us that all neighbours are set
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_connections.at(i)->send_right_neighbour();
+	}
+	wait_on_worker_connections();
 
 	printf("   Peer worker connections established\n");
 
-	//Wait until workers are notified of the universe parameters
+	//Notify workers of the universe parameters and wait until they are set
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_connections.at(i)->send_universe_parameters();
+	}
 	wait_on_worker_connections();
 
 	printf("   Universe parameters set\n");
 
-	//Send each worker its robots & then wait for acks back
-	send_robots_to_workers();
-	wait_on_worker_connections();
+	//Send each worker its robots (or have them generated) & then wait for acks back. Reconfigured runs restart from
+	//a checkpoint whatever the original source
+	if (args->get_restart_manifest_path() != NULL) {
+		send_checkpoint_to_workers();
+	} else if (args->is_robot_generation_enabled()) {
+		send_robot_seed_to_workers();
+		wait_on_worker_connections();
+	} else if (args->get_population_input_path() != NULL) {
+		send_population_file_to_workers();
+	} else {
+		send_robots_to_workers();
+	}
 
-	printf("   Data structures set\nUniverse is ready, press enter to begin simulation...");
-	std::cin.ignore();
+	printf("   Data structures set\n");
+}
 
-	simulation_loop();
+void Master::request_reconfiguration() {
+	if (!simulation_running || reconfiguration_requested) {
+		return;
+	}
+
+	//Leaves go first, as long as the ring keeps at least two workers
+	bool leave_waiting = false;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		if (worker_leaving.at(i) && worker_count > 2) {
+			request_leave(i);
+			return;
+		}
+		leave_waiting = leave_waiting || worker_leaving.at(i);
+	}
+	if (waiting_connections.empty()) {
+		if (leave_waiting) {
+			printf("\nWaiting for a worker to join before one can leave (the ring needs at least 2 workers)\n");
+		}
+		return;
+	}
+
+	//A joining worker takes half of the columns of the worker with the most, in whole stats pools
+	uint32_t index = 0;
+	for (unsigned int i = 1; i < worker_count; i++) {
+		if (worker_connections.at(i)->get_num_columns() > worker_connections.at(index)->get_num_columns()) {
+			index = i;
+		}
+	}
+	if (worker_connections.at(index)->get_num_columns() < 2 * args->get_stats_pool_size()) {
+		printf("\nWaiting for a worker to leave (no worker has block columns to spare for '%s')\n",
+				waiting_connections.front()->get_ip_address());
+		return;
+	}
+	request_join(index);
 }
 
-void* Master::handle_connection(void* wc) {
-	WorkerConnection *connection = (WorkerConnection *) wc;
+void Master::request_leave(uint32_t index) {
+	WorkerConnection *leaving = worker_connections.at(index);
+	uint32_t left = (index + worker_count - 1) % worker_count;
+	uint32_t right = (index + 1) % worker_count;
 
-#ifdef THREAD_DEBUG
-	printf("[THREAD_DEBUG] Thread %lu is handling connection to '%s'\n", pthread_self(), connection->get_ip_address());
-#endif
+	//The columns go to the neighbour next to them: the left one, unless the leaving worker holds column 0
+	uint32_t receiver = leaving->get_first_column() == 0 ? right : left;
+	printf("\n   (%d) '%s' is leaving, handing block columns %u-%u to (%d)\n", index + 1, leaving->get_ip_address(),
+			leaving->get_first_column(), leaving->get_first_column() + leaving->get_num_columns() - 1, receiver + 1);
 
-	//We are expecting a JOIN message
-	std::vector<unsigned char> message;
-	protocol::recieve_message(connection->get_fd(), message);
-	if (message.at(0) != protocol::JOIN_MESSAGE) {
-		fprintf(stderr, "[Err] Received invalid message when expecting JOIN\n");
-		close(connection->get_fd());
-		return NULL;
+	//Later workers move down an id, the leaving worker's neighbours link up with each other
+	for (unsigned int i = 0; i < worker_count; i++) {
+		WorkerConnection *connection = worker_connections.at(i);
+		if (i == index) {
+			connection->send_reconfigure(0, worker_count - 1, 0, 0, false, false, worker_connections.at(receiver));
+			continue;
+		}
+		uint32_t first_column = connection->get_first_column();
+		uint32_t num_columns = connection->get_num_columns();
+		if (i == receiver) {
+			first_column = std::min(first_column, leaving->get_first_column());
+			num_columns += leaving->get_num_columns();
+		}
+		connection->send_reconfigure(i < index ? i + 1 : i, worker_count - 1, first_column, num_columns, i == right,
+				i == receiver, i == left ? worker_connections.at(right) : NULL);
+		connection->set_columns(first_column, num_columns);
+	}
+	leaving_connection = leaving;
+	reconfiguration_requested = true;
+}
+
+void Master::request_join(uint32_t index) {
+	WorkerConnection *splitting = worker_connections.at(index);
+	uint32_t stats_pool_size = args->get_stats_pool_size();
+	uint32_t num_columns = (splitting->get_num_columns() / stats_pool_size / 2) * stats_pool_size;
+
+	joining_connection = waiting_connections.front();
+	waiting_connections.erase(waiting_connections.begin());
+	joining_connection->set_listen_port(get_free_listen_port());
+	joining_connection->set_columns(splitting->get_first_column() + splitting->get_num_columns() - num_columns,
+			num_columns);
+	joining_connection->set_right_neighbour(*worker_connections.at((index + 1) % worker_count));
+	joining_connection_ready = false;
+	reconfiguration_requested = true;
+
+	//Its startup runs through the event loop alongside the simulation
+	struct epoll_event event;
+	memset(&event, 0, sizeof event);
+	event.events = EPOLLIN;
+	event.data.ptr = joining_connection;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, joining_connection->get_fd(), &event) != 0) {
+		fprintf(stderr, "[Err] Failed to add worker connection to epoll\n");
+		exit(EXIT_FAILURE);
+	}
+	joining_connection->join_running_ring(index + 2, worker_count + 1);
+	joining_connection->resume_processing();
+}
+
+void Master::joiner_listening(WorkerConnection& worker_connection) {
+	worker_connection.send_right_neighbour();
+
+	//The worker whose columns it takes connects to it, later workers move up an id
+	uint32_t index = worker_connection.get_id() - 2;
+	uint32_t right = (index + 1) % worker_count;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		WorkerConnection *connection = worker_connections.at(i);
+		uint32_t num_columns = connection->get_num_columns();
+		if (i == index) {
+			num_columns -= worker_connection.get_num_columns();
+		}
+		connection->send_reconfigure(i <= index ? i + 1 : i + 2, worker_count + 1, connection->get_first_column(),
+				num_columns, i == right, false, i == index ? &worker_connection : NULL);
+		connection->set_columns(connection->get_first_column(), num_columns);
+	}
+}
+
+void Master::joiner_ready(WorkerConnection& worker_connection) {
+	worker_connection.start_simulation();
+	worker_connection.suspend_processing();
+	set_connection_events(worker_connection, 0);
+	joining_connection_ready = true;
+}
+
+void Master::reconfigured(WorkerConnection& worker_connection, uint32_t frame) {
+	if (!reconfiguration_requested || (num_reconfigured > 0 && frame != reconfiguration_frame)) {
+		fprintf(stderr, "[Err] Worker '%s'(%d) reconfigured unexpectedly after frame %u\n",
+				worker_connection.get_ip_address(), worker_connection.get_id(), frame);
+		exit(EXIT_FAILURE);
+	}
+	reconfiguration_frame = frame;
+	num_reconfigured++;
+
+	//The leaving worker disconnects
+	if (&worker_connection == leaving_connection) {
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, worker_connection.get_fd(), NULL) != 0) {
+			fprintf(stderr, "[Err] Failed to remove worker connection from epoll\n");
+			exit(EXIT_FAILURE);
+		}
+	} else {
+		set_connection_events(worker_connection, 0);
+	}
+}
+
+void Master::complete_reconfiguration() {
+	uint32_t frame = reconfiguration_frame;
+	uint32_t previous_num_workers = worker_count;
+	if (joining_connection != NULL) {
+		uint32_t index = joining_connection->get_id() - 1;
+		worker_connections.insert(worker_connections.begin() + index, joining_connection);
+		insert_worker_state(index, frame);
+		worker_count++;
+		num_worker_connections_working++;
 	}
+	if (leaving_connection != NULL) {
+		uint32_t index = leaving_connection->get_id() - 1;
+
+		//Its shard of the checkpoint in the manifest is removed once the manifest has moved on
+		if (worker_checkpoint_shards.at(index) > 0) {
+			orphaned_checkpoint_shards.push_back(std::make_pair(checkpoint_frame, worker_checkpoint_shards.at(index)));
+		}
+		worker_connections.erase(worker_connections.begin() + index);
+		erase_worker_state(index);
+		close(leaving_connection->get_fd());
+		delete leaving_connection;
+		worker_count--;
+		num_worker_connections_working--;
+	}
+
+	//The new ring's ids & neighbours, carrying on from the frame
+	args->set_num_workers(worker_count);
+	straggler_detector.reset(worker_count);
+	for (unsigned int i = 0; i < worker_count; i++) {
+		WorkerConnection *connection = worker_connections.at(i);
+		connection->set_id(i + 1);
+		connection->set_right_neighbour(*worker_connections.at((i + 1) % worker_count));
+		connection->resume_simulation(frame);
+		straggler_detector.set_worker_name(i + 1, connection->get_ip_address());
+	}
+	update_count = frame * worker_count;
+	printf("\nReconfigured after frame %u: %u workers (was %u)\n", frame, worker_count, previous_num_workers);
+
+	joining_connection = NULL;
+	leaving_connection = NULL;
+	num_reconfigured = 0;
+	reconfiguration_requested = false;
+
+	//Messages received in the meantime are handled as the connections resume
+	for (unsigned int i = 0; i < worker_count; i++) {
+		WorkerConnection *connection = worker_connections.at(i);
+		set_connection_events(*connection, connection->has_outgoing() ? EPOLLIN | EPOLLOUT : EPOLLIN);
+		connection->resume_processing();
+	}
+	request_reconfiguration();
+}
+
+void Master::insert_worker_state(uint32_t index, uint32_t frames) {
+	slowest_connection_count.insert(slowest_connection_count.begin() + index, 0);
+	worker_completed_frames.insert(worker_completed_frames.begin() + index, frames);
+	worker_phase_timings.insert(worker_phase_timings.begin() + index, FrameTimings());
+	worker_message_stats.insert(worker_message_stats.begin() + index,
+			std::vector<MessageStats>(MessageStats::NUM_CONNECTIONS));
+	worker_num_robots.insert(worker_num_robots.begin() + index, 0);
+	worker_recent_timings.insert(worker_recent_timings.begin() + index, FrameTimings());
+	worker_halo_bytes_per_frame.insert(worker_halo_bytes_per_frame.begin() + index, 0);
+	worker_halo_bytes_sent.insert(worker_halo_bytes_sent.begin() + index, 0);
+	shard_sizes.insert(shard_sizes.begin() + index, 0);
+	worker_checkpoints.insert(worker_checkpoints.begin() + index, std::map<uint32_t, uint32_t>());
+	worker_checkpoint_shards.insert(worker_checkpoint_shards.begin() + index, 0);
+	worker_leaving.insert(worker_leaving.begin() + index, false);
+	worker_traces.insert(worker_traces.begin() + index, std::vector<ThreadTrace>());
+}
+
+void Master::erase_worker_state(uint32_t index) {
+	slowest_connection_count.erase(slowest_connection_count.begin() + index);
+	worker_completed_frames.erase(worker_completed_frames.begin() + index);
+	worker_phase_timings.erase(worker_phase_timings.begin() + index);
+	worker_message_stats.erase(worker_message_stats.begin() + index);
+	worker_num_robots.erase(worker_num_robots.begin() + index);
+	worker_recent_timings.erase(worker_recent_timings.begin() + index);
+	worker_halo_bytes_per_frame.erase(worker_halo_bytes_per_frame.begin() + index);
+	worker_halo_bytes_sent.erase(worker_halo_bytes_sent.begin() + index);
+	shard_sizes.erase(shard_sizes.begin() + index);
+	worker_checkpoints.erase(worker_checkpoints.begin() + index);
+	worker_checkpoint_shards.erase(worker_checkpoint_shards.begin() + index);
+	worker_leaving.erase(worker_leaving.begin() + index);
+	worker_traces.erase(worker_traces.begin() + index);
+}
+
+uint32_t Master::get_free_listen_port() {
+	uint32_t listen_port = protocol::BASE_NEIGHBOUR_PORT + 1;
+	bool taken = true;
+	while (taken) {
+		taken = false;
+		for (unsigned int i = 0; i < worker_count && !taken; i++) {
+			if (worker_connections.at(i)->get_listen_port() == listen_port) {
+				taken = true;
+				listen_port++;
+			}
+		}
+	}
+	return listen_port;
+}
+
+void Master::accept_worker_connections() {
+	struct sockaddr_storage new_addr;
+	socklen_t addr_len = sizeof(new_addr);
+
+	while (true) {
+		int new_fd = accept(listen_fd, (sockaddr *) &new_addr, &addr_len);
+		if (new_fd < 0) {
+			//EAGAIN/EWOULDBLOCK: No more pending connections
+			return;
+		}
+
+		//Set TCP no delay on socket for performance
+		if (netutils::disable_nagle_algorithm(new_fd) != 0) {
+			fprintf(stderr, "[Err] Failed to set TCP_NODELAY flag on socket\n");
+			exit(EXIT_FAILURE);
+		}
+
+		char *ip_address = new char[netutils::IP_ADDRESS_LENGTH];
+		netutils::get_ip_textual(&new_addr, ip_address);
+		WorkerConnection *wc = new WorkerConnection(new_fd, *this, ip_address, args->get_num_updates());
+
 #ifdef NET_DEBUG
-	printf("[NET_DEBUG] Received 'JOIN' message from '%s'\n", connection->get_ip_address());
+		printf("[NET_DEBUG] New TCP connection with '%s'\n", wc->get_ip_address());
 #endif
 
-	//Get this worker's ID
-	int id = connection->get_master().worker_joined(*connection);
-	connection->set_id(id);
+		struct epoll_event event;
+		memset(&event, 0, sizeof event);
+		event.events = EPOLLIN;
+		event.data.ptr = wc;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, new_fd, &event) != 0) {
+			fprintf(stderr, "[Err] Failed to add worker connection to epoll\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+void Master::process_events() {
+	struct epoll_event events[MAX_EPOLL_EVENTS];
 
-	//Send JOIN_ACK back
-	message.resize(9);
-	message.at(0) = protocol::JOIN_ACK_MESSAGE;
-	netutils::insert_uint32_into_message(id, &message[1]);
-	netutils::insert_uint32_into_message(connection->get_master().get_args().get_num_workers(), &message[5]);
+	int num_events = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, -1);
+	if (num_events < 0) {
+		if (errno == EINTR) {
+			return;
+		}
+		fprintf(stderr, "[Err] Failed waiting on epoll events\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < num_events; i++) {
+		if (events[i].data.ptr == NULL) {
+			accept_worker_connections();
+			continue;
+		}
+		if (events[i].data.ptr == metrics_server) {
+			metrics_server->handle_events();
+			continue;
+		}
+
+		WorkerConnection *connection = (WorkerConnection *) events[i].data.ptr;
+		if (events[i].events & EPOLLOUT) {
+			if (connection->handle_outgoing() != 0) {
+				fprintf(stderr, "[Err] Failed to send message to '%s'(%d)\n", connection->get_ip_address(),
+						connection->get_id());
+				exit(EXIT_FAILURE);
+			}
+			if (!connection->has_outgoing()) {
+				set_connection_events(*connection, EPOLLIN);
+			}
+			if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+				continue;
+			}
+		}
+
+		int result = connection->handle_incoming();
+		if (result > 0) {
+			continue;
+		}
+
+		//Connections that never joined (or were rejected from a full lobby) are simply dropped
+		if (connection->get_id() == 0) {
 #ifdef NET_DEBUG
-	printf("[NET_DEBUG] Sending 'JOIN_ACK' message back to '%s'(%d)\n", connection->get_ip_address(), id);
+			printf("[NET_DEBUG] Dropping connection with '%s'\n", connection->get_ip_address());
 #endif
-	protocol::send_message(connection->get_fd(), message);
-
-	printf("   (%d) '%s' has joined\n", id, connection->get_ip_address());
+			close(connection->get_fd());
+			delete connection;
+			continue;
+		}
 
-	//This is now a functioning worker connection, start it
-	connection->start();
+		if (result == 0) {
+			fprintf(stderr, "[Err] Worker '%s'(%d) closed the connection\n", connection->get_ip_address(),
+					connection->get_id());
+		} else {
+			fprintf(stderr, "[Err] Failed retrieving message from socket\n");
+		}
+		exit(EXIT_FAILURE);
+	}
+}
 
-	close(connection->get_fd());
-	return NULL;
+void Master::set_connection_events(WorkerConnection& worker_connection, uint32_t events) {
+	struct epoll_event event;
+	memset(&event, 0, sizeof event);
+	event.events = events;
+	event.data.ptr = &worker_connection;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, worker_connection.get_fd(), &event) != 0) {
+		fprintf(stderr, "[Err] Failed to modify epoll events of worker connection\n");
+		exit(EXIT_FAILURE);
+	}
 }
 
 uint32_t Master::worker_joined(WorkerConnection& worker_connection) {
-	pthread_mutex_lock(&connections_mutex);
+	if (worker_count == args->get_num_workers()) {
+		return 0;
+	}
 	worker_connections.push_back(&worker_connection);
-	uint32_t id = ++worker_count;
-	pthread_mutex_unlock(&connections_mutex);
-	return id;
+	straggler_detector.set_worker_name(worker_count + 1, worker_connection.get_ip_address());
+
+	//Listen ports follow the ids & the columns are split evenly at startup
+	uint32_t num_columns = args->get_num_blocks() / args->get_num_workers();
+	worker_connection.set_listen_port(protocol::BASE_NEIGHBOUR_PORT + worker_count + 1);
+	worker_connection.set_columns(worker_count * num_columns, num_columns);
+	return ++worker_count;
 }
 
-void Master::start_wait_worker_connections() {
-#ifdef THREAD_DEBUG
-	printf("[THREAD_DEBUG] Master (%lu): Finished task, signaling worker connections and sleeping...\n", pthread_self());
-#endif
-	num_worker_connections_working = args->get_num_workers();
-	std::fill(worker_connections_working.begin(), worker_connections_working.end(), true);
-	pthread_cond_broadcast(&master_done);
+void Master::wait_on_worker_connections() {
+	num_worker_connections_working = worker_count;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		WorkerConnection *connection = worker_connections.at(i);
+		set_connection_events(*connection, connection->has_outgoing() ? EPOLLIN | EPOLLOUT : EPOLLIN);
+		connection->resume_processing();
+	}
 	while (num_worker_connections_working > 0) {
-		pthread_cond_wait(&all_worker_connections_done, &synchronization);
+		process_events();
+
+		//Outside of any message handling, as connections may be resumed
+		if (reconfiguration_pending) {
+			reconfiguration_pending = false;
+			request_reconfiguration();
+		}
+		if (reconfiguration_requested && num_reconfigured == worker_count
+				&& (joining_connection == NULL || joining_connection_ready)) {
+			complete_reconfiguration();
+		}
 	}
-#ifdef THREAD_DEBUG
-	printf("[THREAD_DEBUG] Master (%lu): Worker connections finished tasks, resuming...\n", pthread_self());
-#endif
-	pthread_mutex_unlock(&synchronization);
 }
 
-void Master::wait_on_worker_connections() {
-	pthread_mutex_lock(&synchronization);
-	start_wait_worker_connections();
+void Master::wait_on_master(WorkerConnection& worker_connection) {
+	worker_connection.suspend_processing();
+	set_connection_events(worker_connection, 0);
+	num_worker_connections_working--;
 }
 
-void Master::wait_on_master(uint32_t id) {
-
-	pthread_mutex_lock(&synchronization);
-	worker_connections_working.at(id - 1) = false;
-	num_worker_connections_working--;
-	if (num_worker_connections_working == 0) {
-#ifdef THREAD_DEBUG
-		printf("[THREAD_DEBUG] WorkerConnection (%lu): Finished task. Signaling master and sleeping...\n", pthread_self());
-#endif
-		pthread_cond_signal(&all_worker_connections_done);
-	} else {
-#ifdef THREAD_DEBUG
-		printf("[THREAD_DEBUG] WorkerConnection (%lu): Finished task, sleeping...\n", pthread_self());
-#endif
-	}
-	while (!worker_connections_working.at(id - 1)) {
-		pthread_cond_wait(&master_done, &synchronization);
+void Master::wait_to_join(WorkerConnection& worker_connection) {
+	worker_connection.suspend_processing();
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, worker_connection.get_fd(), NULL) != 0) {
+		fprintf(stderr, "[Err] Failed to remove worker connection from epoll\n");
+		exit(EXIT_FAILURE);
 	}
-#ifdef THREAD_DEBUG
-	printf("[THREAD_DEBUG] WorkerConnection (%lu): Master finished task, resuming...\n", pthread_self());
-#endif
-	pthread_mutex_unlock(&synchronization);
+	waiting_connections.push_back(&worker_connection);
+	printf("\n   '%s' is waiting to join\n", worker_connection.get_ip_address());
+	reconfiguration_pending = true;
 }
 
-void Master::get_and_release_lock() {
-	pthread_mutex_lock(&synchronization);
-	pthread_mutex_unlock(&synchronization);
+void Master::leave_requested(uint32_t id) {
+	worker_leaving.at(id - 1) = true;
+	printf("\n   (%d) '%s' is waiting to leave\n", id, worker_connections.at(id - 1)->get_ip_address());
+	reconfiguration_pending = true;
 }
 
 void Master::send_robots_to_workers() {
-	robots = new std::vector<Robot>(args->get_population_size());
-	std::vector<Robot*> worker_robots[worker_count];
+	//Only held until every worker has its robots
+	std::vector<Robot> robots(args->get_population_size());
 	uint32_t slice_size = args->get_worker_slice_size();
 
-	//Add each robots to the correct worker collection
-	for (unsigned int i = 0; i < robots->size(); i++) {
-		for (unsigned int j = 0; j < worker_count; j++) {
-			uint32_t x_position = robots->at(i).get_x_position();
-			if (x_position >= j * slice_size && x_position < (j + 1) * slice_size) {
-				worker_robots[j].push_back(&robots->at(i));
-				break;
+	RobotStream empty_stream = { std::vector<Robot*>(), std::vector<RecordRange>(), 0, 0, 0, 0, false, false };
+	robot_streams.assign(worker_count, empty_stream);
+
+	//Add each robot to the correct worker stream
+	for (unsigned int i = 0; i < robots.size(); i++) {
+		uint32_t x_position = robots.at(i).get_x_position();
+		uint32_t worker_index = x_position / slice_size;
+		if (worker_index < worker_count) {
+			robot_streams.at(worker_index).robots.push_back(&robots.at(i));
+		}
+	}
+
+	//Save the initial population if requested
+	if (args->get_population_output_path() != NULL) {
+		std::vector<Robot*> all_robots(robots.size());
+		for (unsigned int i = 0; i < robots.size(); i++) {
+			all_robots.at(i) = &robots.at(i);
+		}
+		if (PopulationFile::write(args->get_population_output_path(), args->get_world_size(), args->get_num_blocks(), 0,
+				all_robots) != 0) {
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	stream_robots_to_workers();
+}
+
+void Master::stream_robots_to_workers() {
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_connections.at(i)->start_sending_robots();
+	}
+	wait_on_worker_connections();
+
+	robot_streams.clear();
+	for (unsigned int i = 0; i < population_files.size(); i++) {
+		delete population_files.at(i);
+	}
+	population_files.clear();
+}
+
+bool Master::next_robots_chunk(uint32_t id, std::vector<unsigned char> &message) {
+	RobotStream &stream = robot_streams.at(id - 1);
+	if (stream.finished) {
+		return false;
+	}
+
+	message.resize(13 + (ROBOTS_PER_CHUNK * Robot::LONG_SERIALIZED_LENGTH));
+	unsigned char *robot_location = &message[13];
+	uint32_t num_robots = 0;
+	if (stream.record_ranges.empty()) {
+		while (num_robots < ROBOTS_PER_CHUNK && stream.next < stream.robots.size()) {
+			stream.robots.at(stream.next++)->serialize_long(robot_location);
+			robot_location += Robot::LONG_SERIALIZED_LENGTH;
+			num_robots++;
+		}
+		stream.finished = stream.next == stream.robots.size();
+	} else {
+		//Copy records straight from the population files, one range after another
+		while (num_robots < ROBOTS_PER_CHUNK && stream.range < stream.record_ranges.size()) {
+			RecordRange &range = stream.record_ranges.at(stream.range);
+			if (stream.next == range.num_records) {
+				stream.range++;
+				stream.next = 0;
+				continue;
 			}
+			unsigned char *record = range.records + ((uint64_t) stream.next++ * Robot::LONG_SERIALIZED_LENGTH);
+			int32_t x_position = Robot::get_x_position_from_serialized(record);
+			if (x_position >= stream.slice_start && (x_position < stream.slice_end || stream.last_slice)) {
+				memcpy(robot_location, record, Robot::LONG_SERIALIZED_LENGTH);
+				robot_location += Robot::LONG_SERIALIZED_LENGTH;
+				num_robots++;
+			}
+		}
+		while (stream.range < stream.record_ranges.size()
+				&& stream.next == stream.record_ranges.at(stream.range).num_records) {
+			stream.range++;
+			stream.next = 0;
 		}
+		stream.finished = stream.range == stream.record_ranges.size();
 	}
 
-	//Create & send each message to worker
-	std::vector<unsigned char> message;
+	uint32_t message_size = 13 + (num_robots * Robot::LONG_SERIALIZED_LENGTH);
+	message.resize(message_size);
+	netutils::insert_uint32_into_message(message_size - 4, &message[0]);
+	message.at(4) = protocol::SET_ROBOTS_MESSAGE;
+	netutils::insert_uint32_into_message(num_robots, &message[5]);
+	netutils::insert_uint32_into_message(stream.finished ? 1 : 0, &message[9]);
+	return true;
+}
+
+void Master::send_robot_seed_to_workers() {
+	std::vector<unsigned char> message(9);
+	message.at(0) = protocol::GENERATE_ROBOTS_MESSAGE;
+	netutils::insert_uint32_into_message(args->get_population_size(), &message[1]);
+	netutils::insert_uint32_into_message(args->get_robot_seed(), &message[5]);
 	for (unsigned int i = 0; i < worker_count; i++) {
-		message.resize(5 + (worker_robots[i].size() * Robot::LONG_SERIALIZED_LENGTH));
-		message.at(0) = protocol::SET_ROBOTS_MESSAGE;
-		netutils::insert_uint32_into_message(worker_robots[i].size(), &message[1]);
-		for (unsigned int j = 0; j < worker_robots[i].size(); j++) {
-			worker_robots[i].at(j)->serialize_long(&message[5 + (j * Robot::LONG_SERIALIZED_LENGTH)]);
+		worker_connections.at(i)->send_to_worker(message);
+	}
+}
+
+void Master::send_population_file_to_workers() {
+	std::vector<unsigned char> message;
+	if (args->is_population_input_shared()) {
+		const char *path = args->get_population_input_path();
+		uint32_t path_length = strlen(path);
+		message.resize(5 + path_length);
+		message.at(0) = protocol::LOAD_ROBOTS_MESSAGE;
+		netutils::insert_uint32_into_message(path_length, &message[1]);
+		memcpy(&message[5], path, path_length);
+		for (unsigned int i = 0; i < worker_count; i++) {
+			worker_connections.at(i)->send_to_worker(message);
+		}
+		wait_on_worker_connections();
+		return;
+	}
+
+	std::vector<std::string> paths(1, args->get_population_input_path());
+	stream_population_files(paths);
+}
+
+void Master::send_checkpoint_to_workers() {
+	const char *manifest_path = args->get_restart_manifest_path();
+	Manifest manifest;
+	if (manifest.read(manifest_path) != 0) {
+		exit(EXIT_FAILURE);
+	}
+	std::vector<std::string> paths;
+	for (unsigned int i = 0; i < manifest.shard_names.size(); i++) {
+		paths.push_back(manifest.get_shard_path(manifest_path, i));
+	}
+	stream_population_files(paths);
+}
+
+void Master::stream_population_files(std::vector<std::string> &paths) {
+	for (unsigned int i = 0; i < paths.size(); i++) {
+		PopulationFile *population_file = new PopulationFile();
+		if (population_file->open(paths.at(i).c_str()) != 0) {
+			exit(EXIT_FAILURE);
 		}
-		protocol::send_message(worker_connections.at(i)->get_fd(), message);
+		population_files.push_back(population_file);
 	}
 
+	//Stream the records of each worker's columns from each file (files are sorted by column)
+	int32_t slice_size = args->get_worker_slice_size();
+	RobotStream empty_stream = { std::vector<Robot*>(), std::vector<RecordRange>(), 0, 0, 0, 0, false, false };
+	robot_streams.assign(worker_count, empty_stream);
+	for (unsigned int i = 0; i < worker_count; i++) {
+		RobotStream &stream = robot_streams.at(i);
+		stream.slice_start = slice_size * i;
+		stream.slice_end = slice_size * (i + 1);
+		stream.last_slice = i == worker_count - 1;
+		for (unsigned int j = 0; j < population_files.size(); j++) {
+			RecordRange range;
+			range.records = population_files.at(j)->get_records_overlapping(stream.slice_start, stream.slice_end,
+					range.num_records);
+			stream.record_ranges.push_back(range);
+		}
+	}
+	stream_robots_to_workers();
 }
 
 void Master::simulation_loop() {
 	struct timeval now;
 	gettimeofday(&now, NULL);
 	double start_seconds = now.tv_sec + now.tv_usec / 1e6;
+	uint32_t start_frame = args->get_start_frame();
+#ifdef PROFILE_HOOKS
+	profiling::Counts profile_start = profiling::get_counts();
+#endif
 
-	// Let worker connections run until we reach our frame limit (if applicable)
+	// Let worker connections run until we reach our frame limit (if applicable), splicing workers into & out of the
+	// running ring as they join or leave
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_connections.at(i)->start_simulation();
+	}
+	simulation_running = true;
+	request_reconfiguration();
 	wait_on_worker_connections();
+	simulation_running = false;
+
+#ifdef PROFILE_HOOKS
+	profiling::Counts profile_end = profiling::get_counts();
+#endif
 
 	// Get the elapsed time
 	gettimeofday(&now, NULL);
 	double seconds = now.tv_sec + now.tv_usec / 1e6;
 	double elapsed_seconds = seconds - start_seconds;
 
-	dump_robot_positions();
+	if (args->get_positions_output_dir() != NULL) {
+		write_positions_manifest();
+	} else {
+		dump_robot_positions();
+	}
+	if (args->is_visualization_enabled()) {
+		visualization::finish();
+	}
+	if (args->is_tracing_enabled()) {
+		write_trace();
+	}
 	printf("\nAll done. Elapsed time: %.2f seconds\n", elapsed_seconds);
+	if (args->get_num_updates() > 0) {
+		printf("Average FPS: %.1f\n", (args->get_num_updates() - start_frame) / elapsed_seconds);
+	}
+	if (checkpoint_frame > 0) {
+		printf("Last consistent checkpoint: frame %u ('%s/%s')\n", checkpoint_frame, args->get_checkpoint_dir(),
+				CHECKPOINT_MANIFEST_FILE);
+	}
+
+	if (args->is_progress_reporting_enabled()) {
+		print_phase_timings();
+	}
+	straggler_detector.print_summary();
+	print_message_stats();
+#ifdef PROFILE_HOOKS
+	printf("Allocations & locks over the simulation:\n");
+	profiling::print_counts(profile_start, profile_end, current_frame - start_frame);
+#endif
 
 	// Show worker debug info if applicable
 	if (args->is_worker_debug_enabled()) {
@@ -342,42 +892,375 @@ void Master::simulation_loop() {
 	}
 }
 
-void Master::frame_completed(uint32_t id) {
-	pthread_mutex_lock(&connections_mutex);
+void Master::frame_completed(uint32_t id, uint64_t compute_ns) {
+	straggler_detector.frame_finished(id, FrameTimings::get_monotonic_nanoseconds(), compute_ns);
 	update_count++;
 	if (update_count % args->get_num_workers() == 0) {
-		uint32_t num_updates = update_count / args->get_num_workers();
-		if (num_updates % UPDATE_FRAME_COUNT_PERIOD == 0) {
-			struct timeval now;
-			gettimeofday(&now, NULL);
-			double seconds = now.tv_sec + now.tv_usec / 1e6;
-			double interval = seconds - last_fps_seconds;
-			printf("[%d] FPS %.1f\r", num_updates, UPDATE_FRAME_COUNT_PERIOD / interval);
-			fflush(stdout);
-			last_fps_seconds = seconds;
-		}
+		report_frames_completed(update_count / args->get_num_workers());
 
 		//Update worker debugging info if enabled
 		if (args->is_worker_debug_enabled()) {
-			slowest_connection_count.at(id - 1) ++;}
+			slowest_connection_count.at(id - 1)++;
+		}
+	}
+}
+
+void Master::frames_completed(uint32_t num_frames) {
+	report_frames_completed(num_frames);
+}
+
+void Master::progress_reported(uint32_t id, uint32_t completed_frames, uint32_t num_robots, const FrameTimings &timings,
+		const MessageStats *message_stats) {
+	worker_completed_frames.at(id - 1) = completed_frames;
+	worker_phase_timings.at(id - 1).add(timings);
+	worker_recent_timings.at(id - 1) = timings;
+	worker_num_robots.at(id - 1) = num_robots;
+	straggler_detector.progress_reported(id, timings);
+	for (int connection = 0; connection < MessageStats::NUM_CONNECTIONS; connection++) {
+		worker_message_stats.at(id - 1).at(connection) = message_stats[connection];
+	}
+
+	//Halo traffic sent to both neighbours over the frames of this record
+	uint64_t halo_bytes_sent = 0;
+	for (int connection = MessageStats::LEFT_CONNECTION; connection <= MessageStats::RIGHT_CONNECTION; connection++) {
+		halo_bytes_sent += message_stats[connection].get_counters(protocol::GHOST_STRIP_MESSAGE).bytes_sent
+				+ message_stats[connection].get_counters(protocol::ADD_ROBOTS_MESSAGE).bytes_sent;
+	}
+	if (timings.get_num_frames() > 0) {
+		worker_halo_bytes_per_frame.at(id - 1) = (double) (halo_bytes_sent - worker_halo_bytes_sent.at(id - 1))
+				/ timings.get_num_frames();
+	}
+	worker_halo_bytes_sent.at(id - 1) = halo_bytes_sent;
+
+	//Frames completed by every worker
+	uint32_t min_completed_frames = completed_frames;
+	for (unsigned int i = 0; i < worker_completed_frames.size(); i++) {
+		if (worker_completed_frames.at(i) < min_completed_frames) {
+			min_completed_frames = worker_completed_frames.at(i);
+		}
+	}
+	report_frames_completed(min_completed_frames);
+}
+
+void Master::print_phase_timings() {
+	printf("Worker phase timings (ms per frame, percentiles are histogram bucket upper bounds):\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		FrameTimings &timings = worker_phase_timings.at(i);
+		uint32_t num_frames = timings.get_num_frames();
+		if (num_frames == 0) {
+			continue;
+		}
+
+		//Everything but waiting on neighbours is the worker's own work (including preparing & adding halos)
+		uint64_t compute_ns = 0;
+		for (int phase = 0; phase < FrameTimings::NUM_PHASES; phase++) {
+			if (phase != FrameTimings::HALO_PEER_WAIT) {
+				compute_ns += timings.get_total_ns((FrameTimings::Phase) phase);
+			}
+		}
+		uint64_t peer_wait_ns = timings.get_total_ns(FrameTimings::HALO_PEER_WAIT);
+		printf("   %s (%u), %u frames: computing %.3f, waiting on neighbours %.3f (%s)\n",
+				worker_connections.at(i)->get_ip_address(), i + 1, num_frames, compute_ns / 1e6 / num_frames,
+				peer_wait_ns / 1e6 / num_frames, peer_wait_ns > compute_ns ? "network bound" : "compute bound");
+		for (int phase = 0; phase < FrameTimings::NUM_PHASES; phase++) {
+			FrameTimings::Phase timed_phase = (FrameTimings::Phase) phase;
+			printf("      %-20s mean %9.3f   p50 <= %9.3f   p99 <= %9.3f\n", FrameTimings::get_phase_name(timed_phase),
+					timings.get_total_ns(timed_phase) / 1e6 / num_frames,
+					timings.get_percentile_us(timed_phase, 0.5) / 1e3, timings.get_percentile_us(timed_phase, 0.99) / 1e3);
+		}
+	}
+}
+
+void Master::print_message_stats() {
+	uint32_t num_frames = args->get_num_updates() > 0 ? args->get_num_updates() - args->get_start_frame() : 0;
+
+	MessageStats connection_stats;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		connection_stats.add(worker_connections.at(i)->get_stats());
+	}
+	printf("Messages exchanged with the workers (means per message in microseconds):\n");
+	connection_stats.print("   ", num_frames);
+
+	if (!args->is_progress_reporting_enabled()) {
+		return;
+	}
+	for (int connection = 0; connection < MessageStats::NUM_CONNECTIONS; connection++) {
+		MessageStats worker_stats;
+		for (unsigned int i = 0; i < worker_count; i++) {
+			worker_stats.add(worker_message_stats.at(i).at(connection));
+		}
+		printf("Messages exchanged by the workers with their %s (all workers, as last reported):\n",
+				MessageStats::get_connection_name((MessageStats::Connection) connection));
+		worker_stats.print("   ", num_frames);
+	}
+}
+
+//Appends a formatted line to the metrics
+static void append_metric(std::string &metrics, const char *format, ...) {
+	char line[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(line, sizeof line, format, args);
+	va_end(args);
+	metrics += line;
+}
+
+void Master::write_metrics(std::string &metrics) {
+	static const double QUANTILES[] = { 0.5, 0.95, 0.99 };
+
+	append_metric(metrics, "# HELP universe_workers Number of workers in the run\n# TYPE universe_workers gauge\n");
+	append_metric(metrics, "universe_workers %u\n", args->get_num_workers());
+	append_metric(metrics, "# HELP universe_workers_joined Number of workers that have joined\n"
+			"# TYPE universe_workers_joined gauge\n");
+	append_metric(metrics, "universe_workers_joined %u\n", worker_count);
+	append_metric(metrics, "# HELP universe_simulation_running Is the simulation running\n"
+			"# TYPE universe_simulation_running gauge\n");
+	append_metric(metrics, "universe_simulation_running %d\n", simulation_running ? 1 : 0);
+	append_metric(metrics, "# HELP universe_frame Frames completed by every worker\n# TYPE universe_frame gauge\n");
+	append_metric(metrics, "universe_frame %u\n", current_frame);
+	append_metric(metrics, "# HELP universe_frames_per_second Frames per second over the last %d frames\n"
+			"# TYPE universe_frames_per_second gauge\n", UPDATE_FRAME_COUNT_PERIOD);
+	append_metric(metrics, "universe_frames_per_second %.3f\n", last_fps);
+
+	std::vector<std::string> labels(worker_count);
+	for (unsigned int i = 0; i < worker_count; i++) {
+		labels.at(i) = "worker=\"" + std::to_string(i + 1) + "\",host=\"" + worker_connections.at(i)->get_ip_address()
+				+ "\"";
+	}
+	append_metric(metrics, "# HELP universe_worker_ring_stall_seconds_total Time the worker held up the ring, finishing "
+			"frames last\n# TYPE universe_worker_ring_stall_seconds_total counter\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		append_metric(metrics, "universe_worker_ring_stall_seconds_total{%s} %.6f\n", labels.at(i).c_str(),
+				straggler_detector.get_stall_ns(i + 1) / 1e9);
+	}
+	append_metric(metrics, "# HELP universe_worker_straggler Is the worker flagged as a persistent straggler\n"
+			"# TYPE universe_worker_straggler gauge\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		append_metric(metrics, "universe_worker_straggler{%s} %d\n", labels.at(i).c_str(),
+				straggler_detector.is_flagged(i + 1) ? 1 : 0);
+	}
+	if (!args->is_progress_reporting_enabled()) {
+		return;
+	}
+
+	//Per worker metrics, from the latest PROGRESS record of each worker that has sent one
+	append_metric(metrics, "# HELP universe_worker_frame Frames completed by the worker\n"
+			"# TYPE universe_worker_frame gauge\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		append_metric(metrics, "universe_worker_frame{%s} %u\n", labels.at(i).c_str(), worker_completed_frames.at(i));
+	}
+	append_metric(metrics, "# HELP universe_worker_robots Robots owned by the worker\n"
+			"# TYPE universe_worker_robots gauge\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		append_metric(metrics, "universe_worker_robots{%s} %u\n", labels.at(i).c_str(), worker_num_robots.at(i));
+	}
+	append_metric(metrics, "# HELP universe_worker_frame_seconds Worker frame times, quantiles over its last progress "
+			"record (histogram bucket upper bounds)\n# TYPE universe_worker_frame_seconds summary\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		FrameTimings &recent_timings = worker_recent_timings.at(i);
+		if (recent_timings.get_num_frames() > 0) {
+			for (unsigned int q = 0; q < sizeof QUANTILES / sizeof QUANTILES[0]; q++) {
+				append_metric(metrics, "universe_worker_frame_seconds{%s,quantile=\"%g\"} %.6f\n", labels.at(i).c_str(),
+						QUANTILES[q], recent_timings.get_frame_percentile_us(QUANTILES[q]) / 1e6);
+			}
 		}
+		FrameTimings &timings = worker_phase_timings.at(i);
+		append_metric(metrics, "universe_worker_frame_seconds_sum{%s} %.6f\n", labels.at(i).c_str(),
+				timings.get_frame_total_ns() / 1e9);
+		append_metric(metrics, "universe_worker_frame_seconds_count{%s} %u\n", labels.at(i).c_str(),
+				timings.get_num_frames());
+	}
 
-pthread_mutex_unlock	(&connections_mutex);
+	//Everything but waiting on neighbours is the worker's own work
+	std::vector<double> compute_seconds(worker_count, 0);
+	append_metric(metrics, "# HELP universe_worker_compute_seconds_per_frame Worker time per frame not spent waiting on "
+			"its neighbours, over its last progress record\n# TYPE universe_worker_compute_seconds_per_frame gauge\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		FrameTimings &recent_timings = worker_recent_timings.at(i);
+		if (recent_timings.get_num_frames() == 0) {
+			continue;
+		}
+		uint64_t compute_ns = recent_timings.get_frame_total_ns()
+				- recent_timings.get_total_ns(FrameTimings::HALO_PEER_WAIT);
+		compute_seconds.at(i) = compute_ns / 1e9 / recent_timings.get_num_frames();
+		append_metric(metrics, "universe_worker_compute_seconds_per_frame{%s} %.6f\n", labels.at(i).c_str(),
+				compute_seconds.at(i));
+	}
+	append_metric(metrics, "# HELP universe_worker_halo_bytes_per_frame Halo bytes sent per frame to both neighbours, "
+			"over the worker's last progress record\n# TYPE universe_worker_halo_bytes_per_frame gauge\n");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		append_metric(metrics, "universe_worker_halo_bytes_per_frame{%s} %.1f\n", labels.at(i).c_str(),
+				worker_halo_bytes_per_frame.at(i));
+	}
+
+	//The slowest worker holds up the ring, relative to an even split of the work
+	double max_compute_seconds = 0;
+	double total_compute_seconds = 0;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		max_compute_seconds = std::max(max_compute_seconds, compute_seconds.at(i));
+		total_compute_seconds += compute_seconds.at(i);
+	}
+	append_metric(metrics, "# HELP universe_imbalance_ratio Slowest worker's compute time per frame over the mean of the "
+			"workers' (1: balanced)\n# TYPE universe_imbalance_ratio gauge\n");
+	append_metric(metrics, "universe_imbalance_ratio %.4f\n",
+			total_compute_seconds > 0 ? max_compute_seconds * worker_count / total_compute_seconds : 0.0);
+}
+
+void Master::report_frames_completed(uint32_t num_frames) {
+	current_frame = num_frames;
+	if (num_frames / UPDATE_FRAME_COUNT_PERIOD == last_fps_frame / UPDATE_FRAME_COUNT_PERIOD) {
+		return;
+	}
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	double seconds = now.tv_sec + now.tv_usec / 1e6;
+	double interval = seconds - last_fps_seconds;
+	last_fps = (num_frames - last_fps_frame) / interval;
+	printf("[%d] FPS %.1f\r", num_frames, last_fps);
+	fflush(stdout);
+	last_fps_frame = num_frames;
+	last_fps_seconds = seconds;
 }
 
 Arguments& Master::get_args() {
 	return *args;
 }
 
-Robot* Master::get_robot(uint32_t id) {
-	return &(robots->at(id - 1));
+void Master::final_positions_received(unsigned char *robots, uint32_t num_robots) {
+	if (final_positions.empty()) {
+		final_positions.assign((size_t) args->get_population_size() * 3, 0);
+	}
+	for (unsigned int i = 0; i < num_robots; i++) {
+		unsigned char *robot = robots + (i * Robot::NORMAL_SERIALIZED_LENGTH);
+		uint32_t robot_id = Robot::get_id_from_serialized(robot);
+		if (robot_id == 0 || robot_id > args->get_population_size()) {
+			fprintf(stderr, "[Err] Final position of unknown robot '%u'\n", robot_id);
+			exit(EXIT_FAILURE);
+		}
+		Robot::get_position_from_serialized(robot, &final_positions[(size_t) (robot_id - 1) * 3]);
+	}
+}
+
+void Master::trace_received(uint32_t id, unsigned char *message) {
+	std::vector<ThreadTrace> &traces = worker_traces.at(id - 1);
+	traces.clear();
+	uint32_t num_threads = netutils::get_uint32_from_message(message + 1);
+	unsigned char *location = message + 5;
+	for (uint32_t i = 0; i < num_threads; i++) {
+		ThreadTrace trace;
+		trace.thread = netutils::get_uint32_from_message(location);
+		uint32_t num_records = netutils::get_uint32_from_message(location + 4);
+		location += 8;
+		trace.records.reserve(num_records);
+		for (uint32_t j = 0; j < num_records; j++) {
+			trace.records.push_back(TraceBuffer::deserialize(location));
+			location += TraceBuffer::SERIALIZED_RECORD_LENGTH;
+		}
+		traces.push_back(trace);
+	}
+}
+
+//Writes a thread's events as complete ('X') trace events, in microseconds since the base time
+static void write_trace_events(FILE *trace_file, uint32_t pid, uint32_t tid,
+		const std::vector<TraceBuffer::Record> &records, uint64_t base_ns) {
+	for (unsigned int i = 0; i < records.size(); i++) {
+		const TraceBuffer::Record &record = records.at(i);
+		if (record.event >= TraceBuffer::NUM_EVENTS) {
+			continue;
+		}
+		TraceBuffer::Event event = (TraceBuffer::Event) record.event;
+		fprintf(trace_file, ",\n{\"ph\":\"X\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,", pid, tid,
+				(record.start_ns - base_ns) / 1e3, record.duration_ns / 1e3);
+		switch (event) {
+			case TraceBuffer::HANDLE_MESSAGE:
+				fprintf(trace_file, "\"name\":\"%s\"}", protocol::get_message_type_name(record.arg).c_str());
+				break;
+			case TraceBuffer::WRITE_HALOS:
+			case TraceBuffer::WAIT_ON_NEIGHBOURS:
+			case TraceBuffer::ADD_HALOS:
+				fprintf(trace_file, "\"name\":\"%s\",\"args\":{\"exchange\":\"%s\"}}",
+						TraceBuffer::get_event_name(event), record.arg == 0 ? "ghost_strips" : "moved_robots");
+				break;
+			case TraceBuffer::SEND_GHOST_STRIP:
+			case TraceBuffer::SEND_MOVED_ROBOTS:
+				fprintf(trace_file, "\"name\":\"%s\",\"args\":{\"robots\":%u}}", TraceBuffer::get_event_name(event),
+						record.arg);
+				break;
+			case TraceBuffer::ADD_GHOST_STRIP:
+			case TraceBuffer::ADD_ROBOTS:
+			case TraceBuffer::WAIT_ON_WORKER:
+				fprintf(trace_file, "\"name\":\"%s\"}", TraceBuffer::get_event_name(event));
+				break;
+			default:
+				fprintf(trace_file, "\"name\":\"%s\",\"args\":{\"frame\":%u}}", TraceBuffer::get_event_name(event),
+						record.arg);
+				break;
+		}
+	}
+}
+
+void Master::write_trace() {
+	static const char* THREAD_NAMES[] = { "worker", "left peer connection", "right peer connection" };
+
+	FILE *trace_file = fopen(args->get_trace_output_path(), "w");
+	if (trace_file == NULL) {
+		fprintf(stderr, "[Err] Failed to open trace file '%s'\n", args->get_trace_output_path());
+		exit(EXIT_FAILURE);
+	}
+
+	//Messages handled by each of our worker connections
+	std::vector<std::vector<TraceBuffer::Record>> connection_records(worker_count);
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_connections.at(i)->get_trace().get_records(connection_records.at(i));
+	}
+
+	//Times are relative to the earliest event
+	uint64_t base_ns = UINT64_MAX;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		if (!connection_records.at(i).empty() && connection_records.at(i).front().start_ns < base_ns) {
+			base_ns = connection_records.at(i).front().start_ns;
+		}
+		for (unsigned int j = 0; j < worker_traces.at(i).size(); j++) {
+			ThreadTrace &trace = worker_traces.at(i).at(j);
+			if (!trace.records.empty() && trace.records.front().start_ns < base_ns) {
+				base_ns = trace.records.front().start_ns;
+			}
+		}
+	}
+
+	//Master is process 0 (a thread per worker connection), each worker the process of its id
+	fprintf(trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(trace_file, "{\"ph\":\"M\",\"pid\":0,\"name\":\"process_name\",\"args\":{\"name\":\"master\"}}");
+	for (unsigned int i = 0; i < worker_count; i++) {
+		fprintf(trace_file, ",\n{\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"name\":\"thread_name\","
+				"\"args\":{\"name\":\"worker connection %u\"}}", i + 1, i + 1);
+		write_trace_events(trace_file, 0, i + 1, connection_records.at(i), base_ns);
+	}
+	for (unsigned int i = 0; i < worker_count; i++) {
+		fprintf(trace_file, ",\n{\"ph\":\"M\",\"pid\":%u,\"name\":\"process_name\","
+				"\"args\":{\"name\":\"worker %u (%s)\"}}", i + 1, i + 1, worker_connections.at(i)->get_ip_address());
+		fprintf(trace_file, ",\n{\"ph\":\"M\",\"pid\":%u,\"name\":\"process_sort_index\","
+				"\"args\":{\"sort_index\":%u}}", i + 1, i + 1);
+		for (unsigned int j = 0; j < worker_traces.at(i).size(); j++) {
+			ThreadTrace &trace = worker_traces.at(i).at(j);
+			if (trace.thread < 3) {
+				fprintf(trace_file, ",\n{\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"name\":\"thread_name\","
+						"\"args\":{\"name\":\"%s\"}}", i + 1, trace.thread, THREAD_NAMES[trace.thread]);
+			}
+			write_trace_events(trace_file, i + 1, trace.thread, trace.records, base_ns);
+		}
+	}
+	fprintf(trace_file, "\n]}\n");
+	fclose(trace_file);
+	printf("\nTrace written to '%s'\n", args->get_trace_output_path());
 }
 
 void Master::dump_robot_positions() {
 	std::ofstream dump_file(Master::POSITIONS_DUMP_FILE);
 	if (dump_file.is_open()) {
-		for (unsigned int i = 0; i < robots->size(); i++) {
-			dump_file << robots->at(i).to_string_short() << std::endl;
+		for (unsigned int i = 0; i < final_positions.size(); i += 3) {
+			dump_file << final_positions.at(i) << ',' << final_positions.at(i + 1) << ',' << final_positions.at(i + 2)
+					<< '\n';
 		}
 		dump_file.close();
 	} else {
@@ -386,6 +1269,96 @@ void Master::dump_robot_positions() {
 	}
 }
 
+void Master::positions_written(uint32_t id, uint32_t num_robots) {
+	shard_sizes.at(id - 1) = num_robots;
+}
+
+void Master::write_positions_manifest() {
+	uint32_t num_robots = 0;
+	std::vector<std::string> shard_names;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		char shard_name[32];
+		snprintf(shard_name, sizeof shard_name, protocol::SHARD_FILE_FORMAT, i + 1);
+		shard_names.push_back(shard_name);
+		num_robots += shard_sizes.at(i);
+	}
+	if (num_robots != args->get_population_size()) {
+		fprintf(stderr, "[Err] Workers wrote '%u' final positions, expected '%u'\n", num_robots,
+				args->get_population_size());
+		exit(EXIT_FAILURE);
+	}
+
+	//The final frame runs after the last frame reported
+	uint32_t frame = args->get_num_updates() > 0 ? args->get_num_updates() + 1 : 0;
+	write_manifest(std::string(args->get_positions_output_dir()) + "/" + POSITIONS_MANIFEST_FILE, frame,
+			shard_names, shard_sizes);
+	printf("\nFinal positions written to '%s'\n", args->get_positions_output_dir());
+}
+
+void Master::checkpoint_written(uint32_t id, uint32_t frame, uint32_t num_robots) {
+	worker_checkpoints.at(id - 1)[frame] = num_robots;
+
+	//A checkpoint is consistent once every worker has written it
+	std::vector<std::string> shard_names;
+	std::vector<uint32_t> checkpoint_sizes;
+	uint32_t num_checkpointed_robots = 0;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		std::map<uint32_t, uint32_t>::iterator checkpoint = worker_checkpoints.at(i).find(frame);
+		if (checkpoint == worker_checkpoints.at(i).end()) {
+			return;
+		}
+		char shard_name[48];
+		snprintf(shard_name, sizeof shard_name, protocol::CHECKPOINT_FILE_FORMAT, frame, i + 1);
+		shard_names.push_back(shard_name);
+		checkpoint_sizes.push_back(checkpoint->second);
+		num_checkpointed_robots += checkpoint->second;
+	}
+	if (num_checkpointed_robots != args->get_population_size()) {
+		fprintf(stderr, "[Err] Workers checkpointed '%u' robots at frame '%u', expected '%u'\n",
+				num_checkpointed_robots, frame, args->get_population_size());
+		exit(EXIT_FAILURE);
+	}
+
+	write_manifest(std::string(args->get_checkpoint_dir()) + "/" + CHECKPOINT_MANIFEST_FILE, frame, shard_names,
+			checkpoint_sizes);
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_checkpoints.at(i).erase(worker_checkpoints.at(i).begin(),
+				worker_checkpoints.at(i).upper_bound(frame));
+	}
+
+	//Only the checkpoint in the manifest is kept: workers remove their older ones & worker 1 those left behind by
+	//workers that have since left
+	std::vector<std::pair<uint32_t, uint32_t>> orphaned_shards;
+	std::vector<std::pair<uint32_t, uint32_t>> kept_shards;
+	for (unsigned int i = 0; i < orphaned_checkpoint_shards.size(); i++) {
+		if (orphaned_checkpoint_shards.at(i).first < frame) {
+			orphaned_shards.push_back(orphaned_checkpoint_shards.at(i));
+		} else {
+			kept_shards.push_back(orphaned_checkpoint_shards.at(i));
+		}
+	}
+	orphaned_checkpoint_shards.swap(kept_shards);
+	std::vector<std::pair<uint32_t, uint32_t>> no_shards;
+	for (unsigned int i = 0; i < worker_count; i++) {
+		worker_connections.at(i)->send_checkpoint_committed(frame, i == 0 ? orphaned_shards : no_shards);
+		worker_checkpoint_shards.at(i) = i + 1;
+	}
+	checkpoint_frame = frame;
+}
+
+void Master::write_manifest(const std::string &path, uint32_t frame, std::vector<std::string> &shard_names,
+		std::vector<uint32_t> &shard_sizes) {
+	Manifest manifest;
+	manifest.world_size = args->get_world_size();
+	manifest.population_size = args->get_population_size();
+	manifest.frame = frame;
+	manifest.shard_names = shard_names;
+	manifest.shard_sizes = shard_sizes;
+	if (manifest.write(path.c_str()) != 0) {
+		exit(EXIT_FAILURE);
+	}
+}
+
 //Entry point
 int main(int argc, char** argv) {
 	//Seed the random generator
@@ -2,84 +2,252 @@
 #define MASTER_H_
 
 #include <limits.h>
-#include <pthread.h>
 #include <inttypes.h>
 #include <vector>
+#include <map>
+#include <string>
+#include <utility>
 
 #include "worker_connection.h"
 #include "arguments.h"
 #include "robot.h"
+#include "population_file.h"
+#include "frame_timings.h"
+#include "trace_buffer.h"
+#include "message_stats.h"
+#include "metrics_server.h"
+#include "straggler_detector.h"
 
 #ifndef HOST_NAME_MAX
 #define HOST_NAME_MAX 256
 #endif
 
-//Forward declaration
+//Forward declarations
 class WorkerConnection;
+class MetricsServer;
 
 /**
  *
- * The center most component of the "Master" node. Runs the main thread
+ * The center most component of the "Master" node. Runs the main thread, which drives all worker connections through
+ * a single epoll event loop
  *
  */
 class Master {
 
 	private:
 
+		//Trace events of one of a worker's threads (0: worker, 1: left peer connection, 2: right peer connection)
+		struct ThreadTrace {
+			uint32_t thread;
+			std::vector<TraceBuffer::Record> records;
+		};
+
+		//A run of population file records
+		struct RecordRange {
+			unsigned char *records;
+			uint32_t num_records;
+		};
+
+		//The robots still to be sent to a worker, either from the master's robots or from ranges of population file
+		//records (which are filtered by the worker's slice)
+		struct RobotStream {
+			std::vector<Robot*> robots;
+			std::vector<RecordRange> record_ranges;
+			uint32_t range;
+			uint32_t next;
+			int32_t slice_start;
+			int32_t slice_end;
+			bool last_slice;
+			bool finished;
+		};
+
 		static const int UPDATE_FRAME_COUNT_PERIOD = 10;
 
+		//Maximum number of robots per SET_ROBOTS_MESSAGE chunk
+		static const uint32_t ROBOTS_PER_CHUNK = 32768;
+
+		//Maximum number of events retrieved per epoll_wait call
+		static const int MAX_EPOLL_EVENTS = 64;
+
 		static const char* POSITIONS_DUMP_FILE;
 
+		//Name of the manifest within the final positions output directory
+		static const char* POSITIONS_MANIFEST_FILE;
+
+		//Name of the manifest of the last consistent checkpoint within the checkpoint directory
+		static const char* CHECKPOINT_MANIFEST_FILE;
+
 		//The listen socket for incoming connections
 		int listen_fd;
 
+		//The epoll instance driving all worker connections (and the listen socket during the startup lobby)
+		int epoll_fd;
+
+		//Serves metrics from our event loop (NULL: no metrics port)
+		MetricsServer *metrics_server;
+
 		//Configuration arguments
 		Arguments *args;
 
 		//Worker connections
 		std::vector<WorkerConnection*> worker_connections;
 		std::vector<uint32_t> slowest_connection_count;
+
+		//Per worker progress (when workers send PROGRESS records): frames completed & accumulated phase timings
+		std::vector<uint32_t> worker_completed_frames;
+		std::vector<FrameTimings> worker_phase_timings;
+
+		//Per worker messages exchanged over each of its connections so far (from the latest PROGRESS record)
+		std::vector<std::vector<MessageStats>> worker_message_stats;
+
+		//Per worker metrics from the latest PROGRESS record: robots owned, the timings of the frames it covered & the
+		//halo bytes sent per frame over them (with the total sent at the frame reported, to take the next difference)
+		std::vector<uint32_t> worker_num_robots;
+		std::vector<FrameTimings> worker_recent_timings;
+		std::vector<double> worker_halo_bytes_per_frame;
+		std::vector<uint64_t> worker_halo_bytes_sent;
+
+		//Per worker frame times & the time each stalls the ring, flagging persistent stragglers
+		StragglerDetector straggler_detector;
+
+		//Per worker trace events of each thread, on our clock (tracing runs)
+		std::vector<std::vector<ThreadTrace>> worker_traces;
+
+		//Number of robots within each worker's final positions shard (when workers write them)
+		std::vector<uint32_t> shard_sizes;
+
+		//Per worker checkpoints written (frame: number of robots) that not every worker has written yet, the frame of
+		//the last checkpoint written by all workers (0: none), the shard each worker wrote of it (the worker's id at
+		//the time, 0: none) & the shards of it & earlier ones left behind by workers that have left, as (frame, shard)
+		std::vector<std::map<uint32_t, uint32_t>> worker_checkpoints;
+		uint32_t checkpoint_frame;
+		std::vector<uint32_t> worker_checkpoint_shards;
+		std::vector<std::pair<uint32_t, uint32_t>> orphaned_checkpoint_shards;
 		uint32_t worker_count;
-		pthread_mutex_t connections_mutex;
 
-		//Mutexes, conditions, and variables for synchronization of work/wait between master and worker connections
-		pthread_mutex_t synchronization;
-		pthread_cond_t master_done;
-		pthread_cond_t all_worker_connections_done;
+		//Elastic runs: connections waiting to join (JOIN received), workers that have asked to leave, is the
+		//simulation running & is a join or leave to be looked at (from the event loop). Workers are spliced into or out of the running ring one at a time: the joining worker
+		//(or the leaving one, NULL: none), the workers that have reported RECONFIGURED & the frame they reconfigured
+		//after, and has the joining worker taken its columns (ROBOTS_SET)
+		std::vector<WorkerConnection*> waiting_connections;
+		std::vector<bool> worker_leaving;
+		bool simulation_running;
+		bool reconfiguration_pending;
+		bool reconfiguration_requested;
+		WorkerConnection *joining_connection;
+		WorkerConnection *leaving_connection;
+		uint32_t num_reconfigured;
+		uint32_t reconfiguration_frame;
+		bool joining_connection_ready;
+
+		//Number of worker connections still processing messages before they wait on the master again
 		unsigned int num_worker_connections_working;
-		std::vector<bool> worker_connections_working;
 
-		//Amount of updates completed & the time of the last update period
+		//Amount of updates completed, the last frame count reported & the time of the last update period, the frames
+		//completed by every worker & the FPS of the last update period
 		uint32_t update_count;
+		uint32_t last_fps_frame;
 		double last_fps_seconds;
+		uint32_t current_frame;
+		double last_fps;
 
-		//Contains all robots (created during initialization, updated at the end)
-		std::vector<Robot> *robots;
+		//Final x, y & a of each robot (by id), collected from FINAL_POSITIONS. Only allocated once the first of them
+		//arrives, so never when workers write their positions themselves
+		std::vector<int32_t> final_positions;
+
+		//Per worker robot streams during the initial distribution (& the population files they may read from)
+		std::vector<RobotStream> robot_streams;
+		std::vector<PopulationFile*> population_files;
 
 		//Our hostname/IP in readable form
 		char hostname[HOST_NAME_MAX];
 
-		//Thread routine for handling worker connections
-		static void* handle_connection(void* wc);
+		// Resets the per worker state & counters for the configured number of workers (from the start frame)
+		void reset_worker_state();
 
-		// Adds the worker connects, increments the count, and returns connection number for calling routine
-		uint32_t worker_joined(WorkerConnection& worker_connection);
+		// Waits for all workers to join, then connects them in a ring & sets their parameters & robots
+		void initialize_workers();
+
+		// Starts splicing a worker out of the ring if one has asked to leave (& the ring can lose one), or else into it
+		// if one is waiting to join (& a worker has columns to spare) (elastic runs)
+		void request_reconfiguration();
+
+		// Asks every worker to splice the leaving worker out, its columns going to the neighbour next to them
+		void request_leave(uint32_t index);
+
+		// Joins a waiting worker into the running ring as the right neighbour of the worker at the index, taking the
+		// right half of its columns. Every worker is asked to splice it in once it is listening
+		void request_join(uint32_t index);
+
+		// Takes the new ring over once every worker has reconfigured (& a joining worker is ready): ids, neighbours &
+		// per worker state, and resumes the worker connections from the reconfiguration frame
+		void complete_reconfiguration();
+
+		// Inserts (or erases) the per worker state of the worker at the index, which has completed frames
+		void insert_worker_state(uint32_t index, uint32_t frames);
+		void erase_worker_state(uint32_t index);
+
+		// The smallest listen port not taken by a worker of the ring (or by a joining worker)
+		uint32_t get_free_listen_port();
+
+		// Accepts all pending connections on the listen socket and registers them with epoll
+		void accept_worker_connections();
 
-		// Signals the peer connections to do work while we wait (this is called only the first time)
-		void start_wait_worker_connections();
+		// Waits for socket events and lets the respective worker connections handle them
+		void process_events();
 
-		// Signals the worker connections to do work while we wait
+		// Sets the epoll events we are interested in for a worker connection (0: none)
+		void set_connection_events(WorkerConnection& worker_connection, uint32_t events);
+
+		// Resumes the worker connections and runs the event loop until all of them are waiting on the master again
+		// (elastic runs: completing reconfigurations in between events)
 		void wait_on_worker_connections();
 
 		// Sends each worker the appropriate collection of robots
 		void send_robots_to_workers();
 
+		// Sends each worker the seed to generate its robots from
+		void send_robot_seed_to_workers();
+
+		// Sends each worker its robots from the population file, or has the workers load it themselves if it is shared
+		void send_population_file_to_workers();
+
+		// Sends each worker the robots within its slice from every shard of the restart checkpoint
+		void send_checkpoint_to_workers();
+
+		// Maps the population files & sets up each worker's stream of the records within its slice
+		void stream_population_files(std::vector<std::string> &paths);
+
+		// Streams each worker's robot stream to it in chunks, to all workers at once, until all workers have set them
+		void stream_robots_to_workers();
+
 		// Runs the main simulation loop
 		void simulation_loop();
 
 		// Dumps final robot positions to a text file
 		void dump_robot_positions();
 
+		// Writes the trace events of the workers' threads & of our worker connections as Chrome trace event JSON
+		void write_trace();
+
+		// Writes the manifest describing the final position shards written by the workers
+		void write_positions_manifest();
+
+		// Writes a manifest describing a set of shards (population files) that together hold the population at a frame
+		void write_manifest(const std::string &path, uint32_t frame, std::vector<std::string> &shard_names,
+				std::vector<uint32_t> &shard_sizes);
+
+		// Prints each worker's phase timings per frame (from PROGRESS records) & whether it was computing or waiting on
+		// its neighbours for most of its frames
+		void print_phase_timings();
+
+		// Prints the messages exchanged per message type: over our worker connections, and (from PROGRESS records)
+		// over the workers' connections
+		void print_message_stats();
+
+		// Prints the FPS whenever the number of frames completed by all workers reaches a new update period
+		void report_frames_completed(uint32_t num_frames);
+
 	public:
 		Master(Arguments &args);
 
@@ -88,18 +256,65 @@ class Master {
 		//Starts the main master routine
 		void start();
 
-		// Signals the master thread to do work while calling routine (worker connection) waits
-		void wait_on_master(uint32_t id);
+		// Adds the worker connection, increments the count, and returns connection number (0: lobby is full)
+		uint32_t worker_joined(WorkerConnection& worker_connection);
+
+		// Suspends the calling worker connection until the master has finished its task. Messages from the worker are
+		// left unprocessed in the meantime
+		void wait_on_master(WorkerConnection& worker_connection);
+
+		// Parks a connection that joined a full lobby until it can be spliced into the ring (elastic runs)
+		void wait_to_join(WorkerConnection& worker_connection);
+
+		// Called from a worker connection when the worker has asked to leave (elastic runs)
+		void leave_requested(uint32_t id);
+
+		// Called from the connection of a worker joining the running ring once it is listening for its left neighbour.
+		// Sends it its right neighbour & asks every worker of the ring to splice it in
+		void joiner_listening(WorkerConnection& worker_connection);
+
+		// Called from the connection of a worker joining the running ring once it has taken its columns. Starts it, its
+		// messages are handled once the ring has reconfigured
+		void joiner_ready(WorkerConnection& worker_connection);
+
+		// Called from a worker connection once the worker has reconfigured after the frame. Its later messages are
+		// handled once every worker has (a leaving worker disconnects)
+		void reconfigured(WorkerConnection& worker_connection, uint32_t frame);
+
+		// Called from a worker connection when a frame has finished, having taken the worker compute_ns apart from
+		// waiting on its neighbours
+		void frame_completed(uint32_t id, uint64_t compute_ns);
+
+		// Called from the last worker's connection with the number of frames completed by all workers (aggregated
+		// along the worker ring)
+		void frames_completed(uint32_t num_frames);
+
+		// Called from a worker connection with a PROGRESS record: the robots owned by the worker, the phase timings of
+		// the frames it covers & the messages exchanged so far over each of the worker's connections
+		// (MessageStats::NUM_CONNECTIONS)
+		void progress_reported(uint32_t id, uint32_t completed_frames, uint32_t num_robots, const FrameTimings &timings,
+				const MessageStats *message_stats);
+
+		// Writes the current metrics of the run in the Prometheus text format (per worker metrics come from PROGRESS
+		// records)
+		void write_metrics(std::string &metrics);
+
+		// Called from a worker connection with the trace events of the worker's threads (tracing runs)
+		void trace_received(uint32_t id, unsigned char *message);
+
+		// Called from a worker connection once the worker has written its final positions shard
+		void positions_written(uint32_t id, uint32_t num_robots);
 
-		// Quick lock & release for synchonization b/w master and worker connections. Worker connections should be
-		// created with master already having ownership of the lock
-		void get_and_release_lock();
+		// Called from a worker connection once the worker has written a checkpoint. Records the checkpoint in the
+		// manifest once all workers have written it
+		void checkpoint_written(uint32_t id, uint32_t frame, uint32_t num_robots);
 
-		// Called from worker connection thread when a frame has finished
-		void frame_completed(uint32_t id);
+		// Fills the message with the next SET_ROBOTS_MESSAGE chunk (length header included) for a worker. Returns false
+		// once the last chunk has been taken
+		bool next_robots_chunk(uint32_t id, std::vector<unsigned char> &message);
 
-		// Gets the robot with the specific id (for updating once all frames are completed)
-		Robot* get_robot(uint32_t id);
+		// Called from a worker connection with the robots of its FINAL_POSITIONS (normal serialized)
+		void final_positions_received(unsigned char *robots, uint32_t num_robots);
 
 };
 
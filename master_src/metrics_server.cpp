@@ -0,0 +1,153 @@
+#include "metrics_server.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+MetricsServer::MetricsServer(Master &master, uint32_t port) {
+	this->master = &master;
+
+	struct addrinfo hints, *res;
+	memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+
+	std::string port_string = std::to_string(port);
+	if (getaddrinfo(NULL, port_string.c_str(), &hints, &res) != 0) {
+		fprintf(stderr, "[Err] Failed to get address info for the metrics port\n");
+		exit(EXIT_FAILURE);
+	}
+
+	//Bind to the first address we can
+	struct addrinfo *p;
+	for (p = res; p != NULL; p = p->ai_next) {
+		if ((listen_fd = socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK, p->ai_protocol)) < 0) {
+			continue;
+		}
+		int yes = 1;
+		if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int)) != 0) {
+			fprintf(stderr, "[Err] setsockopt failed\n");
+			exit(EXIT_FAILURE);
+		}
+		if (bind(listen_fd, p->ai_addr, p->ai_addrlen) != 0) {
+			close(listen_fd);
+			continue;
+		}
+		break;
+	}
+	if (p == NULL) {
+		fprintf(stderr, "[Err] Failed to bind the metrics port %u\n", port);
+		exit(EXIT_FAILURE);
+	}
+	freeaddrinfo(res);
+
+	if (listen(listen_fd, SOMAXCONN) != 0) {
+		fprintf(stderr, "[Err] Failed to listen on the metrics port\n");
+		exit(EXIT_FAILURE);
+	}
+
+	//The listen socket is identified by its own fd, as are the clients
+	if ((epoll_fd = epoll_create1(0)) < 0) {
+		fprintf(stderr, "[Err] Failed to create epoll instance\n");
+		exit(EXIT_FAILURE);
+	}
+	struct epoll_event event;
+	memset(&event, 0, sizeof event);
+	event.events = EPOLLIN;
+	event.data.fd = listen_fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0) {
+		fprintf(stderr, "[Err] Failed to add metrics socket to epoll\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+MetricsServer::~MetricsServer() {
+	while (!requests.empty()) {
+		close_client(requests.begin()->first);
+	}
+	close(epoll_fd);
+	close(listen_fd);
+}
+
+int MetricsServer::get_fd() {
+	return epoll_fd;
+}
+
+void MetricsServer::handle_events() {
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	int num_events = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, 0);
+	for (int i = 0; i < num_events; i++) {
+		if (events[i].data.fd == listen_fd) {
+			accept_clients();
+		} else if (!handle_client(events[i].data.fd)) {
+			close_client(events[i].data.fd);
+		}
+	}
+}
+
+void MetricsServer::accept_clients() {
+	while (true) {
+		int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK);
+		if (client_fd < 0) {
+			//EAGAIN/EWOULDBLOCK: No more pending connections
+			return;
+		}
+		struct epoll_event event;
+		memset(&event, 0, sizeof event);
+		event.events = EPOLLIN;
+		event.data.fd = client_fd;
+		if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event) != 0) {
+			close(client_fd);
+			continue;
+		}
+		requests[client_fd] = std::string();
+	}
+}
+
+bool MetricsServer::handle_client(int client_fd) {
+	std::string &request = requests[client_fd];
+	char buffer[1024];
+	while (true) {
+		ssize_t result = recv(client_fd, buffer, sizeof buffer, 0);
+		if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			break;
+		}
+		if (result <= 0) {
+			return false;
+		}
+		request.append(buffer, result);
+		if (request.size() > MAX_REQUEST_SIZE) {
+			return false;
+		}
+	}
+	if (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos) {
+		return true;
+	}
+
+	std::string response;
+	if (request.compare(0, 4, "GET ") == 0) {
+		std::string metrics;
+		master->write_metrics(metrics);
+		response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+				+ std::to_string(metrics.size()) + "\r\nConnection: close\r\n\r\n" + metrics;
+	} else {
+		response = "HTTP/1.0 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	}
+
+	//A response fits within the socket's send buffer, anything it does not take is dropped with the connection
+	send(client_fd, response.data(), response.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+	return false;
+}
+
+void MetricsServer::close_client(int client_fd) {
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+	close(client_fd);
+	requests.erase(client_fd);
+}
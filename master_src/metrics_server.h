@@ -0,0 +1,52 @@
+#ifndef METRICS_SERVER_H_
+#define METRICS_SERVER_H_
+
+#include <inttypes.h>
+#include <map>
+#include <string>
+
+#include "master.h"
+
+//Forward declaration
+class Master;
+
+/**
+ * Minimal HTTP server for Prometheus scrapes of the master's metrics (any GET is answered with the metrics). Its sockets
+ * are watched by an epoll instance of its own, which the master watches from its event loop, so requests are served on
+ * the master's thread without blocking it
+ *
+ */
+class MetricsServer {
+
+	private:
+		//Largest request header accepted
+		static const uint32_t MAX_REQUEST_SIZE = 8192;
+
+		static const int MAX_EPOLL_EVENTS = 16;
+
+		Master *master;
+		int listen_fd;
+		int epoll_fd;
+
+		//Request received so far from each client
+		std::map<int, std::string> requests;
+
+		void accept_clients();
+
+		//Reads from the client & responds once its request is complete. Returns false once the client is done with
+		bool handle_client(int client_fd);
+
+		void close_client(int client_fd);
+
+	public:
+		MetricsServer(Master &master, uint32_t port);
+		~MetricsServer();
+
+		//File descriptor for the master to watch (readable when a client needs handling)
+		int get_fd();
+
+		//Handles whatever is ready without blocking
+		void handle_events();
+};
+
+#endif /* METRICS_SERVER_H_ */
@@ -0,0 +1,210 @@
+#include "straggler_detector.h"
+
+#include <cstdio>
+
+StragglerDetector::StragglerDetector() {
+	reset(0);
+}
+
+void StragglerDetector::reset(uint32_t num_workers) {
+	workers.assign(num_workers, WorkerState());
+	for (uint32_t i = 0; i < num_workers; i++) {
+		WorkerState &worker = workers.at(i);
+		worker.name = "(" + std::to_string(i + 1) + ")";
+		worker.frames_finished = 0;
+		worker.last_finished_ns = 0;
+		worker.frame_ns_per_frame = 0;
+		worker.compute_ns_per_frame = 0;
+		worker.record_frames = 0;
+		worker.reported = false;
+		worker.frames_slowest = 0;
+		worker.stall_ns = 0;
+		worker.window_frames_slowest = 0;
+		worker.window_stall_ns = 0;
+		worker.windows_holding_up = 0;
+		worker.flagged = false;
+		worker.windows_flagged = 0;
+	}
+	pending_frames.clear();
+	last_frame_finished_ns = 0;
+	num_frames = 0;
+	window_frames = 0;
+	window_frame_ns = 0;
+	num_windows = 0;
+	fastest_window_frame_ns = 0;
+}
+
+void StragglerDetector::set_worker_name(uint32_t id, const char *name) {
+	workers.at(id - 1).name = std::string(name) + " (" + std::to_string(id) + ")";
+}
+
+void StragglerDetector::frame_finished(uint32_t id, uint64_t now_ns, uint64_t compute_ns) {
+	WorkerState &worker = workers.at(id - 1);
+	if (worker.last_finished_ns > 0) {
+		worker.frame_times.record_frame(now_ns - worker.last_finished_ns);
+	}
+	worker.last_finished_ns = now_ns;
+	uint32_t frame = worker.frames_finished++;
+	if (workers.size() < 2) {
+		return;
+	}
+
+	PendingFrame &pending = pending_frames[frame];
+	if (pending.num_finished == 0 || compute_ns > pending.slowest_compute_ns) {
+		pending.next_slowest_compute_ns = pending.slowest_compute_ns;
+		pending.slowest_compute_ns = compute_ns;
+		pending.slowest = id - 1;
+	} else if (compute_ns > pending.next_slowest_compute_ns) {
+		pending.next_slowest_compute_ns = compute_ns;
+	}
+	pending.num_finished++;
+	pending.last_ns = now_ns;
+	if (pending.num_finished == workers.size()) {
+		uint64_t frame_ns = last_frame_finished_ns > 0 ? pending.last_ns - last_frame_finished_ns : 0;
+		last_frame_finished_ns = pending.last_ns;
+
+		//The ring was only held up as far as its frame took longer than the next slowest worker needed
+		uint64_t stall_ns = pending.slowest_compute_ns - pending.next_slowest_compute_ns;
+		if (frame_ns < pending.slowest_compute_ns) {
+			stall_ns = frame_ns > pending.next_slowest_compute_ns ? frame_ns - pending.next_slowest_compute_ns : 0;
+		}
+		frames_observed(pending.slowest, stall_ns, 1, frame_ns);
+		pending_frames.erase(frame);
+	}
+}
+
+void StragglerDetector::progress_reported(uint32_t id, const FrameTimings &timings) {
+	WorkerState &worker = workers.at(id - 1);
+	uint32_t record_frames = timings.get_num_frames();
+	if (record_frames == 0) {
+		return;
+	}
+	worker.frame_times.add(timings);
+	worker.frame_ns_per_frame = (double) timings.get_frame_total_ns() / record_frames;
+	worker.compute_ns_per_frame = (double) (timings.get_frame_total_ns()
+			- timings.get_total_ns(FrameTimings::HALO_PEER_WAIT)) / record_frames;
+	worker.record_frames = record_frames;
+	worker.reported = true;
+	if (workers.size() < 2) {
+		return;
+	}
+
+	//The round is complete once every worker has reported in it, its frames are those covered by every record
+	uint32_t slowest = 0;
+	uint32_t round_frames = record_frames;
+	for (uint32_t i = 0; i < workers.size(); i++) {
+		if (!workers.at(i).reported) {
+			return;
+		}
+		if (workers.at(i).compute_ns_per_frame > workers.at(slowest).compute_ns_per_frame) {
+			slowest = i;
+		}
+		if (workers.at(i).record_frames < round_frames) {
+			round_frames = workers.at(i).record_frames;
+		}
+	}
+	double next_slowest_ns = 0;
+	for (uint32_t i = 0; i < workers.size(); i++) {
+		workers.at(i).reported = false;
+		if (i != slowest && workers.at(i).compute_ns_per_frame > next_slowest_ns) {
+			next_slowest_ns = workers.at(i).compute_ns_per_frame;
+		}
+	}
+	//The slowest worker hardly waits, so its frames take as long as the ring's. The ring was only held up as far as
+	//its frames took longer than the next slowest worker needed
+	WorkerState &straggler = workers.at(slowest);
+	double stall_ns_per_frame = straggler.compute_ns_per_frame - next_slowest_ns;
+	if (straggler.frame_ns_per_frame < straggler.compute_ns_per_frame) {
+		stall_ns_per_frame = straggler.frame_ns_per_frame > next_slowest_ns ?
+				straggler.frame_ns_per_frame - next_slowest_ns : 0;
+	}
+	frames_observed(slowest, stall_ns_per_frame * round_frames, round_frames,
+			straggler.frame_ns_per_frame * round_frames);
+}
+
+void StragglerDetector::frames_observed(uint32_t slowest, uint64_t stall_ns, uint32_t frames, uint64_t frame_ns) {
+	WorkerState &worker = workers.at(slowest);
+	worker.frames_slowest += frames;
+	worker.stall_ns += stall_ns;
+	worker.window_frames_slowest += frames;
+	worker.window_stall_ns += stall_ns;
+	num_frames += frames;
+	window_frames += frames;
+	window_frame_ns += frame_ns;
+	if (window_frames >= WINDOW_FRAMES) {
+		window_completed();
+	}
+}
+
+void StragglerDetector::window_completed() {
+	//A worker computing longest only holds up the ring if the ring's frame time actually rose
+	uint64_t frame_ns = window_frame_ns / window_frames;
+	bool ring_slowed = fastest_window_frame_ns > 0
+			&& frame_ns * 100 >= (100 + STALL_SHARE_PERCENT) * fastest_window_frame_ns;
+	if (frame_ns > 0 && (fastest_window_frame_ns == 0 || frame_ns < fastest_window_frame_ns)) {
+		fastest_window_frame_ns = frame_ns;
+	}
+	for (uint32_t i = 0; i < workers.size(); i++) {
+		WorkerState &worker = workers.at(i);
+		if (ring_slowed && worker.window_frames_slowest * 100 >= PERSISTENT_SHARE_PERCENT * window_frames
+				&& worker.window_stall_ns * 100 >= STALL_SHARE_PERCENT * window_frame_ns) {
+			worker.windows_holding_up++;
+		} else {
+			worker.windows_holding_up = 0;
+		}
+		if (worker.windows_holding_up >= PERSISTENT_WINDOWS) {
+			worker.windows_flagged++;
+			if (!worker.flagged) {
+				printf("[Straggler] %s computed longest in %u of the last %u frames, stalling the ring %.3f ms per frame\n",
+						worker.name.c_str(), worker.window_frames_slowest, window_frames,
+						worker.window_stall_ns / 1e6 / window_frames);
+				worker.flagged = true;
+			}
+		} else if (worker.flagged) {
+			printf("[Straggler] %s recovered, computed longest in %u of the last %u frames\n", worker.name.c_str(),
+					worker.window_frames_slowest, window_frames);
+			worker.flagged = false;
+		}
+		worker.window_frames_slowest = 0;
+		worker.window_stall_ns = 0;
+	}
+	window_frames = 0;
+	window_frame_ns = 0;
+	num_windows++;
+}
+
+const FrameTimings& StragglerDetector::get_frame_times(uint32_t id) {
+	return workers.at(id - 1).frame_times;
+}
+
+uint64_t StragglerDetector::get_stall_ns(uint32_t id) {
+	return workers.at(id - 1).stall_ns;
+}
+
+bool StragglerDetector::is_flagged(uint32_t id) {
+	return workers.at(id - 1).flagged;
+}
+
+void StragglerDetector::print_summary() {
+	if (num_frames == 0) {
+		return;
+	}
+	printf("Worker frame times & ring stalls (ms, percentiles are histogram bucket upper bounds):\n");
+	bool any_flagged = false;
+	for (uint32_t i = 0; i < workers.size(); i++) {
+		WorkerState &worker = workers.at(i);
+		printf("   %-24s p50 <= %9.3f   p95 <= %9.3f   p99 <= %9.3f   slowest in %u of %u frames, stalled the ring %.3f "
+				"(%.3f per frame)", worker.name.c_str(), worker.frame_times.get_frame_percentile_us(0.5) / 1e3,
+				worker.frame_times.get_frame_percentile_us(0.95) / 1e3,
+				worker.frame_times.get_frame_percentile_us(0.99) / 1e3, worker.frames_slowest, num_frames,
+				worker.stall_ns / 1e6, worker.stall_ns / 1e6 / num_frames);
+		if (worker.windows_flagged > 0) {
+			printf(", persistent straggler for %u of %u windows", worker.windows_flagged, num_windows);
+			any_flagged = true;
+		}
+		printf("\n");
+	}
+	if (!any_flagged) {
+		printf("   No persistent stragglers\n");
+	}
+}
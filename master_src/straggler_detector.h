@@ -0,0 +1,126 @@
+#ifndef STRAGGLER_DETECTOR_H_
+#define STRAGGLER_DETECTOR_H_
+
+#include <inttypes.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "frame_timings.h"
+
+/**
+ * Finds the workers holding up the ring. A frame's straggler is the worker with the longest compute time (time not
+ * spent waiting on its neighbours), stalling the ring for as long as it computed beyond the next slowest worker: the
+ * time the ring's frame would have been shorter had it kept pace. When finish times are compared instead, the last
+ * worker to finish is set by its place along the ring rather than by its speed. Compute times come with each worker's
+ * FRAME_FINISHED or, per round, with PROGRESS records (a record from every worker). A worker that is the straggler of
+ * most frames of a window, stalling it for a significant share of the ring's frame time, holds up the ring if the
+ * ring's frame time over the window also rose by a significant share above the fastest window so far. A worker holding
+ * up the ring for consecutive windows is flagged as a persistent straggler, reported when flagged & once it recovers. Balanced workers take turns at being slowest by little and leave the ring's
+ * frame time where it was, so none is flagged
+ *
+ */
+class StragglerDetector {
+
+	private:
+		//Frames per detection window
+		static const uint32_t WINDOW_FRAMES = 100;
+
+		//Share of a window's frames (percent) a worker must be the straggler of to be flagged
+		static const uint32_t PERSISTENT_SHARE_PERCENT = 75;
+
+		//Share of the ring's frame time over a window (percent) a worker must stall it for, and the ring's frame time
+		//must have risen by above the fastest window, for the worker to hold up the ring
+		static const uint32_t STALL_SHARE_PERCENT = 10;
+
+		//Consecutive windows a worker must hold up the ring for to be flagged
+		static const uint32_t PERSISTENT_WINDOWS = 2;
+
+		struct WorkerState {
+			std::string name;
+
+			//Frame times (as seen by master or as reported by the worker)
+			FrameTimings frame_times;
+
+			//FRAME_FINISHED: frames finished & when the last one was
+			uint32_t frames_finished;
+			uint64_t last_finished_ns;
+
+			//PROGRESS: frame & compute time per frame over the worker's latest record & is the record part of the
+			//current round
+			double frame_ns_per_frame;
+			double compute_ns_per_frame;
+			uint32_t record_frames;
+			bool reported;
+
+			//Frames it was the straggler of & the time it stalled the ring, over the run & the current window
+			uint32_t frames_slowest;
+			uint64_t stall_ns;
+			uint32_t window_frames_slowest;
+			uint64_t window_stall_ns;
+
+			//Consecutive windows it held up the ring for, is it flagged & how many windows it was flagged for
+			uint32_t windows_holding_up;
+			bool flagged;
+			uint32_t windows_flagged;
+		};
+
+		//Frames not yet finished by every worker (FRAME_FINISHED): workers finished, the slowest so far (longest
+		//compute time), the two longest compute times & when the last worker finished
+		struct PendingFrame {
+			uint32_t num_finished;
+			uint32_t slowest;
+			uint64_t slowest_compute_ns;
+			uint64_t next_slowest_compute_ns;
+			uint64_t last_ns;
+		};
+
+		//When the latest frame finished by every worker finished (FRAME_FINISHED, the ring's frame time in between)
+		uint64_t last_frame_finished_ns;
+
+		std::vector<WorkerState> workers;
+		std::map<uint32_t, PendingFrame> pending_frames;
+
+		//Frames observed over the run & the current window, the ring's frame time over the window & windows completed
+		uint32_t num_frames;
+		uint32_t window_frames;
+		uint64_t window_frame_ns;
+		uint32_t num_windows;
+
+		//The ring's mean frame time over its fastest window so far
+		uint64_t fastest_window_frame_ns;
+
+		// Counts frames of the ring (taking frame_ns) with the given straggler, flagging workers at the end of windows
+		void frames_observed(uint32_t slowest, uint64_t stall_ns, uint32_t frames, uint64_t frame_ns);
+
+		void window_completed();
+
+	public:
+		StragglerDetector();
+
+		// Forgets everything, for a run on the given number of workers
+		void reset(uint32_t num_workers);
+
+		// Names a worker (ids start at 1) in reports
+		void set_worker_name(uint32_t id, const char *name);
+
+		// Called when a worker finished a frame (FRAME_FINISHED), having computed for compute_ns of it
+		void frame_finished(uint32_t id, uint64_t now_ns, uint64_t compute_ns);
+
+		// Called with a worker's PROGRESS record, observing a round once every worker has sent a record in it
+		void progress_reported(uint32_t id, const FrameTimings &timings);
+
+		// Frame times of a worker (ids start at 1)
+		const FrameTimings& get_frame_times(uint32_t id);
+
+		// Time the worker stalled the ring so far (ids start at 1)
+		uint64_t get_stall_ns(uint32_t id);
+
+		// Is the worker flagged as a persistent straggler (ids start at 1)
+		bool is_flagged(uint32_t id);
+
+		// Prints each worker's frame time percentiles & ring stalls, and the persistent stragglers of the run
+		void print_summary();
+};
+
+#endif /* STRAGGLER_DETECTOR_H_ */
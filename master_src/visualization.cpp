@@ -1,35 +1,42 @@
 #include "visualization.h"
 
+#ifndef HEADLESS
 #include <GL/glfw.h>
+#endif
 
 #include <cstdio>
 #include <cstdlib>
+#include <string>
+
+#include "netutils.h"
+#include "profiling.h"
 
 namespace visualization {
 
 	uint32_t _num_blocks = 0;
 	uint32_t _population = 0;
-	uint32_t **_block_values;
-	uint32_t _num_blocks_sets = 0;
-	uint32_t _max_block_value = 0;
-	uint32_t _min_block_value = 0;
+
+	const char *_output_dir = NULL;
+	unsigned char *_image = NULL;
+
+	std::map<uint32_t, _Frame*> _pending;
+	std::vector<_Frame*> _spare;
+	_Frame *_ready = NULL;
+	_Frame *_front = NULL;
+	bool _new_frame = false;
+	bool _finished = false;
 
 	pthread_mutex_t _lock;
 	pthread_cond_t _can_draw;
-	bool _wait_to_draw = true;
+	pthread_t _thread;
 
-	void start(uint32_t num_blocks, uint32_t population) {
+	void start(uint32_t num_blocks, uint32_t population, const char *output_dir) {
 		_num_blocks = num_blocks;
 		_population = population;
-		_min_block_value = population;
+		_output_dir = output_dir;
 
-		_block_values = new uint32_t*[num_blocks];
-		for (unsigned int i = 0; i < num_blocks; i++) {
-			_block_values[i] = new uint32_t[num_blocks];
-			for (unsigned int j = 0; j < num_blocks; j++) {
-				_block_values[i][j] = 0;
-			}
-		}
+		_ready = _allocate_frame();
+		_front = _allocate_frame();
 
 		if (pthread_mutex_init(&_lock, NULL) != 0) {
 			fprintf(stderr, "[Err] Failed to initialize mutexe\n");
@@ -41,13 +48,131 @@ namespace visualization {
 			exit(EXIT_FAILURE);
 		}
 
-		pthread_t thread;
-		if (pthread_create(&thread, NULL, &_entry, NULL) != 0) {
+#ifdef HEADLESS
+		if (output_dir == NULL) {
+			fprintf(stderr, "[Err] Built without glfw, visualization requires an image output directory\n");
+			exit(EXIT_FAILURE);
+		}
+#endif
+
+		void* (*entry)(void*) = &_headless_entry;
+#ifndef HEADLESS
+		if (output_dir == NULL) {
+			entry = &_entry;
+		}
+#endif
+		if (pthread_create(&_thread, NULL, entry, NULL) != 0) {
 			fprintf(stderr, "[Err] Failed to create visualization thread\n");
 			exit(EXIT_FAILURE);
 		}
 	}
 
+	_Frame* _allocate_frame() {
+		_Frame *frame = new _Frame();
+		frame->block_values = new uint32_t*[_num_blocks];
+		for (unsigned int i = 0; i < _num_blocks; i++) {
+			frame->block_values[i] = new uint32_t[_num_blocks];
+			for (unsigned int j = 0; j < _num_blocks; j++) {
+				frame->block_values[i][j] = 0;
+			}
+		}
+		frame->max_block_value = 0;
+		frame->min_block_value = _population;
+		frame->frame = 0;
+		frame->num_blocks_set = 0;
+		return frame;
+	}
+
+	void finish() {
+		if (_output_dir == NULL) {
+			return;
+		}
+		profiling::lock(&_lock, profiling::VISUALIZATION_LOCK);
+		_finished = true;
+		pthread_cond_signal(&_can_draw);
+		pthread_mutex_unlock(&_lock);
+		pthread_join(_thread, NULL);
+	}
+
+	bool _take_frame() {
+		//Ingestion carries on into the back frame while we render the front frame
+		profiling::lock(&_lock, profiling::VISUALIZATION_LOCK);
+		while (!_new_frame && !_finished) {
+			pthread_cond_wait(&_can_draw, &_lock);
+		}
+		if (!_new_frame) {
+			pthread_mutex_unlock(&_lock);
+			return false;
+		}
+		_Frame *frame = _front;
+		_front = _ready;
+		_ready = frame;
+		_new_frame = false;
+		pthread_mutex_unlock(&_lock);
+		return true;
+	}
+
+	double _normalized_value(uint32_t x, uint32_t y) {
+		double divisor = _front->max_block_value - _front->min_block_value;
+		double numerator = _front->block_values[y][x] - _front->min_block_value;
+		if (divisor == 0 || _front->block_values[y][x] == 0) {
+			return 0;
+		}
+		return numerator / divisor;
+	}
+
+	void* _headless_entry(void* arg) {
+		uint32_t block_pixels = IMAGE_SIZE / _num_blocks > 0 ? IMAGE_SIZE / _num_blocks : 1;
+		uint32_t image_size = _num_blocks * block_pixels;
+		_image = new unsigned char[image_size * image_size * 3];
+
+		//Frames published while we are still writing are dropped (images are named by frame, skipping those)
+		while (_take_frame()) {
+			_write_image();
+		}
+		return NULL;
+	}
+
+	void _write_image() {
+		uint32_t block_pixels = IMAGE_SIZE / _num_blocks > 0 ? IMAGE_SIZE / _num_blocks : 1;
+		uint32_t image_size = _num_blocks * block_pixels;
+
+		//Top down density map, black (empty) through red & yellow to white (densest)
+		for (uint32_t y = 0; y < _num_blocks; y++) {
+			for (uint32_t x = 0; x < _num_blocks; x++) {
+				double value = _normalized_value(x, y) * 3;
+				unsigned char red = value >= 1 ? 255 : value * 255;
+				unsigned char green = value >= 2 ? 255 : (value <= 1 ? 0 : (value - 1) * 255);
+				unsigned char blue = value >= 3 ? 255 : (value <= 2 ? 0 : (value - 2) * 255);
+				for (uint32_t py = y * block_pixels; py < (y + 1) * block_pixels; py++) {
+					unsigned char *pixel = &_image[(py * image_size + x * block_pixels) * 3];
+					for (uint32_t px = 0; px < block_pixels; px++) {
+						pixel[0] = red;
+						pixel[1] = green;
+						pixel[2] = blue;
+						pixel += 3;
+					}
+				}
+			}
+		}
+
+		char file_name[32];
+		snprintf(file_name, sizeof file_name, "/frame_%06u.ppm", _front->frame);
+		std::string path = std::string(_output_dir) + file_name;
+		FILE *file = fopen(path.c_str(), "wb");
+		if (file == NULL) {
+			fprintf(stderr, "[Err] Failed to open image file '%s'\n", path.c_str());
+			exit(EXIT_FAILURE);
+		}
+		fprintf(file, "P6\n%u %u\n255\n", image_size, image_size);
+		if (fwrite(_image, 3, image_size * image_size, file) != image_size * image_size) {
+			fprintf(stderr, "[Err] Failed to write image file '%s'\n", path.c_str());
+			exit(EXIT_FAILURE);
+		}
+		fclose(file);
+	}
+
+#ifndef HEADLESS
 	void* _entry(void* arg) {
 		if (glfwInit() != GL_TRUE) {
 			fprintf(stderr, "Failed to initialize glfw\n");
@@ -89,15 +214,9 @@ namespace visualization {
 
 	void _loop() {
 		_draw();
-		pthread_mutex_lock(&_lock);
-		while (true) {
-			_wait_to_draw = true;
-			while (_wait_to_draw) {
-				pthread_cond_wait(&_can_draw, &_lock);
-			}
+		while (_take_frame()) {
 			_draw();
 		}
-		pthread_mutex_unlock(&_lock);
 	}
 
 	void _draw() {
@@ -120,41 +239,75 @@ namespace visualization {
 				double y_value = ((double) y / _num_blocks);
 
 				glColor3f((float) x / _num_blocks, (float) y / _num_blocks, 0.4f);
-				double z_value;
-				double divisor = _max_block_value - _min_block_value;
-				double numerator = _block_values[y][x] - _min_block_value;
-				if (divisor == 0 || _block_values[y][x] == 0) {
-					z_value = 0;
-				} else {
-					z_value = numerator / divisor;
-				}
-				glVertex3f(x_value, z_value, y_value);
+				glVertex3f(x_value, _normalized_value(x, y), y_value);
 			}
 		}
 		glEnd();
 		glFlush();
 		glfwSwapBuffers();
-		_max_block_value = 0;
-		_min_block_value = _population;
 	}
+#endif
 
-	void set_block_stat(uint32_t x, uint32_t y, uint32_t size) {
-		pthread_mutex_lock(&_lock);
-		_block_values[y][x] = size;
-		if (size > _max_block_value) {
-			_max_block_value = size;
+	void set_block_stats(uint32_t frame, uint32_t x_offset, uint32_t width, uint32_t height, unsigned char *counts) {
+		_Frame *back;
+		std::map<uint32_t, _Frame*>::iterator pending = _pending.find(frame);
+		if (pending != _pending.end()) {
+			back = pending->second;
+		} else {
+			if (_spare.empty()) {
+				back = _allocate_frame();
+			} else {
+				back = _spare.back();
+				_spare.pop_back();
+			}
+			back->max_block_value = 0;
+			back->min_block_value = _population;
+			back->frame = frame;
+			back->num_blocks_set = 0;
+			_pending[frame] = back;
 		}
-		if (size < _min_block_value) {
-			_min_block_value = size;
+
+		//Track the range locally, pending frames are only ever touched by the ingesting thread
+		uint32_t **block_values = back->block_values;
+		uint32_t max_block_value = back->max_block_value;
+		uint32_t min_block_value = back->min_block_value;
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				uint32_t size = netutils::get_uint32_from_message(counts);
+				counts += 4;
+				block_values[y][x_offset + x] = size;
+				if (size > max_block_value) {
+					max_block_value = size;
+				}
+				if (size < min_block_value) {
+					min_block_value = size;
+				}
+			}
 		}
-		_num_blocks_sets++;
-		if (_num_blocks_sets == _num_blocks * _num_blocks) {
-			_num_blocks_sets = 0;
-			_wait_to_draw = false;
-			pthread_cond_signal(&_can_draw);
+		back->max_block_value = max_block_value;
+		back->min_block_value = min_block_value;
 
+		back->num_blocks_set += width * height;
+		if (back->num_blocks_set < _num_blocks * _num_blocks) {
+			return;
 		}
+
+		//Each worker reports its frames in order, so earlier frames still pending can never complete (their workers
+		//have gone, such as before a reconfiguration)
+		_pending.erase(frame);
+		while (!_pending.empty() && _pending.begin()->first < frame) {
+			_spare.push_back(_pending.begin()->second);
+			_pending.erase(_pending.begin());
+		}
+
+		//All workers have reported the frame: publish it, the frame it replaces (if never taken) is spare
+		profiling::lock(&_lock, profiling::VISUALIZATION_LOCK);
+		_Frame *replaced = _ready;
+		_ready = back;
+		_new_frame = true;
+		pthread_cond_signal(&_can_draw);
 		pthread_mutex_unlock(&_lock);
+		_spare.push_back(replaced);
 	}
 }
-;
+;
\ No newline at end of file
@@ -3,32 +3,80 @@
 
 #include "inttypes.h"
 #include "pthread.h"
+#include <map>
+#include <vector>
 
 /**
  *
- * Distributed visualization. Namespaced due to lack of OOD in glfw
+ * Distributed visualization. Namespaced due to lack of OOD in glfw. Draws to a glfw window, or in headless mode
+ * rasterizes the block densities to a sequence of PPM images (the only option in builds with HEADLESS defined)
  *
  */
 namespace visualization {
 
+	//The block values of one frame along with their range
+	struct _Frame {
+		uint32_t **block_values;
+		uint32_t max_block_value;
+		uint32_t min_block_value;
+		//The simulation frame (the number of frames simulated, naming headless images) & the number of its blocks set
+		//so far
+		uint32_t frame;
+		uint32_t num_blocks_set;
+	};
+
+	//Side length in pixels of headless images (rounded down to whole blocks)
+	const uint32_t IMAGE_SIZE = 800;
+
 	extern uint32_t _num_blocks;
 	extern uint32_t _population;
-	extern uint32_t **_block_values;
-	extern uint32_t _num_blocks_sets;
-	extern uint32_t _max_block_value;
-	extern uint32_t _min_block_value;
+
+	//Headless mode: output directory for images (NULL: glfw window) & the image buffer
+	extern const char *_output_dir;
+	extern unsigned char *_image;
+
+	//Stats are ingested into a pending frame per simulation frame (workers drift apart along the ring, so the stats of
+	//the next frame may arrive before the current one is complete). A completed frame is swapped with the ready frame,
+	//which the draw thread swaps with the front frame it renders from. Only the swaps take the lock
+	extern std::map<uint32_t, _Frame*> _pending;
+	extern std::vector<_Frame*> _spare;
+	extern _Frame *_ready;
+	extern _Frame *_front;
+	extern bool _new_frame;
+	extern bool _finished;
 
 	extern pthread_mutex_t _lock;
 	extern pthread_cond_t _can_draw;
-	extern bool _wait_to_draw;
+	extern pthread_t _thread;
+
+	// Starts the visualization thread. Images are written to output_dir if provided, else a glfw window is opened
+	void start(uint32_t num_blocks, uint32_t size, const char *output_dir);
 
-	void start(uint32_t num_blocks, uint32_t size);
+	// Headless mode: writes the last published frame (if still pending) & stops the visualization thread
+	void finish();
 
+#ifndef HEADLESS
 	void* _entry(void* arg);
 	void _loop();
 	void _draw();
+#endif
+
+	void* _headless_entry(void* arg);
+	void _write_image();
+
+	// A frame of block values (all zero)
+	_Frame* _allocate_frame();
+
+	// Waits for a newly published frame & makes it the front frame. Returns false once finished with none pending
+	bool _take_frame();
+
+	// The front frame's value for a block, normalized to [0, 1] over the frame's range
+	double _normalized_value(uint32_t x, uint32_t y);
 
-	void set_block_stat(uint32_t x, uint32_t y, uint32_t size);
+	// Ingests a worker's dense, serialized block counts (width x height, row major) of a simulation frame from a
+	// FRAME_FINISHED_WITH_STATS message, starting at column x_offset. The frame is published once every worker's
+	// columns of it have been ingested. Must only be called from one thread
+	void set_block_stats(uint32_t frame, uint32_t x_offset, uint32_t width, uint32_t height, unsigned char *counts);
 }
 
 #endif /* VISUALIZATION_H_ */
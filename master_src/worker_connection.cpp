@@ -1,6 +1,8 @@
 #include "worker_connection.h"
 
+#include <sys/socket.h>
 #include <unistd.h>
+#include <errno.h>
 #include <vector>
 #include <cstdio>
 #include <cstdlib>
@@ -16,11 +18,23 @@ WorkerConnection::WorkerConnection(int fd, Master& master, char* ip_address, int
 	this->master = &master;
 	this->ip_address = ip_address;
 	this->id = 0;
+	rejected = false;
+	listen_port = 0;
+	first_column = 0;
+	num_columns = 0;
+	running_join = false;
 	this->num_updates = num_updates;
-	update_count = 0;
+	update_count = master.get_args().get_start_frame();
 	left_neighbour = NULL;
 	right_neighbour = NULL;
-	next_expected_message = protocol::LISTENING_FOR_NEIGHBOUR_MESSAGE;
+	next_expected_message = protocol::JOIN_MESSAGE;
+	outgoing_bytes_sent = 0;
+	outgoing_start_ns = 0;
+	final_message = master.get_args().get_positions_output_dir() != NULL ?
+			protocol::POSITIONS_WRITTEN_MESSAGE : protocol::FINAL_POSITIONS_MESSAGE;
+	if (master.get_args().is_tracing_enabled()) {
+		trace.enable();
+	}
 
 }
 
@@ -32,14 +46,47 @@ const char* WorkerConnection::get_ip_address() {
 	return ip_address;
 }
 
+uint32_t WorkerConnection::get_id() {
+	return id;
+}
+
 void WorkerConnection::set_id(uint32_t id) {
 	this->id = id;
 }
 
+uint32_t WorkerConnection::get_listen_port() {
+	return listen_port;
+}
+
+void WorkerConnection::set_listen_port(uint32_t listen_port) {
+	this->listen_port = listen_port;
+}
+
+uint32_t WorkerConnection::get_first_column() {
+	return first_column;
+}
+
+uint32_t WorkerConnection::get_num_columns() {
+	return num_columns;
+}
+
+void WorkerConnection::set_columns(uint32_t first_column, uint32_t num_columns) {
+	this->first_column = first_column;
+	this->num_columns = num_columns;
+}
+
 Master& WorkerConnection::get_master() {
 	return *master;
 }
 
+TraceBuffer& WorkerConnection::get_trace() {
+	return trace;
+}
+
+void WorkerConnection::send_to_worker(const std::vector<unsigned char> &message) {
+	protocol::send_message(fd, message, &stats);
+}
+
 void WorkerConnection::verify_message_expected(unsigned char message_type) {
 
 #ifdef NET_DEBUG
@@ -58,10 +105,56 @@ void WorkerConnection::verify_message_expected(unsigned char message_type) {
 
 void WorkerConnection::handle_message(unsigned char *message, uint32_t length) {
 
+	//Checkpoints are written in the background, so they complete between whichever messages
+	if (message[0] == protocol::CHECKPOINT_WRITTEN_MESSAGE && master->get_args().get_checkpoint_interval() > 0) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'CHECKPOINT_WRITTEN_MESSAGE' message from '%s'(%d) \n", get_ip_address(), id);
+#endif
+		handle_checkpoint_written(message);
+		return;
+	}
+
+	//As are leave requests
+	if (message[0] == protocol::LEAVE_REQUEST_MESSAGE && master->get_args().is_elastic_enabled()) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'LEAVE_REQUEST_MESSAGE' message from '%s'(%d) \n", get_ip_address(), id);
+#endif
+		handle_leave_request();
+		return;
+	}
+
+	//& reconfigurations, after whichever frame worker 1 picked
+	if (message[0] == protocol::RECONFIGURED_MESSAGE && master->get_args().is_elastic_enabled()) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'RECONFIGURED_MESSAGE' message from '%s'(%d) \n", get_ip_address(), id);
+#endif
+		handle_reconfigured(message);
+		return;
+	}
+
+	//As are clock sync requests & traces, around the handshake & the final positions respectively
+	if (message[0] == protocol::CLOCK_SYNC_MESSAGE && master->get_args().is_tracing_enabled()) {
+		handle_clock_sync();
+		return;
+	}
+	if (message[0] == protocol::TRACE_MESSAGE && master->get_args().is_tracing_enabled()) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'TRACE_MESSAGE' message from '%s'(%d) \n", get_ip_address(), id);
+#endif
+		master->trace_received(id, message);
+		return;
+	}
+
 	verify_message_expected(message[0]);
+	unsigned char message_type = message[0];
+	uint64_t trace_start_ns = trace.start();
 
 	switch (message[0]) {
 
+		case protocol::JOIN_MESSAGE:
+			join();
+			break;
+
 		case protocol::NEIGHBOURS_SET_MESSAGE:
 			handle_neighbours_set();
 			break;
@@ -79,45 +172,130 @@ void WorkerConnection::handle_message(unsigned char *message, uint32_t length) {
 			break;
 
 		case protocol::FRAME_FINISHED_MESSAGE:
-			handle_frame_finished();
+			handle_frame_finished(message);
 			break;
 
 		case protocol::FRAME_FINISHED_WITH_STATS_MESSAGE:
 			handle_frame_with_stats_finished(message);
 			break;
 
+		case protocol::FRAMES_COMPLETED_MESSAGE:
+			handle_frames_completed(message);
+			break;
+
+		case protocol::PROGRESS_MESSAGE:
+			handle_progress(message);
+			break;
+
 		case protocol::FINAL_POSITIONS_MESSAGE:
 			handle_final_positions(message);
 			break;
 
+		case protocol::POSITIONS_WRITTEN_MESSAGE:
+			handle_positions_written(message);
+			break;
+
 		default:
 			//If we've reached here, we have closed the socket due to an invalid message
 			break;
 	}
+	trace.record(TraceBuffer::HANDLE_MESSAGE, trace_start_ns, message_type);
+}
+
+void WorkerConnection::join() {
+
+	//Get this worker's ID
+	id = master->worker_joined(*this);
+	if (id == 0 && master->get_args().is_elastic_enabled()) {
+		//Joins at the next reconfiguration
+		master->wait_to_join(*this);
+		return;
+	}
+	if (id == 0) {
+		fprintf(stderr, "[Err] Rejecting '%s', all workers have already joined\n", get_ip_address());
+		suspend_processing();
+		rejected = true;
+		return;
+	}
+
+	//Send JOIN_ACK back
+	send_join_ack(master->get_args().get_num_workers());
+
+	printf("   (%d) '%s' has joined\n", id, get_ip_address());
+
+	//Wait on master until all workers have joined and our right neighbour is known
+	next_expected_message = protocol::LISTENING_FOR_NEIGHBOUR_MESSAGE;
+	master->wait_on_master(*this);
+}
+
+void WorkerConnection::join_running_ring(uint32_t id, uint32_t num_workers) {
+	this->id = id;
+	running_join = true;
+	send_join_ack(num_workers);
+
+	printf("\n   (%d) '%s' is joining the running simulation (block columns %u-%u)\n", id, get_ip_address(),
+			first_column, first_column + num_columns - 1);
+
+	//The rest of the ring keeps running, so the worker's startup goes ahead without waiting on master
+	next_expected_message = protocol::LISTENING_FOR_NEIGHBOUR_MESSAGE;
+}
+
+void WorkerConnection::send_join_ack(uint32_t num_workers) {
+	send_message.resize(25);
+	send_message.at(0) = protocol::JOIN_ACK_MESSAGE;
+	netutils::insert_uint32_into_message(id, &send_message[1]);
+	netutils::insert_uint32_into_message(num_workers, &send_message[5]);
+	netutils::insert_uint32_into_message(listen_port, &send_message[9]);
+	netutils::insert_uint32_into_message(first_column, &send_message[13]);
+	netutils::insert_uint32_into_message(num_columns, &send_message[17]);
+	netutils::insert_uint32_into_message(running_join ? 1 : 0, &send_message[21]);
+#ifdef NET_DEBUG
+	printf("[NET_DEBUG] Sending 'JOIN_ACK' message back to '%s'(%d)\n", get_ip_address(), id);
+#endif
+	protocol::send_message(fd, send_message, &stats);
 }
 
 void WorkerConnection::handle_listening_for_neighbour() {
+	next_expected_message = protocol::NEIGHBOURS_SET_MESSAGE;
+
+	//A worker joining the running ring is sent its right neighbour straight away
+	if (running_join) {
+		master->joiner_listening(*this);
+		return;
+	}
+
+	//Wait on master until every worker is listening for its left neighbour
+	master->wait_on_master(*this);
+}
+
+void WorkerConnection::send_right_neighbour() {
 
-	//Send worker it's right neighbour that it should connect to
-	send_message.resize(netutils::IP_ADDRESS_LENGTH + 5);
+	//Send worker it's right neighbour that it should connect to (& the port it listens on)
+	send_message.resize(netutils::IP_ADDRESS_LENGTH + 9);
 	send_message.at(0) = protocol::RIGHT_NEIGHBOUR_DISCOVER_MESSAGE;
 	netutils::insert_uint32_into_message(netutils::IP_ADDRESS_LENGTH, &send_message[1]);
 	memcpy(&send_message[5], right_neighbour->ip_address, netutils::IP_ADDRESS_LENGTH);
+	netutils::insert_uint32_into_message(right_neighbour->listen_port, &send_message[5 + netutils::IP_ADDRESS_LENGTH]);
 
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending 'RIGHT_NEIGHBOUR_DISCOVER_MESSAGE' to '%s'(%d)\n", get_ip_address(), id);
 #endif
-	protocol::send_message(fd, send_message);
-
-	next_expected_message = protocol::NEIGHBOURS_SET_MESSAGE;
+	protocol::send_message(fd, send_message, &stats);
 }
 
 void WorkerConnection::handle_neighbours_set() {
-	//Wait on master to report that neighbours are listening
-	master->wait_on_master(id);
+	if (running_join) {
+		send_universe_parameters();
+		return;
+	}
+
+	//Wait on master until all neighbours are set
+	master->wait_on_master(*this);
+}
 
+void WorkerConnection::send_universe_parameters() {
 	//Notify worker of universe parameters
-	send_message.resize(29);
+	send_message.resize(69);
 	send_message.at(0) = protocol::SET_UNIVERSE_PARAMETERS_MESSAGE;
 	netutils::insert_uint32_into_message(master->get_args().get_world_size(), &send_message[1]);
 	netutils::insert_uint32_into_message(master->get_args().get_robot_range(), &send_message[5]);
@@ -126,99 +304,280 @@ void WorkerConnection::handle_neighbours_set() {
 	netutils::insert_uint32_into_message(master->get_args().is_visualization_enabled() ? 1 : 0, &send_message[17]);
 	netutils::insert_uint32_into_message(master->get_args().get_fov(), &send_message[21]);
 	netutils::insert_uint32_into_message(master->get_args().is_direction_inverted() ? 1 : 0, &send_message[25]);
+	netutils::insert_uint32_into_message(master->get_args().is_io_uring_enabled() ? 1 : 0, &send_message[29]);
+	netutils::insert_uint32_into_message(master->get_args().is_frame_aggregation_enabled() ? 1 : 0,
+			&send_message[33]);
+	netutils::insert_uint32_into_message(master->get_args().get_progress_frames(), &send_message[37]);
+	netutils::insert_uint32_into_message(master->get_args().get_progress_ms(), &send_message[41]);
+	netutils::insert_uint32_into_message(master->get_args().get_stats_pool_size(), &send_message[45]);
+	netutils::insert_uint32_into_message(master->get_args().get_stats_interval(), &send_message[49]);
+	netutils::insert_uint32_into_message(master->get_args().get_start_frame(), &send_message[53]);
+	netutils::insert_uint32_into_message(master->get_args().is_elastic_enabled() ? 1 : 0, &send_message[57]);
+	netutils::insert_uint32_into_message(master->get_args().is_tracing_enabled() ? 1 : 0, &send_message[61]);
+	netutils::insert_uint32_into_message(master->get_args().get_perf_counters_interval(), &send_message[65]);
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending 'SET_UNIVERSE_PARAMETERS_MESSAGE' to '%s'(%d)\n", get_ip_address(), id);
 #endif
-	protocol::send_message(fd, send_message);
+	protocol::send_message(fd, send_message, &stats);
 
 	next_expected_message = protocol::UNIVERSE_PARAMETERS_SET_MESSAGE;
 }
 
 void WorkerConnection::handle_univ_params_set() {
-	//Wait on master to send SET_ROBOTS_MESSAGE
-	master->wait_on_master(id);
+	//Wait on master to send SET_ROBOTS_MESSAGE (a worker joining the running ring takes its robots from its left
+	//neighbour instead)
 	next_expected_message = protocol::ROBOTS_SET_MESSAGE;
+	if (!running_join) {
+		master->wait_on_master(*this);
+	}
 }
 
 void WorkerConnection::handle_robots_set() {
+	if (running_join) {
+		master->joiner_ready(*this);
+		return;
+	}
+
 	//Wait on master to begin simulation
-	master->wait_on_master(id);
-	send_message = {protocol::START_SIMULATION_MESSAGE};
+	master->wait_on_master(*this);
+}
+
+void WorkerConnection::start_simulation() {
+	//Tell the worker where to write its final positions shard, if anywhere
+	const char *positions_output_dir = master->get_args().get_positions_output_dir();
+	uint32_t path_length = positions_output_dir != NULL ? strlen(positions_output_dir) : 0;
+
+	//& where to write checkpoints
+	uint32_t checkpoint_interval = master->get_args().get_checkpoint_interval();
+	const char *checkpoint_dir = master->get_args().get_checkpoint_dir();
+	uint32_t checkpoint_path_length = checkpoint_dir != NULL ? strlen(checkpoint_dir) : 0;
+
+	send_message.resize(13 + path_length + checkpoint_path_length);
+	send_message.at(0) = protocol::START_SIMULATION_MESSAGE;
+	netutils::insert_uint32_into_message(path_length, &send_message[1]);
+	if (path_length > 0) {
+		memcpy(&send_message[5], positions_output_dir, path_length);
+	}
+	netutils::insert_uint32_into_message(checkpoint_interval, &send_message[5 + path_length]);
+	netutils::insert_uint32_into_message(checkpoint_path_length, &send_message[9 + path_length]);
+	if (checkpoint_path_length > 0) {
+		memcpy(&send_message[13 + path_length], checkpoint_dir, checkpoint_path_length);
+	}
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending 'START_SIMULATION_MESSAGE' to '%s'(%d)\n", get_ip_address(), id);
 #endif
-	protocol::send_message(fd, send_message);
-	if (num_updates != 0) {
-		if (master->get_args().is_visualization_enabled()) {
-			next_expected_message = protocol::FRAME_FINISHED_WITH_STATS_MESSAGE;
+	protocol::send_message(fd, send_message, &stats);
+	expect_simulation_messages();
+}
+
+void WorkerConnection::resume_simulation(int32_t update_count) {
+	this->update_count = update_count;
+	expect_simulation_messages();
+}
+
+void WorkerConnection::expect_simulation_messages() {
+	if (num_updates != 0 && update_count != num_updates) {
+		if (master->get_args().is_frame_aggregation_enabled()) {
+			//Only the last worker in the ring reports frame completion
+			if (id == master->get_args().get_num_workers()) {
+				next_expected_message = protocol::FRAMES_COMPLETED_MESSAGE;
+			} else {
+				next_expected_message = final_message;
+			}
+		} else if (master->get_args().is_progress_reporting_enabled()) {
+			next_expected_message = protocol::PROGRESS_MESSAGE;
 		} else {
-			next_expected_message = protocol::FRAME_FINISHED_MESSAGE;
+			expect_frame_message();
 		}
 	} else {
-		next_expected_message = protocol::FINAL_POSITIONS_MESSAGE;
+		next_expected_message = final_message;
 	}
 }
 
-void WorkerConnection::handle_frame_finished() {
-	master->frame_completed(id);
-	if (num_updates >= 0 && update_count == num_updates - 1) {
-		next_expected_message = protocol::FINAL_POSITIONS_MESSAGE;
+void WorkerConnection::expect_frame_message() {
+	if (num_updates >= 0 && update_count == num_updates) {
+		next_expected_message = final_message;
+	} else if (master->get_args().is_visualization_enabled()
+			&& update_count % master->get_args().get_stats_interval() == 0) {
+		next_expected_message = protocol::FRAME_FINISHED_WITH_STATS_MESSAGE;
+	} else {
+		next_expected_message = protocol::FRAME_FINISHED_MESSAGE;
 	}
+}
+
+void WorkerConnection::handle_frame_finished(unsigned char* message) {
+	master->frame_completed(id, netutils::get_uint32_from_message(message + 1) * 1000ULL);
 	update_count++;
+	expect_frame_message();
 }
 
 void WorkerConnection::handle_frame_with_stats_finished(unsigned char* message) {
-	uint32_t num_blocks = netutils::get_uint32_from_message(message + 1);
-	for (unsigned int i = 0; i < num_blocks; i++) {
-		uint32_t offset = i * 12;
-		uint32_t x = netutils::get_uint32_from_message(message + 5 + offset);
-		uint32_t y = netutils::get_uint32_from_message(message + 9 + offset);
-		uint32_t size = netutils::get_uint32_from_message(message + 13 + offset);
-		visualization::set_block_stat(x, y, size);
-	}
-	master->frame_completed(id);
+	uint32_t frame = netutils::get_uint32_from_message(message + 1);
+	uint64_t compute_ns = netutils::get_uint32_from_message(message + 5) * 1000ULL;
+	uint32_t x_offset = netutils::get_uint32_from_message(message + 9);
+	uint32_t width = netutils::get_uint32_from_message(message + 13);
+	uint32_t height = netutils::get_uint32_from_message(message + 17);
+	visualization::set_block_stats(frame, x_offset, width, height, message + 21);
+	master->frame_completed(id, compute_ns);
+	update_count++;
+	expect_frame_message();
+}
+
+void WorkerConnection::handle_frames_completed(unsigned char* message) {
+	master->frames_completed(netutils::get_uint32_from_message(message + 1));
 
 	if (num_updates >= 0 && update_count == num_updates - 1) {
-		next_expected_message = protocol::FINAL_POSITIONS_MESSAGE;
+		next_expected_message = final_message;
 	}
 	update_count++;
 }
 
+void WorkerConnection::handle_progress(unsigned char* message) {
+	//A record may cover many frames, the final frame is always reported
+	update_count = (int32_t) netutils::get_uint32_from_message(message + 1);
+	uint32_t num_robots = netutils::get_uint32_from_message(message + 5);
+	FrameTimings timings;
+	timings.deserialize(message + 9);
+	MessageStats message_stats[MessageStats::NUM_CONNECTIONS];
+	unsigned char *location = message + 9 + FrameTimings::SERIALIZED_LENGTH;
+	uint32_t num_connections = netutils::get_uint32_from_message(location);
+	location += 4;
+	for (uint32_t i = 0; i < num_connections; i++) {
+		uint32_t connection = netutils::get_uint32_from_message(location);
+		location += 4;
+		if (connection >= MessageStats::NUM_CONNECTIONS) {
+			fprintf(stderr, "[Err] Worker '%s'(%d) reported an unknown connection %u\n", get_ip_address(), id, connection);
+			exit(EXIT_FAILURE);
+		}
+		location += message_stats[connection].deserialize(location);
+	}
+	master->progress_reported(id, update_count, num_robots, timings, message_stats);
+
+	if (num_updates >= 0 && update_count == num_updates) {
+		next_expected_message = final_message;
+	}
+}
+
 void WorkerConnection::handle_final_positions(unsigned char* message) {
-	// Update master's collection of robots
-	uint32_t num_robots = netutils::get_uint32_from_message(message + 1);
-	for (unsigned int i = 0; i < num_robots; i++) {
-		unsigned char* p = message + 5 + (i * Robot::NORMAL_SERIALIZED_LENGTH);
-		uint32_t robot_id = Robot::get_id_from_serialized(p);
-		Robot *robot = master->get_robot(robot_id);
-		robot->update_from_serialized(p, Robot::NORMAL_SERIALIZED_VERSION);
+	master->final_positions_received(message + 5, netutils::get_uint32_from_message(message + 1));
+	master->wait_on_master(*this);
+}
+
+void WorkerConnection::handle_positions_written(unsigned char* message) {
+	master->positions_written(id, netutils::get_uint32_from_message(message + 1));
+	master->wait_on_master(*this);
+}
+
+void WorkerConnection::handle_checkpoint_written(unsigned char* message) {
+	master->checkpoint_written(id, netutils::get_uint32_from_message(message + 1),
+			netutils::get_uint32_from_message(message + 5));
+}
+
+void WorkerConnection::handle_leave_request() {
+	master->leave_requested(id);
+}
+
+void WorkerConnection::handle_reconfigured(unsigned char* message) {
+	//The worker's later messages are handled once the whole ring has reconfigured
+	suspend_processing();
+	master->reconfigured(*this, netutils::get_uint32_from_message(message + 1));
+}
+
+void WorkerConnection::handle_clock_sync() {
+	uint64_t now_ns = FrameTimings::get_monotonic_nanoseconds();
+	send_message.resize(9);
+	send_message.at(0) = protocol::CLOCK_SYNC_MESSAGE;
+	netutils::insert_uint32_into_message(now_ns >> 32, &send_message[1]);
+	netutils::insert_uint32_into_message(now_ns & 0xFFFFFFFF, &send_message[5]);
+	protocol::send_message(fd, send_message, &stats);
+}
+
+void WorkerConnection::send_reconfigure(uint32_t new_id, uint32_t num_workers, uint32_t first_column,
+		uint32_t num_columns, bool accept_left, bool accept_columns, WorkerConnection *connect_to) {
+	uint32_t ip_addr_len = connect_to != NULL ? netutils::IP_ADDRESS_LENGTH : 0;
+	send_message.resize(29 + ip_addr_len + (connect_to != NULL ? 4 : 0));
+	send_message.at(0) = protocol::RECONFIGURE_MESSAGE;
+	netutils::insert_uint32_into_message(new_id, &send_message[1]);
+	netutils::insert_uint32_into_message(num_workers, &send_message[5]);
+	netutils::insert_uint32_into_message(first_column, &send_message[9]);
+	netutils::insert_uint32_into_message(num_columns, &send_message[13]);
+	netutils::insert_uint32_into_message(accept_left ? 1 : 0, &send_message[17]);
+	netutils::insert_uint32_into_message(accept_columns ? 1 : 0, &send_message[21]);
+	netutils::insert_uint32_into_message(ip_addr_len, &send_message[25]);
+	if (connect_to != NULL) {
+		memcpy(&send_message[29], connect_to->ip_address, ip_addr_len);
+		netutils::insert_uint32_into_message(connect_to->listen_port, &send_message[29 + ip_addr_len]);
 	}
-	master->wait_on_master(id);
+#ifdef NET_DEBUG
+	printf("[NET_DEBUG] Sending 'RECONFIGURE_MESSAGE' to '%s'(%d)\n", get_ip_address(), id);
+#endif
+	protocol::send_message(fd, send_message, &stats);
 }
 
-void WorkerConnection::set_left_neighbour(WorkerConnection &left_neighbour) {
-	this->left_neighbour = &left_neighbour;
+void WorkerConnection::send_checkpoint_committed(uint32_t frame,
+		const std::vector<std::pair<uint32_t, uint32_t>> &orphaned_shards) {
+	send_message.resize(9 + (orphaned_shards.size() * 8));
+	send_message.at(0) = protocol::CHECKPOINT_COMMITTED_MESSAGE;
+	netutils::insert_uint32_into_message(frame, &send_message[1]);
+	netutils::insert_uint32_into_message(orphaned_shards.size(), &send_message[5]);
+	for (unsigned int i = 0; i < orphaned_shards.size(); i++) {
+		netutils::insert_uint32_into_message(orphaned_shards.at(i).first, &send_message[9 + (i * 8)]);
+		netutils::insert_uint32_into_message(orphaned_shards.at(i).second, &send_message[13 + (i * 8)]);
+	}
+#ifdef NET_DEBUG
+	printf("[NET_DEBUG] Sending 'CHECKPOINT_COMMITTED_MESSAGE' to '%s'(%d)\n", get_ip_address(), id);
+#endif
+	protocol::send_message(fd, send_message, &stats);
 }
 
-void WorkerConnection::set_right_neighbour(WorkerConnection &right_neighbour) {
-	this->right_neighbour = &right_neighbour;
+void WorkerConnection::start_sending_robots() {
+	outgoing_bytes_sent = 0;
+	outgoing_start_ns = FrameTimings::get_monotonic_nanoseconds();
+	if (!master->next_robots_chunk(id, outgoing_message)) {
+		outgoing_message.clear();
+	}
 }
 
-void WorkerConnection::start() {
-	//Wait until master releases the lock so we can start
-	master->get_and_release_lock();
+bool WorkerConnection::has_outgoing() {
+	return !outgoing_message.empty();
+}
 
-	while (true) {
-		int result = fill_buffer_and_process();
-		if (result <= 0) {
-			if (result == 0) {
-				fprintf(stderr, "[Err] Worker '%s'(%d) closed the connection\n", get_ip_address(), id);
-			} else {
-				fprintf(stderr, "[Err] Failed retrieving message from socket\n");
-			}
-			exit(EXIT_FAILURE);
+int WorkerConnection::handle_outgoing() {
+	while (!outgoing_message.empty()) {
+		ssize_t result = send(fd, &outgoing_message[outgoing_bytes_sent], outgoing_message.size() - outgoing_bytes_sent,
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (result < 0) {
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+		outgoing_bytes_sent += result;
+		if (outgoing_bytes_sent < outgoing_message.size()) {
+			continue;
 		}
 
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Sent 'SET_ROBOTS_MESSAGE' chunk to '%s'(%d)\n", get_ip_address(), id);
+#endif
+		//Send time includes waiting for the socket to become writable
+		uint64_t now_ns = FrameTimings::get_monotonic_nanoseconds();
+		stats.record_sent(outgoing_message[4], outgoing_message.size(), now_ns - outgoing_start_ns);
+		outgoing_bytes_sent = 0;
+		outgoing_start_ns = now_ns;
+		if (!master->next_robots_chunk(id, outgoing_message)) {
+			outgoing_message.clear();
+		}
 	}
+	return 0;
 }
 
+void WorkerConnection::set_left_neighbour(WorkerConnection &left_neighbour) {
+	this->left_neighbour = &left_neighbour;
+}
+
+void WorkerConnection::set_right_neighbour(WorkerConnection &right_neighbour) {
+	this->right_neighbour = &right_neighbour;
+}
+
+int WorkerConnection::handle_incoming() {
+	int result = fill_buffer_and_process();
+	return rejected ? 0 : result;
+}
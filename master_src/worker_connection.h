@@ -6,16 +6,19 @@
 #include <inttypes.h>
 #include <pthread.h>
 #include <string>
+#include <vector>
+#include <utility>
 
 #include "master.h"
+#include "trace_buffer.h"
 
 //Forward declaration
 class Master;
 
 /**
  *
- * Wrapper around a worker socket connection that send/responds to messages. Intended to be ran in its own thread.
- * Communications with the "Master" thread via a direct reference
+ * Wrapper around a worker socket connection that send/responds to messages. Driven by the "Master" event loop, which
+ * it communicates with via a direct reference
  *
  */
 class WorkerConnection: public ConnectionHandler {
@@ -25,9 +28,25 @@ class WorkerConnection: public ConnectionHandler {
 		char* ip_address;
 		uint32_t id;
 
+		//Was the worker turned away from a full lobby? (its connection is then dropped by master)
+		bool rejected;
+
+		//The port the worker listens on for its left neighbour & the block columns of its slice
+		uint32_t listen_port;
+		uint32_t first_column;
+		uint32_t num_columns;
+
+		//Is the worker joining the running ring (elastic runs)? Its startup then runs alongside the simulation
+		bool running_join;
+
 		//A send message buffer
 		std::vector<unsigned char> send_message;
 
+		//A message (length header included) being sent without blocking, how much of it has been sent & since when
+		std::vector<unsigned char> outgoing_message;
+		size_t outgoing_bytes_sent;
+		uint64_t outgoing_start_ns;
+
 		//Number of updates
 		int32_t num_updates;
 		int32_t update_count;
@@ -38,34 +57,111 @@ class WorkerConnection: public ConnectionHandler {
 
 		unsigned char next_expected_message;
 
+		//Messages handled for this worker (tracing runs)
+		TraceBuffer trace;
+
+		//The last message expected from the worker (FINAL_POSITIONS or POSITIONS_WRITTEN)
+		unsigned char final_message;
+
 		void handle_message(unsigned char *message, uint32_t length);
-		void handle_join();
 		void handle_listening_for_neighbour();
 		void handle_neighbours_set();
 		void handle_univ_params_set();
 		void handle_robots_set();
-		void handle_frame_finished();
+		void handle_frame_finished(unsigned char* message);
 		void handle_frame_with_stats_finished(unsigned char* message);
+		void handle_frames_completed(unsigned char* message);
+		void handle_progress(unsigned char* message);
 		void handle_final_positions(unsigned char *message);
+		void handle_positions_written(unsigned char *message);
+		void handle_checkpoint_written(unsigned char *message);
+		void handle_leave_request();
+		void handle_reconfigured(unsigned char *message);
+		void handle_clock_sync();
 
 		void verify_message_expected(unsigned char message_type);
 
+		//Sends JOIN_ACK with the worker's id, listen port & columns, in a ring of num_workers
+		void send_join_ack(uint32_t num_workers);
+
+		//Sets the next expected message once the simulation runs from update_count frames
+		void expect_simulation_messages();
+
+		//Sets the next expected message after update_count frames when the worker reports every frame
+		void expect_frame_message();
+
 	public:
 		WorkerConnection(int fd, Master& master, char* ip_address, int32_t num_updates);
 		~WorkerConnection();
 
 		const char* get_ip_address();
 
+		uint32_t get_id();
 		void set_id(uint32_t id);
 
+		//The port the worker listens on for its left neighbour
+		uint32_t get_listen_port();
+		void set_listen_port(uint32_t listen_port);
+
+		//The block columns of the worker's slice
+		uint32_t get_first_column();
+		uint32_t get_num_columns();
+		void set_columns(uint32_t first_column, uint32_t num_columns);
+
 		Master& get_master();
 
+		//Messages handled for this worker (tracing runs)
+		TraceBuffer& get_trace();
+
+		//Sends a message to the worker, blocking until it has been sent
+		void send_to_worker(const std::vector<unsigned char> &message);
+
 		//Sets our left & right neighbours respectively
 		void set_left_neighbour(WorkerConnection &left_neighbour);
 		void set_right_neighbour(WorkerConnection &right_neighbour);
 
-		//Main connection routine
-		void start();
+		//Receives and handles incoming messages once the socket is readable. 1: Success, 0: Socket closed or the worker
+		//was rejected (either way the connection is done with), -1: Error
+		int handle_incoming();
+
+		//Joins the worker to the master's lobby once its JOIN has been received (again for workers left waiting to
+		//join an elastic run)
+		void join();
+
+		//Joins a worker that was left waiting into the running ring under the id, once master has picked its columns
+		//(elastic runs)
+		void join_running_ring(uint32_t id, uint32_t num_workers);
+
+		//Sends the worker its part in splicing a worker into or out of the ring: its id (0: it leaves) & columns in the
+		//new ring, whether neighbours connect to it & the worker it connects to (NULL: none) (elastic runs)
+		void send_reconfigure(uint32_t new_id, uint32_t num_workers, uint32_t first_column, uint32_t num_columns,
+				bool accept_left, bool accept_columns, WorkerConnection *connect_to);
+
+		//Tells the worker the manifest now holds the checkpoint of the frame (& which shards of workers that have left
+		//to remove, as (frame, shard) pairs)
+		void send_checkpoint_committed(uint32_t frame, const std::vector<std::pair<uint32_t, uint32_t>> &orphaned_shards);
+
+		//Sends the worker its right neighbour (once every worker is listening for its left neighbour)
+		void send_right_neighbour();
+
+		//Sends the universe parameters (once neighbours are set)
+		void send_universe_parameters();
+
+		//Tells the worker to begin the simulation (once robots are set)
+		void start_simulation();
+
+		//Carries on with the worker's messages from the frame, once the ring has been reconfigured (elastic runs)
+		void resume_simulation(int32_t update_count);
+
+		//Takes the first chunk of the worker's robots from the master, to be sent once the socket is writable
+		void start_sending_robots();
+
+		//Is there a message waiting to be sent?
+		bool has_outgoing();
+
+		//Sends as much as the socket takes without blocking, moving on to the next chunk of robots as each is sent.
+		//0: Success, -1: Error
+		int handle_outgoing();
 };
 
 #endif /* WORKER_CONNECTION_H_ */
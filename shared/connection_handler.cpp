@@ -4,9 +4,15 @@
 #include <sys/socket.h>
 #include <cstring>
 
+#include "frame_timings.h"
+
 ConnectionHandler::ConnectionHandler(int fd) {
 	this->fd = fd;
 	unprocessed_bytes = 0;
+	handling_bytes = 0;
+	bytes_received = 0;
+	last_receive_ns = 0;
+	suspended = false;
 }
 
 ConnectionHandler::~ConnectionHandler() {
@@ -19,6 +25,10 @@ int ConnectionHandler::fill_buffer_and_process() {
 		exit(EXIT_FAILURE);
 	}
 	int result = recv(fd, recv_buffer + unprocessed_bytes, BUFFER_SIZE - unprocessed_bytes, 0);
+	if (result > 0) {
+		bytes_received += result;
+		last_receive_ns = FrameTimings::get_monotonic_nanoseconds();
+	}
 	if (result > 0 || unprocessed_bytes > 0) {
 		unprocessed_bytes += result;
 		process_buffer();
@@ -30,7 +40,7 @@ int ConnectionHandler::fill_buffer_and_process() {
 void ConnectionHandler::process_buffer() {
 
 	// Do we have the payload length? (4 byte header)
-	while (unprocessed_bytes >= 4) {
+	while (!suspended && unprocessed_bytes >= 4) {
 		uint32_t payload_len;
 		memcpy(&payload_len, recv_buffer, sizeof(uint32_t));
 		payload_len = ntohl(payload_len);
@@ -40,7 +50,12 @@ void ConnectionHandler::process_buffer() {
 			break;
 		}
 
+		//Latency since the latest read, which completed the message unless it was kept while processing was suspended
+		stats.record_received(recv_buffer[4], payload_len + 4,
+				FrameTimings::get_monotonic_nanoseconds() - last_receive_ns);
+		handling_bytes = payload_len + 4;
 		handle_message(&recv_buffer[4], payload_len);
+		handling_bytes = 0;
 
 		//Shuffled remaining data down if applicable
 		unprocessed_bytes -= (payload_len + 4);
@@ -53,3 +68,25 @@ void ConnectionHandler::process_buffer() {
 int ConnectionHandler::get_fd() {
 	return fd;
 }
+
+uint64_t ConnectionHandler::get_bytes_received() {
+	return bytes_received;
+}
+
+const MessageStats& ConnectionHandler::get_stats() {
+	return stats;
+}
+
+void ConnectionHandler::suspend_processing() {
+	suspended = true;
+}
+
+void ConnectionHandler::resume_processing() {
+	suspended = false;
+	process_buffer();
+}
+
+void ConnectionHandler::take_unhandled_bytes(std::vector<unsigned char> &bytes) {
+	bytes.assign(recv_buffer + handling_bytes, recv_buffer + unprocessed_bytes);
+	unprocessed_bytes = handling_bytes;
+}
@@ -2,8 +2,11 @@
 #define CONNECTION_HANDLER_H_
 
 #include <string>
+#include <vector>
 #include <inttypes.h>
 
+#include "message_stats.h"
+
 /**
  * An abstract class that provides an efficient buffer for receiving and handling socket messages
  *
@@ -19,12 +22,27 @@ class ConnectionHandler {
 		//Handles the message appropriately
 		virtual void handle_message(unsigned char *message, uint32_t length) = 0;
 
+		//Messages sent & received over the connection (sends are counted by passing them to protocol::send_message)
+		MessageStats stats;
+
 	private:
 		//Receive buffer (12 MiB)
 		const static int BUFFER_SIZE = 12582912;
 		unsigned char recv_buffer[BUFFER_SIZE];
 		size_t unprocessed_bytes;
 
+		//Length of the message being handled (at the front of the buffer), 0 between messages
+		size_t handling_bytes;
+
+		//Total bytes received over the connection
+		uint64_t bytes_received;
+
+		//When the last read completed (receive to handle latency)
+		uint64_t last_receive_ns;
+
+		//While suspended, received messages are kept in the buffer without being handled
+		bool suspended;
+
 		//Attempts to process a message
 		void process_buffer();
 
@@ -35,6 +53,20 @@ class ConnectionHandler {
 		virtual ~ConnectionHandler();
 
 		int get_fd();
+
+		uint64_t get_bytes_received();
+
+		//Per message type counters (a snapshot may be taken from any thread)
+		const MessageStats& get_stats();
+
+		//Stops handling buffered messages (takes effect after the message currently being handled)
+		void suspend_processing();
+
+		//Continues handling buffered messages, including those received while suspended
+		void resume_processing();
+
+		//Takes whatever was received after the message being handled, for whoever reads the socket from here on
+		void take_unhandled_bytes(std::vector<unsigned char> &bytes);
 };
 
 #endif /* CONNECTION_HANDLER_H_ */
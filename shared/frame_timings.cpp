@@ -0,0 +1,163 @@
+#include "frame_timings.h"
+
+#include <time.h>
+
+#include "netutils.h"
+
+static const char* PHASE_NAMES[FrameTimings::NUM_PHASES] = { "clear_ghost_strips", "update_positions", "halo_send",
+		"halo_receive", "halo_peer_wait", "update_sensors", "set_speeds" };
+
+FrameTimings::FrameTimings() {
+	reset();
+}
+
+void FrameTimings::reset() {
+	num_frames = 0;
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		total_ns[phase] = 0;
+		for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+			buckets[phase][bucket] = 0;
+		}
+	}
+	frame_total_ns = 0;
+	for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+		frame_buckets[bucket] = 0;
+	}
+	current_frame_ns = 0;
+}
+
+uint32_t FrameTimings::get_bucket(uint64_t duration_ns) {
+	//Bucket b holds [2^(b-1), 2^b) us, i.e. the bit length of the duration in microseconds
+	uint64_t duration_us = duration_ns / 1000;
+	uint32_t bucket = duration_us == 0 ? 0 : 64 - __builtin_clzll(duration_us);
+	if (bucket >= NUM_BUCKETS) {
+		bucket = NUM_BUCKETS - 1;
+	}
+	return bucket;
+}
+
+void FrameTimings::record(Phase phase, uint64_t duration_ns) {
+	total_ns[phase] += duration_ns;
+	buckets[phase][get_bucket(duration_ns)]++;
+	current_frame_ns += duration_ns;
+}
+
+uint64_t FrameTimings::record_since(Phase phase, uint64_t start_ns) {
+	uint64_t now_ns = get_monotonic_nanoseconds();
+	record(phase, now_ns - start_ns);
+	return now_ns;
+}
+
+void FrameTimings::frame_completed() {
+	num_frames++;
+	frame_total_ns += current_frame_ns;
+	frame_buckets[get_bucket(current_frame_ns)]++;
+	current_frame_ns = 0;
+}
+
+void FrameTimings::record_frame(uint64_t duration_ns) {
+	num_frames++;
+	frame_total_ns += duration_ns;
+	frame_buckets[get_bucket(duration_ns)]++;
+}
+
+void FrameTimings::add(const FrameTimings &other) {
+	num_frames += other.num_frames;
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		total_ns[phase] += other.total_ns[phase];
+		for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+			buckets[phase][bucket] += other.buckets[phase][bucket];
+		}
+	}
+	frame_total_ns += other.frame_total_ns;
+	for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+		frame_buckets[bucket] += other.frame_buckets[bucket];
+	}
+}
+
+uint32_t FrameTimings::get_num_frames() const {
+	return num_frames;
+}
+
+uint64_t FrameTimings::get_total_ns(Phase phase) const {
+	return total_ns[phase];
+}
+
+uint64_t FrameTimings::get_frame_total_ns() const {
+	return frame_total_ns;
+}
+
+uint64_t FrameTimings::get_percentile_us(const uint32_t *histogram, double fraction) const {
+	if (num_frames == 0) {
+		return 0;
+	}
+	uint64_t target = fraction * num_frames;
+	if (target == 0) {
+		target = 1;
+	}
+	uint64_t count = 0;
+	for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+		count += histogram[bucket];
+		if (count >= target) {
+			return 1ULL << bucket;
+		}
+	}
+	return 1ULL << (NUM_BUCKETS - 1);
+}
+
+uint64_t FrameTimings::get_percentile_us(Phase phase, double fraction) const {
+	return get_percentile_us(buckets[phase], fraction);
+}
+
+uint64_t FrameTimings::get_frame_percentile_us(double fraction) const {
+	return get_percentile_us(frame_buckets, fraction);
+}
+
+void FrameTimings::serialize(unsigned char *location) const {
+	netutils::insert_uint32_into_message(num_frames, location);
+	location += 4;
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		netutils::insert_uint32_into_message(total_ns[phase] / 1000, location);
+		location += 4;
+		for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+			netutils::insert_uint32_into_message(buckets[phase][bucket], location);
+			location += 4;
+		}
+	}
+	netutils::insert_uint32_into_message(frame_total_ns / 1000, location);
+	location += 4;
+	for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+		netutils::insert_uint32_into_message(frame_buckets[bucket], location);
+		location += 4;
+	}
+}
+
+void FrameTimings::deserialize(unsigned char *location) {
+	num_frames = netutils::get_uint32_from_message(location);
+	location += 4;
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		total_ns[phase] = netutils::get_uint32_from_message(location) * 1000ULL;
+		location += 4;
+		for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+			buckets[phase][bucket] = netutils::get_uint32_from_message(location);
+			location += 4;
+		}
+	}
+	frame_total_ns = netutils::get_uint32_from_message(location) * 1000ULL;
+	location += 4;
+	for (uint32_t bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+		frame_buckets[bucket] = netutils::get_uint32_from_message(location);
+		location += 4;
+	}
+	current_frame_ns = 0;
+}
+
+const char* FrameTimings::get_phase_name(Phase phase) {
+	return PHASE_NAMES[phase];
+}
+
+uint64_t FrameTimings::get_monotonic_nanoseconds() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
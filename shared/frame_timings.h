@@ -0,0 +1,101 @@
+#ifndef FRAME_TIMINGS_H_
+#define FRAME_TIMINGS_H_
+
+#include <inttypes.h>
+
+/**
+ * Time spent by a worker's halo exchange preparing & sending its ghost strips and moved robots, and adding those
+ * received, over a frame (the remainder of the exchange is spent waiting on its neighbours)
+ *
+ */
+struct HaloTimings {
+	uint64_t send_ns;
+	uint64_t receive_ns;
+};
+
+/**
+ * Per phase timings of a worker's frames: the total time & a histogram of per frame durations for each phase of the
+ * simulation loop, and the same for whole frames (the sum of their phases). Histogram buckets are powers of two in
+ * microseconds: bucket 0 holds frames under 1us, bucket b frames in [2^(b-1), 2^b) us & the last bucket everything
+ * longer. Workers accumulate timings between progress records, which carry them to master (see PROGRESS_MESSAGE)
+ *
+ */
+class FrameTimings {
+
+	public:
+		enum Phase {
+			CLEAR_GHOST_STRIPS,
+			UPDATE_POSITIONS,
+			HALO_SEND,
+			HALO_RECEIVE,
+			HALO_PEER_WAIT,
+			UPDATE_SENSORS,
+			SET_SPEEDS,
+			NUM_PHASES
+		};
+
+		static const uint32_t NUM_BUCKETS = 24;
+
+		//Number of frames, then per phase & for whole frames the total time (microseconds) & the bucket counts
+		static const uint32_t SERIALIZED_LENGTH = 4 + (NUM_PHASES + 1) * (4 + NUM_BUCKETS * 4);
+
+	private:
+		uint32_t num_frames;
+		uint64_t total_ns[NUM_PHASES];
+		uint32_t buckets[NUM_PHASES][NUM_BUCKETS];
+
+		//Whole frames, and the phases recorded so far for the current frame
+		uint64_t frame_total_ns;
+		uint32_t frame_buckets[NUM_BUCKETS];
+		uint64_t current_frame_ns;
+
+		static uint32_t get_bucket(uint64_t duration_ns);
+
+		uint64_t get_percentile_us(const uint32_t *histogram, double fraction) const;
+
+	public:
+		FrameTimings();
+
+		void reset();
+
+		// Records a phase's duration for the current frame
+		void record(Phase phase, uint64_t duration_ns);
+
+		// Records a phase that started at the given time & ended now. Returns now (the start of the next phase)
+		uint64_t record_since(Phase phase, uint64_t start_ns);
+
+		// Counts the current frame once all of its phases have been recorded
+		void frame_completed();
+
+		// Counts a whole frame whose phases were not timed (e.g. a worker's frame as seen by master)
+		void record_frame(uint64_t duration_ns);
+
+		// Adds the frames of other timings to ours
+		void add(const FrameTimings &other);
+
+		uint32_t get_num_frames() const;
+
+		uint64_t get_total_ns(Phase phase) const;
+
+		// Total time of whole frames
+		uint64_t get_frame_total_ns() const;
+
+		// Upper bound of the histogram bucket holding the given fraction (0..1] of frames (microseconds, 0: no frames)
+		uint64_t get_percentile_us(Phase phase, double fraction) const;
+
+		// As get_percentile_us, for whole frames
+		uint64_t get_frame_percentile_us(double fraction) const;
+
+		// Serializes into SERIALIZED_LENGTH bytes at the location
+		void serialize(unsigned char *location) const;
+
+		// Deserializes SERIALIZED_LENGTH bytes at the location
+		void deserialize(unsigned char *location);
+
+		static const char* get_phase_name(Phase phase);
+
+		// Current time from a monotonic clock (nanoseconds)
+		static uint64_t get_monotonic_nanoseconds();
+};
+
+#endif /* FRAME_TIMINGS_H_ */
@@ -0,0 +1,69 @@
+#include "manifest.h"
+
+#include <cstdio>
+
+Manifest::Manifest() {
+	world_size = 0;
+	population_size = 0;
+	frame = 0;
+}
+
+int Manifest::read(const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "[Err] Failed to open manifest '%s'\n", path);
+		return -1;
+	}
+
+	uint32_t num_shards;
+	bool valid = fscanf(file, "world_size %u population_size %u frame %u num_shards %u", &world_size,
+			&population_size, &frame, &num_shards) == 4;
+	uint32_t num_robots = 0;
+	shard_names.clear();
+	shard_sizes.clear();
+	for (uint32_t i = 0; valid && i < num_shards; i++) {
+		char shard_name[256];
+		uint32_t shard_size;
+		valid = fscanf(file, " shard %255s %u", shard_name, &shard_size) == 2;
+		shard_names.push_back(shard_name);
+		shard_sizes.push_back(shard_size);
+		num_robots += shard_size;
+	}
+	fclose(file);
+
+	if (!valid || num_robots != population_size) {
+		fprintf(stderr, "[Err] Invalid manifest '%s'\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+int Manifest::write(const char *path) {
+	std::string temporary_path = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary_path.c_str(), "w");
+	if (file == NULL) {
+		fprintf(stderr, "[Err] Failed to create manifest '%s'\n", temporary_path.c_str());
+		return -1;
+	}
+	fprintf(file, "world_size %u\n", world_size);
+	fprintf(file, "population_size %u\n", population_size);
+	fprintf(file, "frame %u\n", frame);
+	fprintf(file, "num_shards %u\n", (uint32_t) shard_names.size());
+	for (unsigned int i = 0; i < shard_names.size(); i++) {
+		fprintf(file, "shard %s %u\n", shard_names.at(i).c_str(), shard_sizes.at(i));
+	}
+	if (fclose(file) != 0 || rename(temporary_path.c_str(), path) != 0) {
+		fprintf(stderr, "[Err] Failed to write manifest '%s'\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+std::string Manifest::get_shard_path(const char *manifest_path, uint32_t shard) {
+	std::string directory(manifest_path);
+	size_t separator = directory.find_last_of('/');
+	if (separator == std::string::npos) {
+		return shard_names.at(shard);
+	}
+	return directory.substr(0, separator + 1) + shard_names.at(shard);
+}
@@ -0,0 +1,42 @@
+#ifndef MANIFEST_H_
+#define MANIFEST_H_
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+/**
+ * Text manifest describing a set of shards (population files, one per worker) that together hold the whole population
+ * at a frame: final positions written by the workers or a checkpoint. Shard names are relative to the manifest's
+ * directory
+ *
+ * Layout:
+ * world_size <world_size>
+ * population_size <population_size>
+ * frame <frames simulated>
+ * num_shards <N>
+ * shard <name> <number of robots> x N
+ *
+ */
+class Manifest {
+
+	public:
+		uint32_t world_size;
+		uint32_t population_size;
+		uint32_t frame;
+		std::vector<std::string> shard_names;
+		std::vector<uint32_t> shard_sizes;
+
+		Manifest();
+
+		//Reads & validates a manifest. Returns 0: success, -1: error (with the reason printed)
+		int read(const char *path);
+
+		//Writes the manifest aside & renames it, so a manifest is always complete. Returns 0: success, -1: error
+		int write(const char *path);
+
+		//The path of a shard (relative to the directory of the manifest at manifest_path)
+		std::string get_shard_path(const char *manifest_path, uint32_t shard);
+};
+
+#endif /* MANIFEST_H_ */
@@ -0,0 +1,143 @@
+#include "message_stats.h"
+
+#include <cstdio>
+
+#include "netutils.h"
+#include "protocol.h"
+
+static const char* CONNECTION_NAMES[MessageStats::NUM_CONNECTIONS] = { "master", "left neighbour", "right neighbour" };
+
+//Single writer, so a plain read of our own counter is safe
+static void add_to_counter(uint64_t &counter, uint64_t value) {
+	__atomic_store_n(&counter, counter + value, __ATOMIC_RELAXED);
+}
+
+static void insert_uint64_into_message(uint64_t value, unsigned char *location) {
+	netutils::insert_uint32_into_message(value >> 32, location);
+	netutils::insert_uint32_into_message(value & 0xFFFFFFFF, location + 4);
+}
+
+static uint64_t get_uint64_from_message(unsigned char *location) {
+	return ((uint64_t) netutils::get_uint32_from_message(location) << 32) | netutils::get_uint32_from_message(location + 4);
+}
+
+MessageStats::MessageStats() {
+	reset();
+}
+
+void MessageStats::reset() {
+	for (uint32_t type = 0; type < NUM_TYPES; type++) {
+		counters[type] = Counters();
+	}
+}
+
+void MessageStats::record_sent(unsigned char message_type, uint64_t bytes, uint64_t send_ns) {
+	Counters &type_counters = counters[message_type];
+	add_to_counter(type_counters.messages_sent, 1);
+	add_to_counter(type_counters.bytes_sent, bytes);
+	add_to_counter(type_counters.send_ns, send_ns);
+}
+
+void MessageStats::record_received(unsigned char message_type, uint64_t bytes, uint64_t latency_ns) {
+	Counters &type_counters = counters[message_type];
+	add_to_counter(type_counters.messages_received, 1);
+	add_to_counter(type_counters.bytes_received, bytes);
+	add_to_counter(type_counters.latency_ns, latency_ns);
+}
+
+MessageStats::Counters MessageStats::get_counters(unsigned char message_type) const {
+	const Counters &type_counters = counters[message_type];
+	Counters snapshot;
+	snapshot.messages_sent = __atomic_load_n(&type_counters.messages_sent, __ATOMIC_RELAXED);
+	snapshot.bytes_sent = __atomic_load_n(&type_counters.bytes_sent, __ATOMIC_RELAXED);
+	snapshot.send_ns = __atomic_load_n(&type_counters.send_ns, __ATOMIC_RELAXED);
+	snapshot.messages_received = __atomic_load_n(&type_counters.messages_received, __ATOMIC_RELAXED);
+	snapshot.bytes_received = __atomic_load_n(&type_counters.bytes_received, __ATOMIC_RELAXED);
+	snapshot.latency_ns = __atomic_load_n(&type_counters.latency_ns, __ATOMIC_RELAXED);
+	return snapshot;
+}
+
+void MessageStats::add(const MessageStats &other) {
+	for (uint32_t type = 0; type < NUM_TYPES; type++) {
+		Counters other_counters = other.get_counters(type);
+		Counters &type_counters = counters[type];
+		type_counters.messages_sent += other_counters.messages_sent;
+		type_counters.bytes_sent += other_counters.bytes_sent;
+		type_counters.send_ns += other_counters.send_ns;
+		type_counters.messages_received += other_counters.messages_received;
+		type_counters.bytes_received += other_counters.bytes_received;
+		type_counters.latency_ns += other_counters.latency_ns;
+	}
+}
+
+uint32_t MessageStats::get_serialized_length() const {
+	uint32_t length = 4;
+	for (uint32_t type = 0; type < NUM_TYPES; type++) {
+		if (counters[type].messages_sent > 0 || counters[type].messages_received > 0) {
+			length += SERIALIZED_ENTRY_LENGTH;
+		}
+	}
+	return length;
+}
+
+uint32_t MessageStats::serialize(unsigned char *location) const {
+	uint32_t num_types = 0;
+	unsigned char *entry = location + 4;
+	for (uint32_t type = 0; type < NUM_TYPES; type++) {
+		const Counters &type_counters = counters[type];
+		if (type_counters.messages_sent == 0 && type_counters.messages_received == 0) {
+			continue;
+		}
+		netutils::insert_uint32_into_message(type, entry);
+		insert_uint64_into_message(type_counters.messages_sent, entry + 4);
+		insert_uint64_into_message(type_counters.bytes_sent, entry + 12);
+		insert_uint64_into_message(type_counters.send_ns, entry + 20);
+		insert_uint64_into_message(type_counters.messages_received, entry + 28);
+		insert_uint64_into_message(type_counters.bytes_received, entry + 36);
+		insert_uint64_into_message(type_counters.latency_ns, entry + 44);
+		entry += SERIALIZED_ENTRY_LENGTH;
+		num_types++;
+	}
+	netutils::insert_uint32_into_message(num_types, location);
+	return 4 + num_types * SERIALIZED_ENTRY_LENGTH;
+}
+
+uint32_t MessageStats::deserialize(unsigned char *location) {
+	reset();
+	uint32_t num_types = netutils::get_uint32_from_message(location);
+	unsigned char *entry = location + 4;
+	for (uint32_t i = 0; i < num_types; i++) {
+		Counters &type_counters = counters[netutils::get_uint32_from_message(entry) % NUM_TYPES];
+		type_counters.messages_sent = get_uint64_from_message(entry + 4);
+		type_counters.bytes_sent = get_uint64_from_message(entry + 12);
+		type_counters.send_ns = get_uint64_from_message(entry + 20);
+		type_counters.messages_received = get_uint64_from_message(entry + 28);
+		type_counters.bytes_received = get_uint64_from_message(entry + 36);
+		type_counters.latency_ns = get_uint64_from_message(entry + 44);
+		entry += SERIALIZED_ENTRY_LENGTH;
+	}
+	return 4 + num_types * SERIALIZED_ENTRY_LENGTH;
+}
+
+void MessageStats::print(const char *indent, uint32_t frames) const {
+	printf("%s%-34s %10s %14s %12s %11s %10s %14s %12s %11s\n", indent, "message", "sent", "bytes", "bytes/frame",
+			"send us", "received", "bytes", "bytes/frame", "latency us");
+	for (uint32_t type = 0; type < NUM_TYPES; type++) {
+		Counters type_counters = get_counters(type);
+		if (type_counters.messages_sent == 0 && type_counters.messages_received == 0) {
+			continue;
+		}
+		printf("%s%-34s %10" PRIu64 " %14" PRIu64 " %12.1f %11.2f %10" PRIu64 " %14" PRIu64 " %12.1f %11.2f\n", indent,
+				protocol::get_message_type_name(type).c_str(), type_counters.messages_sent, type_counters.bytes_sent,
+				frames > 0 ? (double) type_counters.bytes_sent / frames : 0.0,
+				type_counters.messages_sent > 0 ? type_counters.send_ns / 1e3 / type_counters.messages_sent : 0.0,
+				type_counters.messages_received, type_counters.bytes_received,
+				frames > 0 ? (double) type_counters.bytes_received / frames : 0.0,
+				type_counters.messages_received > 0 ?
+						type_counters.latency_ns / 1e3 / type_counters.messages_received : 0.0);
+	}
+}
+
+const char* MessageStats::get_connection_name(Connection connection) {
+	return CONNECTION_NAMES[connection];
+}
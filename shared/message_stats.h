@@ -0,0 +1,74 @@
+#ifndef MESSAGE_STATS_H_
+#define MESSAGE_STATS_H_
+
+#include <inttypes.h>
+
+/**
+ * Per message type counters for one connection: messages & bytes (length header included) each way, the time spent
+ * sending and the latency from receiving a message (the read completing it) to handling it. Only the thread owning the
+ * connection records, with relaxed atomic stores, so other threads may take a snapshot at any time
+ *
+ */
+class MessageStats {
+
+	public:
+		struct Counters {
+			uint64_t messages_sent;
+			uint64_t bytes_sent;
+			uint64_t send_ns;
+			uint64_t messages_received;
+			uint64_t bytes_received;
+			uint64_t latency_ns;
+		};
+
+		//A worker's connections (see PROGRESS_MESSAGE)
+		enum Connection {
+			MASTER_CONNECTION,
+			LEFT_CONNECTION,
+			RIGHT_CONNECTION,
+			NUM_CONNECTIONS
+		};
+
+		//Message types are a single byte
+		static const uint32_t NUM_TYPES = 256;
+
+		//Type (uint32_t), then each counter (uint64_t)
+		static const uint32_t SERIALIZED_ENTRY_LENGTH = 52;
+
+	private:
+		Counters counters[NUM_TYPES];
+
+	public:
+		MessageStats();
+
+		void reset();
+
+		// Records a message sent (owning thread only)
+		void record_sent(unsigned char message_type, uint64_t bytes, uint64_t send_ns);
+
+		// Records a message received (owning thread only)
+		void record_received(unsigned char message_type, uint64_t bytes, uint64_t latency_ns);
+
+		// Snapshot of a message type's counters
+		Counters get_counters(unsigned char message_type) const;
+
+		// Adds the counters of other stats to ours (a snapshot of stats another thread is recording)
+		void add(const MessageStats &other);
+
+		// Bytes needed to serialize the message types used (stats not being recorded, e.g. a snapshot)
+		uint32_t get_serialized_length() const;
+
+		// Serializes the number of message types used, then an entry for each. Returns the number of bytes written
+		uint32_t serialize(unsigned char *location) const;
+
+		// Deserializes stats written by serialize, replacing ours. Returns the number of bytes read
+		uint32_t deserialize(unsigned char *location);
+
+		// Prints a line per message type used: counts, bytes (per frame when frames is above 0), mean send time & mean
+		// latency (microseconds)
+		void print(const char *indent, uint32_t frames) const;
+
+		static const char* get_connection_name(Connection connection);
+};
+
+#endif /* MESSAGE_STATS_H_ */
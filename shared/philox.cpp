@@ -0,0 +1,42 @@
+#include "philox.h"
+
+namespace philox {
+
+	const uint32_t MULTIPLIER_0 = 0xD2511F53;
+	const uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+	const uint32_t WEYL_0 = 0x9E3779B9;
+	const uint32_t WEYL_1 = 0xBB67AE85;
+	const int NUM_ROUNDS = 10;
+
+	void generate(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]) {
+		uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+		uint32_t k0 = key[0], k1 = key[1];
+
+		for (int round = 0; round < NUM_ROUNDS; round++) {
+			uint64_t product_0 = (uint64_t) MULTIPLIER_0 * c0;
+			uint64_t product_1 = (uint64_t) MULTIPLIER_1 * c2;
+			uint32_t next_0 = (uint32_t) (product_1 >> 32) ^ c1 ^ k0;
+			uint32_t next_1 = (uint32_t) product_1;
+			uint32_t next_2 = (uint32_t) (product_0 >> 32) ^ c3 ^ k1;
+			uint32_t next_3 = (uint32_t) product_0;
+			c0 = next_0;
+			c1 = next_1;
+			c2 = next_2;
+			c3 = next_3;
+
+			//Bump the key between rounds
+			k0 += WEYL_0;
+			k1 += WEYL_1;
+		}
+
+		result[0] = c0;
+		result[1] = c1;
+		result[2] = c2;
+		result[3] = c3;
+	}
+
+	double to_unit_interval(uint32_t word) {
+		return word / 4294967296.0;
+	}
+
+}
@@ -0,0 +1,23 @@
+#ifndef PHILOX_H_
+#define PHILOX_H_
+
+#include <inttypes.h>
+
+/**
+ *
+ * Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+ * Every (counter, key) pair maps to its own block of random numbers, so any value can be drawn independently of the
+ * others, on any node, in any order
+ *
+ */
+namespace philox {
+
+	// Computes the 4 random words for a counter & key
+	void generate(const uint32_t counter[4], const uint32_t key[2], uint32_t result[4]);
+
+	// Maps a random word to a uniform value in [0, 1)
+	double to_unit_interval(uint32_t word);
+
+}
+
+#endif /* PHILOX_H_ */
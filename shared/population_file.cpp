@@ -0,0 +1,163 @@
+#include "population_file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+#include "netutils.h"
+
+const char PopulationFile::MAGIC[8] = { 'U', 'N', 'I', 'V', 'P', 'O', 'P', '1' };
+
+PopulationFile::PopulationFile() {
+	mapping = NULL;
+	mapping_size = 0;
+	world_size = 0;
+	num_columns = 0;
+	population_size = 0;
+	frame = 0;
+	column_index = NULL;
+	records = NULL;
+}
+
+PopulationFile::~PopulationFile() {
+	if (mapping != NULL) {
+		munmap(mapping, mapping_size);
+	}
+}
+
+int PopulationFile::open(const char *path) {
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "[Err] Failed to open population file '%s'\n", path);
+		return -1;
+	}
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size < HEADER_LENGTH) {
+		fprintf(stderr, "[Err] Population file '%s' is too short\n", path);
+		close(fd);
+		return -1;
+	}
+	mapping_size = file_stat.st_size;
+	void *address = mmap(NULL, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (address == MAP_FAILED) {
+		fprintf(stderr, "[Err] Failed to map population file '%s'\n", path);
+		return -1;
+	}
+	mapping = (unsigned char *) address;
+
+	if (memcmp(mapping, MAGIC, sizeof MAGIC) != 0 || netutils::get_uint32_from_message(mapping + 8) != VERSION
+			|| netutils::get_uint32_from_message(mapping + 24) != (uint32_t) Robot::LONG_SERIALIZED_LENGTH) {
+		fprintf(stderr, "[Err] '%s' is not a supported population file\n", path);
+		return -1;
+	}
+	world_size = netutils::get_uint32_from_message(mapping + 12);
+	num_columns = netutils::get_uint32_from_message(mapping + 16);
+	population_size = netutils::get_uint32_from_message(mapping + 20);
+	frame = netutils::get_uint32_from_message(mapping + 28);
+	column_index = mapping + HEADER_LENGTH;
+	records = column_index + (num_columns + 1) * 4;
+
+	uint64_t expected_size = HEADER_LENGTH + (num_columns + 1) * 4ULL
+			+ (uint64_t) population_size * Robot::LONG_SERIALIZED_LENGTH;
+	if (num_columns == 0 || mapping_size != expected_size) {
+		fprintf(stderr, "[Err] Population file '%s' is truncated or corrupt\n", path);
+		return -1;
+	}
+
+	//The records are read in column order
+	madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+	return 0;
+}
+
+uint32_t PopulationFile::get_world_size() {
+	return world_size;
+}
+
+uint32_t PopulationFile::get_num_columns() {
+	return num_columns;
+}
+
+uint32_t PopulationFile::get_population_size() {
+	return population_size;
+}
+
+uint32_t PopulationFile::get_frame() {
+	return frame;
+}
+
+uint32_t PopulationFile::get_column(int32_t x_position) {
+	uint32_t column = (uint64_t) x_position * num_columns / world_size;
+	return column < num_columns ? column : num_columns - 1;
+}
+
+unsigned char* PopulationFile::get_records(uint32_t first_column, uint32_t last_column, uint32_t &num_records) {
+	uint32_t first_record = netutils::get_uint32_from_message(column_index + first_column * 4);
+	uint32_t end_record = netutils::get_uint32_from_message(column_index + (last_column + 1) * 4);
+	num_records = end_record - first_record;
+	return records + (uint64_t) first_record * Robot::LONG_SERIALIZED_LENGTH;
+}
+
+unsigned char* PopulationFile::get_records_overlapping(int32_t x_start, int32_t x_end, uint32_t &num_records) {
+	return get_records(get_column(x_start), get_column(x_end - 1), num_records);
+}
+
+void PopulationFile::serialize(uint32_t world_size, uint32_t num_columns, uint32_t frame, std::vector<Robot*> &robots,
+		std::vector<unsigned char> &contents) {
+
+	//Counting sort by column
+	std::vector<uint32_t> column_start(num_columns + 1, 0);
+	std::vector<uint32_t> robot_columns(robots.size());
+	for (unsigned int i = 0; i < robots.size(); i++) {
+		uint32_t column = (uint64_t) robots[i]->get_x_position() * num_columns / world_size;
+		robot_columns[i] = column < num_columns ? column : num_columns - 1;
+		column_start[robot_columns[i] + 1]++;
+	}
+	for (unsigned int column = 0; column < num_columns; column++) {
+		column_start[column + 1] += column_start[column];
+	}
+
+	uint32_t index_length = (num_columns + 1) * 4;
+	contents.resize(HEADER_LENGTH + index_length + robots.size() * Robot::LONG_SERIALIZED_LENGTH);
+	memcpy(&contents[0], MAGIC, sizeof MAGIC);
+	netutils::insert_uint32_into_message(VERSION, &contents[8]);
+	netutils::insert_uint32_into_message(world_size, &contents[12]);
+	netutils::insert_uint32_into_message(num_columns, &contents[16]);
+	netutils::insert_uint32_into_message(robots.size(), &contents[20]);
+	netutils::insert_uint32_into_message(Robot::LONG_SERIALIZED_LENGTH, &contents[24]);
+	netutils::insert_uint32_into_message(frame, &contents[28]);
+	for (unsigned int column = 0; column <= num_columns; column++) {
+		netutils::insert_uint32_into_message(column_start[column], &contents[HEADER_LENGTH + column * 4]);
+	}
+
+	//Place each record in the next free slot of its column
+	unsigned char *records = &contents[HEADER_LENGTH + index_length];
+	for (unsigned int i = 0; i < robots.size(); i++) {
+		uint32_t record = column_start[robot_columns[i]]++;
+		robots[i]->serialize_long(records + (uint64_t) record * Robot::LONG_SERIALIZED_LENGTH);
+	}
+}
+
+int PopulationFile::write_contents(const char *path, std::vector<unsigned char> &contents) {
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "[Err] Failed to create population file '%s'\n", path);
+		return -1;
+	}
+	bool written = fwrite(&contents[0], 1, contents.size(), file) == contents.size();
+	if (fclose(file) != 0 || !written) {
+		fprintf(stderr, "[Err] Failed to write population file '%s'\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+int PopulationFile::write(const char *path, uint32_t world_size, uint32_t num_columns, uint32_t frame,
+		std::vector<Robot*> &robots) {
+	std::vector<unsigned char> contents;
+	serialize(world_size, num_columns, frame, robots, contents);
+	return write_contents(path, contents);
+}
@@ -0,0 +1,79 @@
+#ifndef POPULATION_FILE_H_
+#define POPULATION_FILE_H_
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+
+#include "robot.h"
+
+/**
+ * Binary population file, read through a read-only memory mapping. Robots are stored as long serialized records
+ * (the SET_ROBOTS_MESSAGE form) sorted by block column, so the records of any range of columns are contiguous and can
+ * be located through the column index without reading the rest of the file. All integers are in network byte order
+ *
+ * Layout:
+ * char magic[8]                "UNIVPOP1"
+ * uint32_t version             The file format version
+ * uint32_t world_size          The world size the positions belong to
+ * uint32_t num_columns         The number of block columns records are sorted by
+ * uint32_t population_size     The number of records
+ * uint32_t record_length       The length of a record in bytes
+ * uint32_t frame               The number of frames simulated before this state (0: initial population)
+ * uint32_t column_start x (num_columns + 1)   The index of each column's first record (followed by population_size)
+ * long serialized robots x population_size
+ *
+ */
+class PopulationFile {
+
+	private:
+		static const char MAGIC[8];
+		static const uint32_t VERSION = 1;
+		static const uint32_t HEADER_LENGTH = 32;
+
+		unsigned char *mapping;
+		size_t mapping_size;
+
+		uint32_t world_size;
+		uint32_t num_columns;
+		uint32_t population_size;
+		uint32_t frame;
+
+		unsigned char *column_index;
+		unsigned char *records;
+
+	public:
+		PopulationFile();
+		~PopulationFile();
+
+		//Maps & validates the file. Returns 0: success, -1: error (with the reason printed)
+		int open(const char *path);
+
+		uint32_t get_world_size();
+		uint32_t get_num_columns();
+		uint32_t get_population_size();
+		uint32_t get_frame();
+
+		//The column a position falls under (positions equal to the world size fall under the last column)
+		uint32_t get_column(int32_t x_position);
+
+		//Returns the first record of the columns [first_column, last_column] and sets their number of records
+		unsigned char* get_records(uint32_t first_column, uint32_t last_column, uint32_t &num_records);
+
+		//As above for the columns overlapping the positions [x_start, x_end). Records at the edges of the range still
+		//need to be filtered by position
+		unsigned char* get_records_overlapping(int32_t x_start, int32_t x_end, uint32_t &num_records);
+
+		//Serializes robots into the contents of a population file sorted into num_columns columns
+		static void serialize(uint32_t world_size, uint32_t num_columns, uint32_t frame, std::vector<Robot*> &robots,
+				std::vector<unsigned char> &contents);
+
+		//Writes serialized contents to a new file. Returns 0: success, -1: error
+		static int write_contents(const char *path, std::vector<unsigned char> &contents);
+
+		//Writes robots to a new population file sorted into num_columns columns. Returns 0: success, -1: error
+		static int write(const char *path, uint32_t world_size, uint32_t num_columns, uint32_t frame,
+				std::vector<Robot*> &robots);
+};
+
+#endif /* POPULATION_FILE_H_ */
@@ -0,0 +1,130 @@
+#include "profiling.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "frame_timings.h"
+
+static const char* LOCK_NAMES[profiling::NUM_LOCKS] = { "listening", "left_neighbour", "right_neighbour",
+		"checkpoint_writer", "peer_barrier", "visualization" };
+
+//Updated by every thread
+static profiling::Counts counts;
+
+#ifdef PROFILE_HOOKS
+
+static void count(uint64_t *counter, uint64_t value) {
+	__atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+static void* counted_allocation(size_t size) {
+	count(&counts.allocations, 1);
+	count(&counts.allocated_bytes, size);
+	return malloc(size > 0 ? size : 1);
+}
+
+static void counted_free(void *pointer) {
+	if (pointer != NULL) {
+		count(&counts.frees, 1);
+		free(pointer);
+	}
+}
+
+void* operator new(size_t size) {
+	void *pointer = counted_allocation(size);
+	if (pointer == NULL) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new[](size_t size) {
+	void *pointer = counted_allocation(size);
+	if (pointer == NULL) {
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	return counted_allocation(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return counted_allocation(size);
+}
+
+void operator delete(void *pointer) noexcept {
+	counted_free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+	counted_free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t&) noexcept {
+	counted_free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t&) noexcept {
+	counted_free(pointer);
+}
+
+void profiling::lock(pthread_mutex_t *mutex, Lock lock) {
+	if (pthread_mutex_trylock(mutex) == 0) {
+		record_acquisition(lock, false, 0);
+		return;
+	}
+	uint64_t start_ns = FrameTimings::get_monotonic_nanoseconds();
+	pthread_mutex_lock(mutex);
+	record_acquisition(lock, true, FrameTimings::get_monotonic_nanoseconds() - start_ns);
+}
+
+void profiling::record_acquisition(Lock lock, bool contended, uint64_t wait_ns) {
+	count(&counts.acquisitions[lock], 1);
+	if (contended) {
+		count(&counts.contentions[lock], 1);
+		count(&counts.wait_ns[lock], wait_ns);
+	}
+}
+
+#endif
+
+profiling::Counts profiling::get_counts() {
+	Counts snapshot;
+	snapshot.allocations = __atomic_load_n(&counts.allocations, __ATOMIC_RELAXED);
+	snapshot.allocated_bytes = __atomic_load_n(&counts.allocated_bytes, __ATOMIC_RELAXED);
+	snapshot.frees = __atomic_load_n(&counts.frees, __ATOMIC_RELAXED);
+	for (int lock = 0; lock < NUM_LOCKS; lock++) {
+		snapshot.acquisitions[lock] = __atomic_load_n(&counts.acquisitions[lock], __ATOMIC_RELAXED);
+		snapshot.contentions[lock] = __atomic_load_n(&counts.contentions[lock], __ATOMIC_RELAXED);
+		snapshot.wait_ns[lock] = __atomic_load_n(&counts.wait_ns[lock], __ATOMIC_RELAXED);
+	}
+	return snapshot;
+}
+
+void profiling::print_counts(const Counts &start, const Counts &end, uint32_t frames) {
+	if (frames == 0) {
+		return;
+	}
+	uint64_t allocations = end.allocations - start.allocations;
+	uint64_t allocated_bytes = end.allocated_bytes - start.allocated_bytes;
+	printf("   allocations %" PRIu64 " (%.2f per frame), %" PRIu64 " bytes (%.1f per frame), frees %" PRIu64 "%s\n",
+			allocations, (double) allocations / frames, allocated_bytes, (double) allocated_bytes / frames,
+			end.frees - start.frees, allocations > 0 ? "" : " (allocation free)");
+	for (int lock = 0; lock < NUM_LOCKS; lock++) {
+		uint64_t acquisitions = end.acquisitions[lock] - start.acquisitions[lock];
+		if (acquisitions == 0) {
+			continue;
+		}
+		uint64_t wait_ns = end.wait_ns[lock] - start.wait_ns[lock];
+		printf("   lock %-18s acquired %10" PRIu64 "   contended %10" PRIu64 "   waited %10.3f ms (%.3f us per frame)\n",
+				get_lock_name((Lock) lock), acquisitions, end.contentions[lock] - start.contentions[lock], wait_ns / 1e6,
+				wait_ns / 1e3 / frames);
+	}
+}
+
+const char* profiling::get_lock_name(Lock lock) {
+	return LOCK_NAMES[lock];
+}
@@ -0,0 +1,62 @@
+#ifndef PROFILING_H_
+#define PROFILING_H_
+
+#include <inttypes.h>
+#include <pthread.h>
+
+/**
+ * Counting hooks of profiling builds (make PROFILE=1, defining PROFILE_HOOKS): every operator new & delete of the
+ * process, and the acquisitions of our locks with the time spent waiting on those found taken. Waiting on a condition
+ * (pthread_cond_wait) is not contention & is not counted. Once warmed up, frames are meant to allocate nothing & their
+ * locks to be uncontended. Other builds count nothing, locking is the plain pthread call
+ *
+ */
+namespace profiling {
+
+	enum Lock {
+		//Worker
+		LISTENING_LOCK,
+		LEFT_NEIGHBOUR_LOCK,
+		RIGHT_NEIGHBOUR_LOCK,
+		CHECKPOINT_WRITER_LOCK,
+		//Worker & its peer connections, parking on the phase barrier (see PhaseBarrier)
+		PEER_BARRIER,
+		//Master
+		VISUALIZATION_LOCK,
+		NUM_LOCKS
+	};
+
+	struct Counts {
+		uint64_t allocations;
+		uint64_t allocated_bytes;
+		uint64_t frees;
+		uint64_t acquisitions[NUM_LOCKS];
+		uint64_t contentions[NUM_LOCKS];
+		uint64_t wait_ns[NUM_LOCKS];
+	};
+
+#ifdef PROFILE_HOOKS
+	// Locks the mutex, counting the acquisition & any wait for it
+	void lock(pthread_mutex_t *mutex, Lock lock);
+
+	// Counts an acquisition of a lock of our own, which had to wait for wait_ns when contended
+	void record_acquisition(Lock lock, bool contended, uint64_t wait_ns);
+#else
+	inline void lock(pthread_mutex_t *mutex, Lock lock) {
+		pthread_mutex_lock(mutex);
+	}
+
+	inline void record_acquisition(Lock lock, bool contended, uint64_t wait_ns) {
+	}
+#endif
+
+	// Snapshot of the counts so far (all zero outside profiling builds)
+	Counts get_counts();
+
+	// Prints the allocations & the locks acquired between two snapshots, per frame over the given frames
+	void print_counts(const Counts &start, const Counts &end, uint32_t frames);
+
+	const char* get_lock_name(Lock lock);
+}
+
+#endif /* PROFILING_H_ */
@@ -8,6 +8,7 @@
 
 #include "protocol.h"
 #include "netutils.h"
+#include "frame_timings.h"
 
 std::string protocol::get_message_type_name(const unsigned char message_type) {
 	std::string message_name;
@@ -82,6 +83,58 @@ std::string protocol::get_message_type_name(const unsigned char message_type) {
 			message_name = "FINAL_POSITIONS_MESSAGE";
 			break;
 
+		case protocol::FRAMES_COMPLETED_MESSAGE:
+			message_name = "FRAMES_COMPLETED_MESSAGE";
+			break;
+
+		case protocol::PROGRESS_MESSAGE:
+			message_name = "PROGRESS_MESSAGE";
+			break;
+
+		case protocol::GENERATE_ROBOTS_MESSAGE:
+			message_name = "GENERATE_ROBOTS_MESSAGE";
+			break;
+
+		case protocol::LOAD_ROBOTS_MESSAGE:
+			message_name = "LOAD_ROBOTS_MESSAGE";
+			break;
+
+		case protocol::POSITIONS_WRITTEN_MESSAGE:
+			message_name = "POSITIONS_WRITTEN_MESSAGE";
+			break;
+
+		case protocol::CHECKPOINT_WRITTEN_MESSAGE:
+			message_name = "CHECKPOINT_WRITTEN_MESSAGE";
+			break;
+
+		case protocol::RECONFIGURE_MESSAGE:
+			message_name = "RECONFIGURE_MESSAGE";
+			break;
+
+		case protocol::LEAVE_REQUEST_MESSAGE:
+			message_name = "LEAVE_REQUEST_MESSAGE";
+			break;
+
+		case protocol::CLOCK_SYNC_MESSAGE:
+			message_name = "CLOCK_SYNC_MESSAGE";
+			break;
+
+		case protocol::TRACE_MESSAGE:
+			message_name = "TRACE_MESSAGE";
+			break;
+
+		case protocol::CHECKPOINT_COMMITTED_MESSAGE:
+			message_name = "CHECKPOINT_COMMITTED_MESSAGE";
+			break;
+
+		case protocol::RECONFIGURED_MESSAGE:
+			message_name = "RECONFIGURED_MESSAGE";
+			break;
+
+		case protocol::COLUMN_TRANSFER_MESSAGE:
+			message_name = "COLUMN_TRANSFER_MESSAGE";
+			break;
+
 		default:
 			message_name = "UNKNOWN";
 			break;
@@ -90,7 +143,7 @@ std::string protocol::get_message_type_name(const unsigned char message_type) {
 	return message_name;
 }
 
-void protocol::recieve_message(int socket, std::vector<unsigned char>& message) {
+void protocol::recieve_message(int socket, std::vector<unsigned char>& message, MessageStats *stats) {
 
 	//Need to union to abide by strict aliasing rules
 	union {
@@ -124,9 +177,12 @@ void protocol::recieve_message(int socket, std::vector<unsigned char>& message)
 		}
 		exit(EXIT_FAILURE);
 	}
+	if (stats != NULL) {
+		stats->record_received(message[0], header.value + 4, 0);
+	}
 }
 
-void protocol::send_message(int socket, const std::vector<unsigned char>& message) {
+void protocol::send_message(int socket, const std::vector<unsigned char>& message, MessageStats *stats) {
 
 	//Create new message of length 'len' plus header size
 	unsigned char *full_message = new unsigned char[message.size() + 4];
@@ -135,18 +191,19 @@ void protocol::send_message(int socket, const std::vector<unsigned char>& messag
 	netutils::insert_uint32_into_message(message.size(), full_message);
 	memcpy(full_message + 4, &message[0], message.size());
 
-	if (netutils::sendall(socket, full_message, message.size() + 4) != 0) {
-		fprintf(stderr, "[Err] Failed to send message\n");
-		exit(EXIT_FAILURE);
-	}
+	send_message(socket, full_message, message.size() + 4, stats);
 	delete[] full_message;
 }
 
-void protocol::send_message(int socket, unsigned char* message, size_t len) {
+void protocol::send_message(int socket, unsigned char* message, size_t len, MessageStats *stats) {
 
+	uint64_t start_ns = stats != NULL ? FrameTimings::get_monotonic_nanoseconds() : 0;
 	if (netutils::sendall(socket, message, len) != 0) {
 		fprintf(stderr, "[Err] Failed to send message\n");
 		exit(EXIT_FAILURE);
 	}
+	if (stats != NULL) {
+		stats->record_sent(message[4], len, FrameTimings::get_monotonic_nanoseconds() - start_ns);
+	}
 }
 
@@ -4,12 +4,14 @@
 #include <vector>
 #include <string>
 
+#include "message_stats.h"
+
 namespace protocol {
 
 	//The port master listen's on
 	const char SERVER_PORT[] = "2828";
 
-	//The port each worker will listen on for its left neighbour (base + worker id)
+	//The ports workers listen on for their left neighbour (base + a slot master assigns, the worker id at startup)
 	const int BASE_NEIGHBOUR_PORT = 2929;
 
 	//Backlog for master listening port
@@ -32,6 +34,11 @@ namespace protocol {
 	 * Payload:
 	 * uint32_t id             The assigned id to the worker
 	 * uint32_t num_workers    The expected num_workers in total
+	 * uint32_t listen_port    The port to listen on for the left neighbour
+	 * uint32_t first_column   The first block column (x index) of the worker's slice
+	 * uint32_t num_columns    The number of block columns of the worker's slice
+	 * uint32_t running        Is the worker joining a running ring (elastic runs, 0: false, 1: true)? It then takes its
+	 *                         robots & frame from its left neighbour's COLUMN_TRANSFER, in place of master's robots
 	 */
 	const unsigned char JOIN_ACK_MESSAGE = 0x01;
 
@@ -42,12 +49,13 @@ namespace protocol {
 	const unsigned char LISTENING_FOR_NEIGHBOUR_MESSAGE = 0x02;
 
 	/**
-	 * RIGHT_NEIGHBOUR_DISCOVER: Sent from master to worker following a LISTENING_FOR_NEIGHBOUR to inform the worker
-	 * where he can find his right neighbour (ip address)
+	 * RIGHT_NEIGHBOUR_DISCOVER: Sent from master to worker once every worker has sent LISTENING_FOR_NEIGHBOUR to inform
+	 * the worker where he can find his right neighbour (ip address & listen port)
 	 *
 	 * Payload:
 	 * uint32_t size         The size of the following ip address
 	 * char* ip_address      The ip address of the right neighbour
+	 * uint32_t port         The port the right neighbour listens on
 	 */
 	const unsigned char RIGHT_NEIGHBOUR_DISCOVER_MESSAGE = 0x03;
 
@@ -82,6 +90,19 @@ namespace protocol {
 	 *uint32_t visualization_enabled   Is visualization enabled (0: false, 1: true)
 	 *uint32_t fov                     The robot fov in mr
 	 *uint32_t invert_direction        Is robot direction inverted (0: false, 1: true)
+	 *uint32_t io_uring_enabled        Use io_uring for the halo exchange where available (0: false, 1: true)
+	 *uint32_t frame_aggregation       Aggregate frame completion along the ring (0: false, 1: true)
+	 *uint32_t progress_frames         Send a PROGRESS record at least every N frames (0: no frame interval)
+	 *uint32_t progress_ms             Send a PROGRESS record at least every T milliseconds (0: no time interval). With
+	 *                                 neither interval set, FRAME_FINISHED is sent every frame instead
+	 *uint32_t stats_pool_size         Visualization stats pool k x k blocks into one value
+	 *uint32_t stats_interval          Visualization stats are sent every N frames (FRAME_FINISHED in between)
+	 *uint32_t start_frame             The number of frames simulated before the robots' state (restarts)
+	 *uint32_t elastic_enabled         Can workers join or leave during the run (0: false, 1: true)
+	 *uint32_t tracing_enabled         Record trace events, synchronizing clocks with master (CLOCK_SYNC) before
+	 *                                 UNIVERSE_PARAMETERS_SET & sending them (TRACE) before the final positions
+	 *uint32_t perf_counters_interval  Print the hardware performance counters of each phase every N frames (0: not
+	 *                                 sampled)
 	 */
 	const unsigned char SET_UNIVERSE_PARAMETERS_MESSAGE = 0x07;
 
@@ -93,19 +114,42 @@ namespace protocol {
 	const unsigned char UNIVERSE_PARAMETERS_SET_MESSAGE = 0x08;
 
 	/**
-	 * SET_ROBOTS_MESSAGE: Sent from master to worker following a UNIVERSE_PARAMETERS_SET_MESSAGE with a collection
-	 * of robots that worker needs to add
+	 * SET_ROBOTS_MESSAGE: Sent from master to worker following a UNIVERSE_PARAMETERS_SET_MESSAGE with a chunk of the
+	 * robots that worker needs to add. Chunks follow one another until the last chunk
 	 *
 	 * Payload:
-	 * uint32_t num_robots The number of robots
+	 * uint32_t num_robots The number of robots in this chunk
+	 * uint32_t last_chunk Is this the last chunk (0: false, 1: true)
 	 * long serialized robots x num_robots
 	 *
 	 */
 	const unsigned char SET_ROBOTS_MESSAGE = 0x09;
 
 	/**
-	 * ROBOTS_SET_MESSAGE: Sent from worker to master following a SET_ROBOTS_MESSAGE to notify master that the robots
-	 * have been added
+	 * GENERATE_ROBOTS_MESSAGE: Sent from master to worker in place of SET_ROBOTS_MESSAGE when robots are generated from a
+	 * seed. The worker generates every robot & keeps those within its slice
+	 *
+	 * Payload:
+	 * uint32_t population_size   The number of robots in the universe (ids 1 to population_size)
+	 * uint32_t seed              The seed the robots are generated from
+	 *
+	 */
+	const unsigned char GENERATE_ROBOTS_MESSAGE = 0x13;
+
+	/**
+	 * LOAD_ROBOTS_MESSAGE: Sent from master to worker in place of SET_ROBOTS_MESSAGE when the workers read the
+	 * population file themselves (shared storage). The worker maps the file & adds the robots within its slice
+	 *
+	 * Payload:
+	 * uint32_t path_length   The length of the path
+	 * char path[path_length] The path of the population file (not null terminated)
+	 *
+	 */
+	const unsigned char LOAD_ROBOTS_MESSAGE = 0x14;
+
+	/**
+	 * ROBOTS_SET_MESSAGE: Sent from worker to master following a SET_ROBOTS_MESSAGE (or GENERATE_ROBOTS_MESSAGE) to
+	 * notify master that the robots have been added
 	 *
 	 */
 	const unsigned char ROBOTS_SET_MESSAGE = 0x0A;
@@ -114,6 +158,14 @@ namespace protocol {
 	 * START_SIMULATION_MESSAGE: Sent from master to worker following a ROBOTS_SET_MESSAGE to tell the worker to begin
 	 * the simulation
 	 *
+	 * Payload:
+	 * uint32_t path_length   The length of the directory final position shards are written to (0: send final
+	 *                        positions to master instead)
+	 * char path[path_length] The directory (not null terminated)
+	 * uint32_t checkpoint_interval     Checkpoint the robots every N frames (0: no checkpoints)
+	 * uint32_t checkpoint_path_length  The length of the directory checkpoints are written to
+	 * char checkpoint_path[checkpoint_path_length]  The directory (not null terminated)
+	 *
 	 */
 	const unsigned char START_SIMULATION_MESSAGE = 0x0B;
 
@@ -121,6 +173,10 @@ namespace protocol {
 	 *GHOST_STRIP_MESSAGE: Sent from worker to worker with the contents of a ghost strip
 	 *
 	 *Payload:
+	 *uint32_t completed_frames       Frames completed by the sender and every worker between worker 1 and the sender
+	 *                                (only meaningful when sent to the right neighbour, see FRAMES_COMPLETED)
+	 *uint32_t reconfigure_frame      The frame after which the ring is reconfigured, as known to the sender (0: none,
+	 *                                see RECONFIGURE)
 	 *N of:
 	 *   uint32_t x_key            The x component of a map coordinate
 	 *   uint32_t y_key            The y component of a map coordinate
@@ -143,18 +199,23 @@ namespace protocol {
 	/**
 	 * FRAME_FINISHED_MESSAGE: Sent from worker to master after a frame has been completed
 	 *
+	 * Payload:
+	 * uint32_t compute_us   The time the frame took the worker apart from waiting on its neighbours (microseconds)
 	 */
 	const unsigned char FRAME_FINISHED_MESSAGE = 0x0E;
 
 	/**
-	 * FRAME_FINISHED_WITH_STATS_MESSAGE: Sent from worker to master after a frame has been completed (visualization on)
+	 * FRAME_FINISHED_WITH_STATS_MESSAGE: Sent from worker to master after a frame has been completed (visualization on,
+	 * every stats interval frames). Blocks are pooled k x k, counts cover the worker's slice and are dense (row major)
 	 *
 	 * Payload:
-	 * num_blocks        The number of blocks
-	 * num_blocks X:
-	 *    uint32_t x     The x coordinate for a grid block
-	 *    uint32_t y     The y coordinate for a grid block
-	 *    uint32_t size  The count of robots within the block
+	 * uint32_t frame      The number of frames simulated (frames from every worker are matched by it)
+	 * uint32_t compute_us The time the frame took the worker apart from waiting on its neighbours (microseconds)
+	 * uint32_t x_offset   The pooled x coordinate of the worker's first column
+	 * uint32_t width      The number of pooled columns
+	 * uint32_t height     The number of pooled rows
+	 * width x height:
+	 *    uint32_t size    The count of robots within the pooled blocks
 	 *
 	 */
 	const unsigned char FRAME_FINISHED_WITH_STATS_MESSAGE = 0x0F;
@@ -169,6 +230,158 @@ namespace protocol {
 	 */
 	const unsigned char FINAL_POSITIONS_MESSAGE = 0x10;
 
+	/**
+	 * FRAMES_COMPLETED_MESSAGE: Sent from the last worker to master after a frame has been completed when frame
+	 * aggregation is enabled (in place of every worker sending FRAME_FINISHED). Completion counts travel along the ring
+	 * from worker 1 inside the ghost strips, so the count lags behind the last worker's own frame count
+	 *
+	 * Payload:
+	 * uint32_t completed_frames   The number of frames completed by all workers
+	 */
+	const unsigned char FRAMES_COMPLETED_MESSAGE = 0x11;
+
+	/**
+	 * PROGRESS_MESSAGE: Sent from worker to master in place of FRAME_FINISHED when a progress reporting interval is
+	 * set. Covers all frames completed since the previous record, and is always sent for the final frame
+	 *
+	 * Payload:
+	 * uint32_t completed_frames          The total number of frames completed by the worker
+	 * uint32_t num_robots                The number of robots the worker owns
+	 * uint32_t num_frames                The number of frames covered by this record
+	 * (FrameTimings::NUM_PHASES + 1)     For each phase of the frame (see FrameTimings::Phase), then whole frames:
+	 *    uint32_t total_us                  Time spent in the phase over those frames (microseconds)
+	 *    uint32_t buckets[NUM_BUCKETS]      Histogram of the phase's per frame durations (see FrameTimings)
+	 * uint32_t num_connections           The number of the worker's connections (MessageStats::Connection) that follow
+	 * (num_connections)                  For each connection, the messages exchanged over it since it was made:
+	 *    uint32_t connection                0: master, 1: left neighbour, 2: right neighbour
+	 *    uint32_t num_types                 The number of message types exchanged
+	 *    (num_types)                        For each message type:
+	 *       uint32_t message_type
+	 *       uint64_t counters[6]               Messages & bytes sent, send time (ns), messages & bytes received & the
+	 *                                          receive to handle latency (ns), each high word first
+	 */
+	const unsigned char PROGRESS_MESSAGE = 0x12;
+
+	/**
+	 * POSITIONS_WRITTEN_MESSAGE: Sent from worker to master in place of FINAL_POSITIONS_MESSAGE once the worker has
+	 * written its final positions to a binary shard (a population file named by SHARD_FILE_FORMAT)
+	 *
+	 * Payload:
+	 * uint32_t num_robots   The number of robots within the shard
+	 */
+	const unsigned char POSITIONS_WRITTEN_MESSAGE = 0x15;
+
+	//File name of a worker's final positions shard within the output directory (formatted with the worker id)
+	const char SHARD_FILE_FORMAT[] = "positions_%u.bin";
+
+	/**
+	 * CHECKPOINT_WRITTEN_MESSAGE: Sent from worker to master (between frame messages, whatever message master expects
+	 * next) once a checkpoint has been written in the background. A checkpoint is a population file named by
+	 * CHECKPOINT_FILE_FORMAT holding the worker's robots after the frame
+	 *
+	 * Payload:
+	 * uint32_t frame        The number of frames simulated before the checkpointed state
+	 * uint32_t num_robots   The number of robots within the checkpoint
+	 */
+	const unsigned char CHECKPOINT_WRITTEN_MESSAGE = 0x16;
+
+	//File name of a worker's checkpoint within the checkpoint directory (formatted with the frame & the worker id)
+	const char CHECKPOINT_FILE_FORMAT[] = "checkpoint_%u_%u.bin";
+
+	/**
+	 * RECONFIGURE_MESSAGE: Sent from master to every worker of the ring (elastic runs) to splice a worker into it (once
+	 * the joining worker is listening) or out of it, one worker at a time. Worker 1 picks a frame far enough ahead for
+	 * every worker to learn of it along the ring (carried by ghost strips). After that frame, the workers the splice
+	 * concerns hand over block columns (COLUMN_TRANSFER) & replace the links to their old neighbours, every worker
+	 * takes on its new id and all of them report RECONFIGURED & carry on. A joining worker takes the right half of a
+	 * worker's columns & becomes its right neighbour, a leaving worker hands all of its columns to the neighbour
+	 * next to them (the left one, unless it holds column 0) and its neighbours link up with each other
+	 *
+	 * Payload:
+	 * uint32_t id               The worker's id in the new ring (0: the worker leaves)
+	 * uint32_t num_workers      The number of workers in the new ring
+	 * uint32_t first_column     The first block column of the worker's slice in the new ring
+	 * uint32_t num_columns      The number of block columns of the worker's slice in the new ring (0: the worker leaves)
+	 * uint32_t accept_left      Does a new left neighbour connect to the worker's listen port (0: false, 1: true)
+	 * uint32_t accept_columns   Does a leaving neighbour connect to the worker's listen port to hand over its columns
+	 *                           (0: false, 1: true)
+	 * uint32_t size             The size of the following ip address (0: the worker connects to no one)
+	 * char* ip_address          The worker's new right neighbour (a leaving worker: the neighbour taking its columns)
+	 * uint32_t port             The port it listens on
+	 *
+	 */
+	const unsigned char RECONFIGURE_MESSAGE = 0x17;
+
+	/**
+	 * LEAVE_REQUEST_MESSAGE: Sent from worker to master (elastic runs, between frame messages) when the worker has been
+	 * asked to leave (SIGTERM). The worker leaves at the next reconfiguration
+	 *
+	 */
+	const unsigned char LEAVE_REQUEST_MESSAGE = 0x18;
+
+	/**
+	 * CLOCK_SYNC_MESSAGE: Sent from worker to master (tracing runs) to sample the offset between their monotonic
+	 * clocks, and back from master straight away with its clock. The worker takes the offset from the sample with the
+	 * shortest round trip, assuming the reply was stamped half way through it
+	 *
+	 * Payload (from master):
+	 * uint64_t master_ns   Master's monotonic clock (nanoseconds, high word first)
+	 */
+	const unsigned char CLOCK_SYNC_MESSAGE = 0x19;
+
+	/**
+	 * TRACE_MESSAGE: Sent from worker to master (tracing runs) before its final positions, with the trace events still
+	 * held by each of its threads. Start times have been shifted onto master's clock
+	 *
+	 * Payload:
+	 * uint32_t num_threads       The number of threads
+	 * (num_threads)              For each thread:
+	 *    uint32_t thread            The thread (0: worker, 1: left peer connection, 2: right peer connection)
+	 *    uint32_t num_events        The number of events
+	 *    (num_events)               Events (see TraceBuffer::serialize)
+	 */
+	const unsigned char TRACE_MESSAGE = 0x1A;
+
+	/**
+	 * CHECKPOINT_COMMITTED_MESSAGE: Sent from master to every worker once the checkpoint manifest has been rewritten
+	 * for a frame all workers have checkpointed. Older checkpoints are no longer needed: each worker removes its own
+	 * checkpoints before the frame (including any that not every worker wrote), and worker 1 also removes the shards
+	 * left behind by workers that have since left the ring. Workers take the message between frames at their next
+	 * checkpoint, and wait for it after their last checkpoint (before leaving or finishing)
+	 *
+	 * Payload:
+	 * uint32_t frame          The frame of the checkpoint now in the manifest
+	 * uint32_t num_orphaned   The number of shards of workers that have left to remove (worker 1 only, else 0)
+	 * (num_orphaned)          For each shard:
+	 *    uint32_t frame          The frame of its checkpoint
+	 *    uint32_t shard          The id it was written under
+	 */
+	const unsigned char CHECKPOINT_COMMITTED_MESSAGE = 0x1B;
+
+	/**
+	 * RECONFIGURED_MESSAGE: Sent from worker to master (elastic runs) once the worker has applied its part of a
+	 * RECONFIGURE after the frame: any checkpoint up to the frame has been reported under its previous id, and the
+	 * messages that follow are sent under its new one. A leaving worker disconnects after it
+	 *
+	 * Payload:
+	 * uint32_t frame   The number of frames simulated before the new ring takes over
+	 */
+	const unsigned char RECONFIGURED_MESSAGE = 0x1C;
+
+	/**
+	 * COLUMN_TRANSFER_MESSAGE: Sent from worker to worker (elastic runs) after the reconfiguration frame, handing over
+	 * block columns & the robots within them: to a joining right neighbour over the new link once it has acknowledged
+	 * it (NEIGHBOUR_REQUEST_ACK), or from a leaving worker over a connection of its own to the receiver's listen port
+	 *
+	 * Payload:
+	 * uint32_t frame          The number of frames simulated before the robots' state
+	 * uint32_t first_column   The first block column handed over
+	 * uint32_t num_columns    The number of block columns handed over
+	 * uint32_t num_robots
+	 * long serialized robots x num_robots
+	 */
+	const unsigned char COLUMN_TRANSFER_MESSAGE = 0x1D;
+
 	/**
 	 * -----------------------------------------------------------------------------------------------------------------
 	 * End Message definitions
@@ -178,14 +391,15 @@ namespace protocol {
 	//Gets the textual name for the various message types
 	std::string get_message_type_name(const unsigned char message_type);
 
-	// Retrieves the entire message from a socket stripping length header
-	void recieve_message(int socket, std::vector<unsigned char>& message);
+	// Retrieves the entire message from a socket stripping length header. Counted in the connection's stats (if not
+	// NULL) as handled on arrival
+	void recieve_message(int socket, std::vector<unsigned char>& message, MessageStats *stats);
 
-	// Send an entire message to the socket after prepending the length header
-	void send_message(int socket, const std::vector<unsigned char>& message);
+	// Send an entire message to the socket after prepending the length header, counted in the stats (if not NULL)
+	void send_message(int socket, const std::vector<unsigned char>& message, MessageStats *stats);
 
 	// Send an entire message to the socket. Assumes you handled the length header (faster version)
-	void send_message(int socket, unsigned char* message, size_t len);
+	void send_message(int socket, unsigned char* message, size_t len, MessageStats *stats);
 
 }
 
@@ -6,6 +6,7 @@
 #include <math.h>
 
 #include "netutils.h"
+#include "philox.h"
 
 //Declare static members
 uint32_t Robot::id_count = 1;
@@ -31,6 +32,29 @@ Robot::Robot() {
 	a_position = normalize_angle(drand48() * (THOUSAND_TIMES_PI * 2.0));
 }
 
+Robot::Robot(uint32_t id, int32_t x_position, int32_t y_position, int32_t a_position) {
+	this->id = id;
+	current_closest_range = Robot::range;
+	closest_pixel = -1;
+	linear_speed = 0;
+	angular_speed = 0;
+	this->x_position = x_position;
+	this->y_position = y_position;
+	this->a_position = a_position;
+}
+
+Robot Robot::generate(uint32_t id, uint32_t seed) {
+	//Random position drawn from the robot's own counter
+	const uint32_t counter[4] = { id, 0, 0, 0 };
+	const uint32_t key[2] = { seed, 0 };
+	uint32_t random[4];
+	philox::generate(counter, key, random);
+	int32_t x_position = philox::to_unit_interval(random[0]) * world_size;
+	int32_t y_position = philox::to_unit_interval(random[1]) * world_size;
+	int32_t a_position = normalize_angle(philox::to_unit_interval(random[2]) * (THOUSAND_TIMES_PI * 2.0));
+	return Robot(id, x_position, y_position, a_position);
+}
+
 Robot::Robot(unsigned char* location, int serialized_version) {
 	switch (serialized_version) {
 		case NORMAL_SERIALIZED_VERSION:
@@ -76,6 +100,16 @@ uint32_t Robot::get_id_from_serialized(unsigned char* location) {
 	return netutils::get_uint32_from_message(location);
 }
 
+int32_t Robot::get_x_position_from_serialized(unsigned char* location) {
+	return netutils::get_uint32_from_message(location + 4);
+}
+
+void Robot::get_position_from_serialized(unsigned char* location, int32_t* position) {
+	position[0] = netutils::get_uint32_from_message(location + 4);
+	position[1] = netutils::get_uint32_from_message(location + 8);
+	position[2] = netutils::get_uint32_from_message(location + 12);
+}
+
 // Updates existing robot from a serialized version
 void Robot::update_from_serialized(unsigned char* location, int serialized_version) {
 	switch (serialized_version) {
@@ -58,11 +58,23 @@ class Robot {
 		// Constructor for a serialized robot
 		Robot(unsigned char* location, int serialized_version);
 
+		// Constructor for a robot at rest with the given position
+		Robot(uint32_t id, int32_t x_position, int32_t y_position, int32_t a_position);
+
+		// Generates a robot from a seed. A given id & seed always give the same robot (wherever generated)
+		static Robot generate(uint32_t id, uint32_t seed);
+
 		~Robot();
 
 		// Get only the robot id from a serialized version
 		static uint32_t get_id_from_serialized(unsigned char* location);
 
+		// Get only the x position from a normal or long serialized version
+		static int32_t get_x_position_from_serialized(unsigned char* location);
+
+		// Get only the position (x, y & a) from a normal or long serialized version
+		static void get_position_from_serialized(unsigned char* location, int32_t* position);
+
 		// Updates existing robot from a serialized version
 		void update_from_serialized(unsigned char* location, int serialized_version);
 
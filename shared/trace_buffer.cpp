@@ -0,0 +1,95 @@
+#include "trace_buffer.h"
+
+#include "netutils.h"
+#include "frame_timings.h"
+
+static const char* EVENT_NAMES[TraceBuffer::NUM_EVENTS] = { "clear_ghost_strips", "update_positions", "halo_exchange",
+		"update_sensors", "set_speeds", "write_halos", "wait_on_neighbours", "add_halos", "send_ghost_strip",
+		"add_ghost_strip", "send_moved_robots", "add_robots", "wait_on_worker", "handle_message" };
+
+TraceBuffer::TraceBuffer() {
+	records = NULL;
+	head = 0;
+}
+
+TraceBuffer::~TraceBuffer() {
+	delete[] records;
+}
+
+void TraceBuffer::enable() {
+	if (records == NULL) {
+		records = new Record[CAPACITY];
+	}
+}
+
+bool TraceBuffer::is_enabled() {
+	return records != NULL;
+}
+
+uint64_t TraceBuffer::start() {
+	return records != NULL ? FrameTimings::get_monotonic_nanoseconds() : 0;
+}
+
+uint64_t TraceBuffer::record(Event event, uint64_t start_ns, uint32_t arg) {
+	if (records == NULL) {
+		return 0;
+	}
+	uint64_t now_ns = FrameTimings::get_monotonic_nanoseconds();
+	record_span(event, start_ns, now_ns, arg);
+	return now_ns;
+}
+
+void TraceBuffer::record_span(Event event, uint64_t start_ns, uint64_t end_ns, uint32_t arg) {
+	if (records == NULL) {
+		return;
+	}
+	Record &record = records[head % CAPACITY];
+	record.start_ns = start_ns;
+	record.duration_ns = end_ns - start_ns;
+	record.event = event;
+	record.arg = arg;
+
+	//Publish the event to readers
+	__atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+}
+
+void TraceBuffer::get_records(std::vector<Record> &copy) {
+	copy.clear();
+	if (records == NULL) {
+		return;
+	}
+	uint64_t end = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+	uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+	for (uint64_t i = begin; i < end; i++) {
+		copy.push_back(records[i % CAPACITY]);
+	}
+}
+
+uint32_t TraceBuffer::serialize(const std::vector<Record> &records, int64_t clock_offset_ns, unsigned char *location) {
+	for (unsigned int i = 0; i < records.size(); i++) {
+		const Record &record = records.at(i);
+		uint64_t start_ns = record.start_ns + clock_offset_ns;
+		netutils::insert_uint32_into_message(start_ns >> 32, location);
+		netutils::insert_uint32_into_message(start_ns & 0xFFFFFFFF, location + 4);
+		netutils::insert_uint32_into_message(record.duration_ns > 0xFFFFFFFF ? 0xFFFFFFFF : record.duration_ns,
+				location + 8);
+		netutils::insert_uint32_into_message(record.event, location + 12);
+		netutils::insert_uint32_into_message(record.arg, location + 16);
+		location += SERIALIZED_RECORD_LENGTH;
+	}
+	return records.size() * SERIALIZED_RECORD_LENGTH;
+}
+
+TraceBuffer::Record TraceBuffer::deserialize(unsigned char *location) {
+	Record record;
+	record.start_ns = ((uint64_t) netutils::get_uint32_from_message(location) << 32)
+			| netutils::get_uint32_from_message(location + 4);
+	record.duration_ns = netutils::get_uint32_from_message(location + 8);
+	record.event = netutils::get_uint32_from_message(location + 12);
+	record.arg = netutils::get_uint32_from_message(location + 16);
+	return record;
+}
+
+const char* TraceBuffer::get_event_name(Event event) {
+	return EVENT_NAMES[event];
+}
@@ -0,0 +1,90 @@
+#ifndef TRACE_BUFFER_H_
+#define TRACE_BUFFER_H_
+
+#include <inttypes.h>
+#include <vector>
+
+/**
+ * Lock-free ring buffer of trace events for one thread (tracing runs). Only the owning thread records, publishing each
+ * event by bumping the head with a release store, so others may read the events once the owner has gone quiet (e.g.
+ * parked on a barrier). Once full the oldest events are overwritten. Events are complete spans (start & duration) so
+ * that every event left in the ring still makes sense on its own
+ *
+ */
+class TraceBuffer {
+
+	public:
+		enum Event {
+			//Worker thread
+			CLEAR_GHOST_STRIPS,
+			UPDATE_POSITIONS,
+			HALO_EXCHANGE,
+			UPDATE_SENSORS,
+			SET_SPEEDS,
+			//Worker thread (io_uring halo exchange)
+			WRITE_HALOS,
+			WAIT_ON_NEIGHBOURS,
+			ADD_HALOS,
+			//Peer connection threads
+			SEND_GHOST_STRIP,
+			ADD_GHOST_STRIP,
+			SEND_MOVED_ROBOTS,
+			ADD_ROBOTS,
+			WAIT_ON_WORKER,
+			//Master (per worker connection)
+			HANDLE_MESSAGE,
+			NUM_EVENTS
+		};
+
+		struct Record {
+			uint64_t start_ns;
+			uint64_t duration_ns;
+			uint32_t event;
+			//The frame (worker thread), exchange (io_uring halo exchange, 0: ghost strips, 1: moved robots), number of
+			//robots sent (peer connections) or message type (master)
+			uint32_t arg;
+		};
+
+		//Records kept per thread
+		static const uint32_t CAPACITY = 32768;
+
+		//Start (uint64_t), duration (uint32_t, nanoseconds), event & arg
+		static const uint32_t SERIALIZED_RECORD_LENGTH = 20;
+
+	private:
+		//Allocated once enabled (NULL: tracing disabled)
+		Record *records;
+		uint64_t head;
+
+	public:
+		TraceBuffer();
+		~TraceBuffer();
+
+		void enable();
+
+		bool is_enabled();
+
+		// Start time for an event from the monotonic clock (0 when disabled, saving the clock read)
+		uint64_t start();
+
+		// Records an event that started at start_ns & ends now (owning thread only). Returns now, the start of any next
+		// event (0 when disabled)
+		uint64_t record(Event event, uint64_t start_ns, uint32_t arg);
+
+		// Records an event that has already ended (owning thread only)
+		void record_span(Event event, uint64_t start_ns, uint64_t end_ns, uint32_t arg);
+
+		// Copies out the events still held, oldest first
+		void get_records(std::vector<Record> &copy);
+
+		// Serializes the events (as returned by get_records), shifting their start times by the clock offset. Returns
+		// the number of bytes written (SERIALIZED_RECORD_LENGTH per event)
+		static uint32_t serialize(const std::vector<Record> &records, int64_t clock_offset_ns, unsigned char *location);
+
+		// Deserializes a serialized event
+		static Record deserialize(unsigned char *location);
+
+		static const char* get_event_name(Event event);
+};
+
+#endif /* TRACE_BUFFER_H_ */
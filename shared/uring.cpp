@@ -0,0 +1,175 @@
+#include "uring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+Uring::Uring() {
+	ring_fd = -1;
+	sq_ring = NULL;
+	sq_ring_size = 0;
+	sq_head = NULL;
+	sq_tail = NULL;
+	sq_mask = NULL;
+	sq_array = NULL;
+	sqes = NULL;
+	sqes_size = 0;
+	num_queued = 0;
+	cq_ring = NULL;
+	cq_ring_size = 0;
+	cq_head = NULL;
+	cq_tail = NULL;
+	cq_mask = NULL;
+	cqes = NULL;
+}
+
+Uring::~Uring() {
+	if (sqes != NULL) {
+		munmap(sqes, sqes_size);
+	}
+	if (cq_ring != NULL && cq_ring != sq_ring) {
+		munmap(cq_ring, cq_ring_size);
+	}
+	if (sq_ring != NULL) {
+		munmap(sq_ring, sq_ring_size);
+	}
+	if (ring_fd >= 0) {
+		close(ring_fd);
+	}
+}
+
+int Uring::init(unsigned entries) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof params);
+
+	ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (ring_fd < 0) {
+		return -1;
+	}
+
+	//Map the submission & completion rings (a single mapping if the kernel supports it)
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (cq_ring_size > sq_ring_size) {
+			sq_ring_size = cq_ring_size;
+		}
+		cq_ring_size = sq_ring_size;
+	}
+
+	void *ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+			IORING_OFF_SQ_RING);
+	if (ring == MAP_FAILED) {
+		return -1;
+	}
+	sq_ring = (unsigned char *) ring;
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		cq_ring = sq_ring;
+	} else {
+		ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+				IORING_OFF_CQ_RING);
+		if (ring == MAP_FAILED) {
+			return -1;
+		}
+		cq_ring = (unsigned char *) ring;
+	}
+
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	ring = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+	if (ring == MAP_FAILED) {
+		sqes = NULL;
+		return -1;
+	}
+	sqes = (io_uring_sqe *) ring;
+
+	sq_head = (unsigned *) (sq_ring + params.sq_off.head);
+	sq_tail = (unsigned *) (sq_ring + params.sq_off.tail);
+	sq_mask = (unsigned *) (sq_ring + params.sq_off.ring_mask);
+	sq_array = (unsigned *) (sq_ring + params.sq_off.array);
+
+	cq_head = (unsigned *) (cq_ring + params.cq_off.head);
+	cq_tail = (unsigned *) (cq_ring + params.cq_off.tail);
+	cq_mask = (unsigned *) (cq_ring + params.cq_off.ring_mask);
+	cqes = (io_uring_cqe *) (cq_ring + params.cq_off.cqes);
+
+	return 0;
+}
+
+int Uring::register_buffers(const struct iovec *buffers, unsigned num_buffers) {
+	if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, buffers, num_buffers) < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+io_uring_sqe* Uring::get_sqe() {
+	unsigned tail = *sq_tail + num_queued;
+	unsigned index = tail & *sq_mask;
+	io_uring_sqe *sqe = &sqes[index];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	sq_array[index] = index;
+	num_queued++;
+	return sqe;
+}
+
+void Uring::queue_fixed(uint8_t opcode, int fd, unsigned char *address, uint32_t len, uint16_t buffer_index,
+		uint64_t user_data) {
+	io_uring_sqe *sqe = get_sqe();
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t) address;
+	sqe->len = len;
+	sqe->buf_index = buffer_index;
+	sqe->user_data = user_data;
+}
+
+void Uring::queue_write_fixed(int fd, unsigned char *address, uint32_t len, uint16_t buffer_index,
+		uint64_t user_data) {
+	queue_fixed(IORING_OP_WRITE_FIXED, fd, address, len, buffer_index, user_data);
+}
+
+void Uring::queue_read_fixed(int fd, unsigned char *address, uint32_t len, uint16_t buffer_index,
+		uint64_t user_data) {
+	queue_fixed(IORING_OP_READ_FIXED, fd, address, len, buffer_index, user_data);
+}
+
+int Uring::submit_and_wait(unsigned wait_nr) {
+	//Publish the queued entries to the kernel
+	__atomic_store_n(sq_tail, *sq_tail + num_queued, __ATOMIC_RELEASE);
+	num_queued = 0;
+
+	//The kernel may take fewer entries than offered (such as stopping at a bad one, or when interrupted), the rest
+	//stay in the submission queue ahead of anything queued later & are offered again until every entry is taken
+	while (true) {
+		unsigned to_submit = *sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+		int result = syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, IORING_ENTER_GETEVENTS, NULL, 0);
+		if (result < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		if ((unsigned) result == to_submit) {
+			return 0;
+		}
+		if (result == 0) {
+			//No progress, the entries would never be submitted
+			return -1;
+		}
+	}
+}
+
+bool Uring::pop_completion(uint64_t &user_data, int32_t &result) {
+	unsigned head = *cq_head;
+	if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+	io_uring_cqe *cqe = &cqes[head & *cq_mask];
+	user_data = cqe->user_data;
+	result = cqe->res;
+	__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
@@ -0,0 +1,66 @@
+#ifndef URING_H_
+#define URING_H_
+
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <inttypes.h>
+#include <cstddef>
+
+/**
+ * A minimal io_uring instance driven through raw system calls (no liburing). Reads and writes are queued against
+ * pre-registered buffers and submitted in batches, so several socket operations cost a single system call
+ *
+ */
+class Uring {
+
+	private:
+		int ring_fd;
+
+		//Submission queue ring & entries
+		unsigned char *sq_ring;
+		size_t sq_ring_size;
+		unsigned *sq_head;
+		unsigned *sq_tail;
+		unsigned *sq_mask;
+		unsigned *sq_array;
+		io_uring_sqe *sqes;
+		size_t sqes_size;
+		unsigned num_queued;
+
+		//Completion queue ring
+		unsigned char *cq_ring;
+		size_t cq_ring_size;
+		unsigned *cq_head;
+		unsigned *cq_tail;
+		unsigned *cq_mask;
+		io_uring_cqe *cqes;
+
+		//Gets the next free submission queue entry (zeroed)
+		io_uring_sqe* get_sqe();
+
+		void queue_fixed(uint8_t opcode, int fd, unsigned char *address, uint32_t len, uint16_t buffer_index,
+				uint64_t user_data);
+
+	public:
+		Uring();
+		~Uring();
+
+		//Sets up the ring with room for the specified number of entries. Returns 0: success, -1: io_uring unavailable
+		int init(unsigned entries);
+
+		//Registers the buffers used by fixed reads & writes. Returns 0: success, -1: error
+		int register_buffers(const struct iovec *buffers, unsigned num_buffers);
+
+		//Queues a write/read of len bytes from/into 'address', which must lie within registered buffer 'buffer_index'
+		void queue_write_fixed(int fd, unsigned char *address, uint32_t len, uint16_t buffer_index, uint64_t user_data);
+		void queue_read_fixed(int fd, unsigned char *address, uint32_t len, uint16_t buffer_index, uint64_t user_data);
+
+		//Submits all queued requests (offering the rest again while the kernel takes only some) and waits for at least
+		//wait_nr completions. Returns 0: success, -1: error (including the kernel taking none of the requests)
+		int submit_and_wait(unsigned wait_nr);
+
+		//Retrieves a completion if one is available. Returns true if one was retrieved
+		bool pop_completion(uint64_t &user_data, int32_t &result);
+};
+
+#endif /* URING_H_ */
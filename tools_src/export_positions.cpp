@@ -0,0 +1,79 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "robot.h"
+#include "population_file.h"
+#include "manifest.h"
+
+/**
+ * Converts a set of shards written by the workers (final positions with master '-D output_dir', or a checkpoint) into
+ * the text positions file the master writes otherwise: one "x,y,a" line per robot, ordered by robot id
+ *
+ */
+
+static const char* DEFAULT_OUTPUT_FILE = "robot_positions.txt";
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Manifest not supplied\n");
+		printf("\nUsage: %s manifest [text_file (Default: %s)]\n", argv[0], DEFAULT_OUTPUT_FILE);
+		exit(EXIT_FAILURE);
+	}
+	const char *manifest_path = argv[1];
+	const char *text_path = argc > 2 ? argv[2] : DEFAULT_OUTPUT_FILE;
+
+	Manifest manifest;
+	if (manifest.read(manifest_path) != 0) {
+		exit(EXIT_FAILURE);
+	}
+
+	//Place each robot of each shard by its id
+	uint32_t population_size = manifest.population_size;
+	std::vector<Robot> robots(population_size, Robot(0, 0, 0, 0));
+	std::vector<bool> robot_found(population_size, false);
+	for (uint32_t i = 0; i < manifest.shard_names.size(); i++) {
+		std::string shard_path = manifest.get_shard_path(manifest_path, i);
+		PopulationFile shard;
+		if (shard.open(shard_path.c_str()) != 0) {
+			exit(EXIT_FAILURE);
+		}
+		if (shard.get_world_size() != manifest.world_size || shard.get_population_size() != manifest.shard_sizes.at(i)) {
+			fprintf(stderr, "[Err] Shard '%s' does not match the manifest\n", shard_path.c_str());
+			exit(EXIT_FAILURE);
+		}
+
+		uint32_t num_records;
+		unsigned char *records = shard.get_records(0, shard.get_num_columns() - 1, num_records);
+		for (uint32_t j = 0; j < num_records; j++) {
+			unsigned char *record = records + ((uint64_t) j * Robot::LONG_SERIALIZED_LENGTH);
+			uint32_t robot_id = Robot::get_id_from_serialized(record);
+			if (robot_id < 1 || robot_id > population_size || robot_found[robot_id - 1]) {
+				fprintf(stderr, "[Err] Shard '%s' holds an unexpected robot '%u'\n", shard_path.c_str(), robot_id);
+				exit(EXIT_FAILURE);
+			}
+			robots[robot_id - 1] = Robot(record, Robot::LONG_SERIALIZED_VERSION);
+			robot_found[robot_id - 1] = true;
+		}
+	}
+
+	for (uint32_t i = 0; i < population_size; i++) {
+		if (!robot_found[i]) {
+			fprintf(stderr, "[Err] Robot '%u' is missing from the shards\n", i + 1);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	std::ofstream text_file(text_path);
+	if (!text_file.is_open()) {
+		fprintf(stderr, "[Err] Failed to open text file '%s'\n", text_path);
+		exit(EXIT_FAILURE);
+	}
+	for (uint32_t i = 0; i < population_size; i++) {
+		text_file << robots[i].to_string_short() << '\n';
+	}
+	text_file.close();
+	printf("Exported %u positions (frame %u) to '%s'\n", population_size, manifest.frame, text_path);
+}
@@ -0,0 +1,124 @@
+#include "checkpoint_writer.h"
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include "population_file.h"
+#include "profiling.h"
+
+CheckpointWriter::CheckpointWriter() {
+	frame = 0;
+	num_robots = 0;
+	writing = false;
+	removing = false;
+	completed = false;
+	completed_frame = 0;
+	completed_num_robots = 0;
+
+	if (pthread_mutex_init(&mutex, NULL) != 0) {
+		fprintf(stderr, "[Err] Failed to initialize mutex\n");
+		exit(EXIT_FAILURE);
+	}
+	if (pthread_cond_init(&changed, NULL) != 0) {
+		fprintf(stderr, "[Err] Failed to initialize condition\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void CheckpointWriter::start() {
+	if (pthread_create(&thread, NULL, &run, (void *) this) != 0) {
+		fprintf(stderr, "[Err] Failed to create checkpoint writer thread\n");
+		exit(EXIT_FAILURE);
+	}
+	pthread_detach(thread);
+}
+
+void* CheckpointWriter::run(void* arg) {
+	CheckpointWriter *writer = (CheckpointWriter *) arg;
+
+#ifdef THREAD_DEBUG
+	printf("[THREAD_DEBUG] Thread %lu is writing checkpoints\n", pthread_self());
+#endif
+
+	profiling::lock(&writer->mutex, profiling::CHECKPOINT_WRITER_LOCK);
+	while (true) {
+		while (!writer->writing && writer->removals.empty()) {
+			pthread_cond_wait(&writer->changed, &writer->mutex);
+		}
+		std::vector<std::string> removals;
+		removals.swap(writer->removals);
+		writer->removing = !removals.empty();
+		bool writing = writer->writing;
+
+		//The snapshot is left alone by the worker until we are done with it
+		pthread_mutex_unlock(&writer->mutex);
+		for (unsigned int i = 0; i < removals.size(); i++) {
+			if (unlink(removals.at(i).c_str()) != 0 && errno != ENOENT) {
+				fprintf(stderr, "Failed to remove checkpoint '%s'\n", removals.at(i).c_str());
+			}
+		}
+		if (writing) {
+			std::string temporary_path = writer->path + ".tmp";
+			if (PopulationFile::write_contents(temporary_path.c_str(), writer->contents) != 0
+					|| rename(temporary_path.c_str(), writer->path.c_str()) != 0) {
+				fprintf(stderr, "[Err] Failed to write checkpoint '%s'\n", writer->path.c_str());
+				exit(EXIT_FAILURE);
+			}
+		}
+		profiling::lock(&writer->mutex, profiling::CHECKPOINT_WRITER_LOCK);
+
+		if (writing) {
+			writer->completed = true;
+			writer->completed_frame = writer->frame;
+			writer->completed_num_robots = writer->num_robots;
+			writer->writing = false;
+		}
+		writer->removing = false;
+		pthread_cond_broadcast(&writer->changed);
+	}
+	return 0;
+}
+
+void CheckpointWriter::write(const std::string &path, uint32_t frame, uint32_t num_robots,
+		std::vector<unsigned char> &contents) {
+	profiling::lock(&mutex, profiling::CHECKPOINT_WRITER_LOCK);
+	while (writing) {
+		pthread_cond_wait(&changed, &mutex);
+	}
+	this->path = path;
+	this->frame = frame;
+	this->num_robots = num_robots;
+	this->contents.swap(contents);
+	writing = true;
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&mutex);
+}
+
+bool CheckpointWriter::take_completed(uint32_t &frame, uint32_t &num_robots) {
+	profiling::lock(&mutex, profiling::CHECKPOINT_WRITER_LOCK);
+	bool taken = completed;
+	if (completed) {
+		frame = completed_frame;
+		num_robots = completed_num_robots;
+		completed = false;
+	}
+	pthread_mutex_unlock(&mutex);
+	return taken;
+}
+
+void CheckpointWriter::remove(const std::vector<std::string> &paths) {
+	profiling::lock(&mutex, profiling::CHECKPOINT_WRITER_LOCK);
+	removals.insert(removals.end(), paths.begin(), paths.end());
+	pthread_cond_broadcast(&changed);
+	pthread_mutex_unlock(&mutex);
+}
+
+void CheckpointWriter::wait_until_done() {
+	profiling::lock(&mutex, profiling::CHECKPOINT_WRITER_LOCK);
+	while (writing || removing || !removals.empty()) {
+		pthread_cond_wait(&changed, &mutex);
+	}
+	pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,61 @@
+#ifndef CHECKPOINT_WRITER_H_
+#define CHECKPOINT_WRITER_H_
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+/**
+ * Background writer for checkpoint snapshots. The worker serializes its robots into a buffer between frames & hands
+ * the buffer over, the writer thread writes it out (to a temporary file that is then renamed, so a checkpoint file is
+ * always complete) while the simulation carries on. One snapshot is written at a time. Checkpoints no longer needed
+ * are removed by the writer thread too
+ *
+ */
+class CheckpointWriter {
+
+	private:
+		pthread_t thread;
+		pthread_mutex_t mutex;
+		pthread_cond_t changed;
+
+		//The snapshot handed over (or being written) & whether there is one
+		std::vector<unsigned char> contents;
+		std::string path;
+		uint32_t frame;
+		uint32_t num_robots;
+		bool writing;
+
+		//Checkpoint files to remove & whether some are being removed
+		std::vector<std::string> removals;
+		bool removing;
+
+		//The last snapshot written, not yet taken by the worker
+		bool completed;
+		uint32_t completed_frame;
+		uint32_t completed_num_robots;
+
+		static void* run(void* arg);
+
+	public:
+		CheckpointWriter();
+
+		//Starts the writer thread
+		void start();
+
+		//Hands a snapshot over to be written (waiting for the previous one to be written first). Contents are swapped
+		//with a previously written buffer, which may be reused for the next snapshot
+		void write(const std::string &path, uint32_t frame, uint32_t num_robots, std::vector<unsigned char> &contents);
+
+		//Takes the frame & number of robots of the last written snapshot. Returns false if none was written since
+		bool take_completed(uint32_t &frame, uint32_t &num_robots);
+
+		//Hands over checkpoint files to be removed (a missing file is not an error)
+		void remove(const std::vector<std::string> &paths);
+
+		//Waits until the snapshot handed over (if any) has been written & the files handed over have been removed
+		void wait_until_done();
+};
+
+#endif /* CHECKPOINT_WRITER_H_ */
@@ -15,6 +15,10 @@ PeerConnection::PeerConnection(int fd, Worker& worker, char* ip_address, uint32_
 	connection_type = 0;
 	neighboured = false;
 	next_expected_message = first_expected_message;
+	relinked = false;
+	retired = false;
+	timings.send_ns = 0;
+	timings.receive_ns = 0;
 }
 
 PeerConnection::~PeerConnection() {
@@ -91,7 +95,7 @@ void PeerConnection::handle_neighbour_request() {
 	netutils::insert_uint32_into_message(1, send_message);
 	send_message[4] = protocol::NEIGHBOUR_REQUEST_ACK_MESSAGE;
 
-	protocol::send_message(fd, send_message, 5);
+	protocol::send_message(fd, send_message, 5, &stats);
 	neighboured = true;
 
 	//Notify worker that peer connection is set and wait until simulation is running
@@ -123,40 +127,25 @@ void PeerConnection::handle_neighbour_request_ack() {
 }
 
 void PeerConnection::handle_ghost_strip_message(unsigned char *message) {
-	uint64_t message_index = 1;
-	for (unsigned int i = 0; i < worker->get_num_blocks(); i++) {
-		uint32_t x_coordinate = netutils::get_uint32_from_message(message + message_index);
-		uint32_t y_coordinate = netutils::get_uint32_from_message(message + message_index + 4);
-		MapCoordinate coordinate = MapCoordinate(x_coordinate, y_coordinate);
-		uint32_t num_robots = netutils::get_uint32_from_message(message + message_index + 8);
-		message_index += 12;
-
-		for (unsigned int j = 0; j < num_robots; j++) {
-			Robot *robot = new Robot(message + message_index, Robot::GHOST_SERIALIZED_VERSION);
-			if (connection_type == PeerConnection::LEFT_PEER_CONNECTION) {
-				worker->get_map().add_left_ghost_strip_robot(*robot, coordinate);
-			} else {
-				worker->get_map().add_right_ghost_strip_robot(*robot, coordinate);
-			}
-			message_index += Robot::GHOST_SERIALIZED_LENGTH;
-		}
+	uint64_t start_ns = FrameTimings::get_monotonic_nanoseconds();
+	if (connection_type == PeerConnection::LEFT_PEER_CONNECTION) {
+		worker->set_ring_state_from_left(RobotMap::get_ring_state(message));
+		worker->get_map().add_left_ghost_strip_message(message);
+	} else {
+		worker->get_map().add_right_ghost_strip_message(message);
 	}
-#ifdef NET_DEBUG
-	uint32_t count = 0;
-#endif
+	uint64_t now_ns = FrameTimings::get_monotonic_nanoseconds();
+	timings.receive_ns += now_ns - start_ns;
+	trace.record(TraceBuffer::ADD_GHOST_STRIP, start_ns, 0);
+
+	uint32_t count;
 	if (connection_type == PeerConnection::LEFT_PEER_CONNECTION) {
-#ifdef NET_DEBUG
-		count = worker->get_map().send_left_moved_robots(fd);
-#else
-		worker->get_map().send_left_moved_robots(fd);
-#endif
+		count = worker->get_map().send_left_moved_robots(fd, &stats);
 	} else {
-#ifdef NET_DEBUG
-		count = worker->get_map().send_right_moved_robots(fd);
-#else
-		worker->get_map().send_right_moved_robots(fd);
-#endif
+		count = worker->get_map().send_right_moved_robots(fd, &stats);
 	}
+	timings.send_ns += FrameTimings::get_monotonic_nanoseconds() - now_ns;
+	trace.record(TraceBuffer::SEND_MOVED_ROBOTS, now_ns, count);
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending ADD_ROBOTS_MESSAGE to '%s'(%d) of count %u\n", get_ip_address(), id, count);
 #endif
@@ -165,36 +154,33 @@ void PeerConnection::handle_ghost_strip_message(unsigned char *message) {
 }
 
 void PeerConnection::handle_add_robots_message(unsigned char *message) {
-	uint32_t num_robots = netutils::get_uint32_from_message(message + 1);
-	for (unsigned int i = 0; i < num_robots; i++) {
-		Robot *robot = new Robot(message + 5 + (i * Robot::LONG_SERIALIZED_LENGTH), Robot::LONG_SERIALIZED_VERSION);
-		worker->get_map().add_robot(*robot);
-	}
+	uint64_t start_ns = FrameTimings::get_monotonic_nanoseconds();
+	worker->get_map().add_robots_message(message);
+	timings.receive_ns += FrameTimings::get_monotonic_nanoseconds() - start_ns;
+	uint64_t trace_start_ns = trace.record(TraceBuffer::ADD_ROBOTS, start_ns, 0);
 
 	//Wait for next frame
 	worker->wait_on_worker(connection_type);
+	trace.record(TraceBuffer::WAIT_ON_WORKER, trace_start_ns, 0);
+	if (retired) {
+		suspend_processing();
+		return;
+	}
 
 	send_ghost_strip();
 	next_expected_message = protocol::GHOST_STRIP_MESSAGE;
 }
 
 void PeerConnection::send_ghost_strip() {
-#ifdef NET_DEBUG
-	uint32_t count = 0;
-#endif
+	uint64_t start_ns = FrameTimings::get_monotonic_nanoseconds();
+	uint32_t count;
 	if (connection_type == PeerConnection::LEFT_PEER_CONNECTION) {
-#ifdef NET_DEBUG
-		count = worker->get_map().send_left_ghost_strip_message(fd);
-#else
-		worker->get_map().send_left_ghost_strip_message(fd);
-#endif
+		count = worker->get_map().send_left_ghost_strip_message(fd, worker->get_ring_state_to_right(), &stats);
 	} else {
-#ifdef NET_DEBUG
-		count = worker->get_map().send_right_ghost_strip_message(fd);
-#else
-		worker->get_map().send_right_ghost_strip_message(fd);
-#endif
+		count = worker->get_map().send_right_ghost_strip_message(fd, worker->get_ring_state_to_right(), &stats);
 	}
+	timings.send_ns += FrameTimings::get_monotonic_nanoseconds() - start_ns;
+	trace.record(TraceBuffer::SEND_GHOST_STRIP, start_ns, count);
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending GHOST_STRIP_MESSAGE to '%s'(%d) of count %u\n", get_ip_address(), id, count);
 #endif
@@ -203,10 +189,15 @@ void PeerConnection::send_ghost_strip() {
 
 void PeerConnection::start() {
 
-	//Wait until worker releases the lock so we can start
-	this->worker->get_and_release_lock();
+	//Wait until worker signals us so we can start (a relinked connection joins in the worker's next frame)
+	if (relinked) {
+		worker->wait_to_rejoin(connection_type);
+		send_ghost_strip();
+	} else {
+		this->worker->wait_until_started();
+	}
 
-	while (true) {
+	while (!retired) {
 		int result = fill_buffer_and_process();
 		if (result <= 0) {
 			//Only fail loudly if this is a functioning neighbour
@@ -224,3 +215,29 @@ void PeerConnection::start() {
 		}
 	}
 }
+
+void PeerConnection::relink(uint32_t connection_type) {
+	this->connection_type = connection_type;
+	relinked = true;
+	neighboured = true;
+	next_expected_message = protocol::GHOST_STRIP_MESSAGE;
+}
+
+void PeerConnection::retire() {
+	retired = true;
+}
+
+bool PeerConnection::is_retired() {
+	return retired;
+}
+
+HaloTimings PeerConnection::take_timings() {
+	HaloTimings taken = timings;
+	timings.send_ns = 0;
+	timings.receive_ns = 0;
+	return taken;
+}
+
+TraceBuffer& PeerConnection::get_trace() {
+	return trace;
+}
@@ -6,6 +6,8 @@
 #include <vector>
 
 #include "connection_handler.h"
+#include "frame_timings.h"
+#include "trace_buffer.h"
 #include "worker.h"
 
 //Forward declaration
@@ -27,6 +29,17 @@ class PeerConnection: public ConnectionHandler {
 
 		unsigned char next_expected_message;
 
+		//Has the connection taken over from the worker's previous connection to a neighbour during the simulation? Has
+		//it been replaced itself (its thread ends once the worker releases it into the next frame)?
+		bool relinked;
+		bool retired;
+
+		//Time spent sending & adding halos since the worker last took them
+		HaloTimings timings;
+
+		//Trace events of this connection's thread (tracing runs)
+		TraceBuffer trace;
+
 		void verify_message_expected(unsigned char message_type);
 
 		void handle_message(unsigned char *message, uint32_t length);
@@ -49,6 +62,22 @@ class PeerConnection: public ConnectionHandler {
 
 		//Main connection routine
 		void start();
+
+		//Takes over as the worker's connection of the type during the simulation, the neighbour handshake having been
+		//done by the worker. Before the thread is started
+		void relink(uint32_t connection_type);
+
+		//Ends the connection's thread once the worker releases it into the next frame, without exchanging any more
+		//messages (while the worker has us waiting)
+		void retire();
+
+		bool is_retired();
+
+		//Returns & resets the time spent sending & adding halos (while the worker has us waiting)
+		HaloTimings take_timings();
+
+		//Trace events of this connection's thread, enabled by the worker before the simulation begins
+		TraceBuffer& get_trace();
 };
 
 #endif /* PEER_CONNECTION_H_ */
@@ -0,0 +1,201 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+
+static const char* COUNTER_NAMES[PerfCounters::NUM_COUNTERS] = { "cycles", "instructions", "L1D misses", "LLC misses",
+		"branch misses" };
+
+static const char* PHASE_NAMES[PerfCounters::NUM_PHASES] = { "clear_ghost_strips", "update_positions", "halo_exchange",
+		"update_sensors", "set_speeds" };
+
+//Event type & config of each counter
+static const uint32_t COUNTER_TYPES[PerfCounters::NUM_COUNTERS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+		PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+static const uint64_t COUNTER_CONFIGS[PerfCounters::NUM_COUNTERS] = { PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+				| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+
+PerfCounters::PerfCounters() {
+	leader_fd = -1;
+	num_open = 0;
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		fds[counter] = -1;
+		read_index[counter] = 0;
+		last[counter] = 0;
+		for (int phase = 0; phase < NUM_PHASES; phase++) {
+			interval_totals[phase][counter] = 0;
+			run_totals[phase][counter] = 0;
+		}
+	}
+	interval_frames = 0;
+	run_frames = 0;
+}
+
+PerfCounters::~PerfCounters() {
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		if (fds[counter] >= 0) {
+			close(fds[counter]);
+		}
+	}
+}
+
+int PerfCounters::open() {
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof attr);
+		attr.size = sizeof attr;
+		attr.type = COUNTER_TYPES[counter];
+		attr.config = COUNTER_CONFIGS[counter];
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		//The group starts once the leader is enabled
+		attr.disabled = leader_fd < 0 ? 1 : 0;
+
+		//This thread, on any CPU
+		int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader_fd, 0);
+		if (fd < 0) {
+			continue;
+		}
+		fds[counter] = fd;
+		if (leader_fd < 0) {
+			leader_fd = fd;
+		}
+		read_index[counter] = num_open++;
+	}
+	if (leader_fd < 0) {
+		return -1;
+	}
+	if (ioctl(leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) != 0
+			|| ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+		return -1;
+	}
+	return 0;
+}
+
+bool PerfCounters::is_available(Counter counter) {
+	return fds[counter] >= 0;
+}
+
+void PerfCounters::read_counters(uint64_t *values) {
+	//Number of counters, time enabled & time running, then the value of each counter
+	uint64_t group[3 + NUM_COUNTERS];
+	if (read(leader_fd, group, sizeof group) < (ssize_t) ((3 + num_open) * sizeof(uint64_t))) {
+		memset(group, 0, sizeof group);
+	}
+	uint64_t time_enabled = group[1];
+	uint64_t time_running = group[2];
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		if (fds[counter] < 0) {
+			values[counter] = 0;
+			continue;
+		}
+		uint64_t value = group[3 + read_index[counter]];
+
+		//The group only counted for part of the time when sharing the hardware with other groups
+		if (time_running > 0 && time_running < time_enabled) {
+			value = (double) value * time_enabled / time_running;
+		}
+		values[counter] = value;
+	}
+}
+
+void PerfCounters::start() {
+	read_counters(last);
+}
+
+void PerfCounters::record(Phase phase) {
+	uint64_t now[NUM_COUNTERS];
+	read_counters(now);
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		uint64_t delta = now[counter] > last[counter] ? now[counter] - last[counter] : 0;
+		interval_totals[phase][counter] += delta;
+		run_totals[phase][counter] += delta;
+		last[counter] = now[counter];
+	}
+}
+
+void PerfCounters::frame_completed() {
+	interval_frames++;
+	run_frames++;
+}
+
+void PerfCounters::print_totals(const uint64_t totals[NUM_PHASES][NUM_COUNTERS], uint32_t frames, bool *available) {
+	printf("   %-20s", "phase");
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		printf(" %14s", COUNTER_NAMES[counter]);
+	}
+	printf(" %6s %9s %12s\n", "IPC", "L1D MPKI", "branch MPKI");
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		printf("   %-20s", PHASE_NAMES[phase]);
+		for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+			if (available[counter]) {
+				printf(" %14.0f", (double) totals[phase][counter] / frames);
+			} else {
+				printf(" %14s", "n/a");
+			}
+		}
+
+		//Per instruction: instructions per cycle & misses per thousand instructions
+		uint64_t instructions = totals[phase][INSTRUCTIONS];
+		if (available[CYCLES] && available[INSTRUCTIONS] && totals[phase][CYCLES] > 0) {
+			printf(" %6.2f", (double) instructions / totals[phase][CYCLES]);
+		} else {
+			printf(" %6s", "n/a");
+		}
+		if (available[L1D_MISSES] && available[INSTRUCTIONS] && instructions > 0) {
+			printf(" %9.2f", totals[phase][L1D_MISSES] * 1000.0 / instructions);
+		} else {
+			printf(" %9s", "n/a");
+		}
+		if (available[BRANCH_MISSES] && available[INSTRUCTIONS] && instructions > 0) {
+			printf(" %12.2f\n", totals[phase][BRANCH_MISSES] * 1000.0 / instructions);
+		} else {
+			printf(" %12s\n", "n/a");
+		}
+	}
+}
+
+void PerfCounters::print_interval(uint32_t last_frame) {
+	if (interval_frames == 0) {
+		return;
+	}
+	bool available[NUM_COUNTERS];
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		available[counter] = is_available((Counter) counter);
+	}
+	printf("Perf counters per frame over frames %u-%u:\n", last_frame + 1 - interval_frames, last_frame);
+	print_totals(interval_totals, interval_frames, available);
+	for (int phase = 0; phase < NUM_PHASES; phase++) {
+		for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+			interval_totals[phase][counter] = 0;
+		}
+	}
+	interval_frames = 0;
+}
+
+void PerfCounters::print_run() {
+	if (run_frames == 0) {
+		return;
+	}
+	bool available[NUM_COUNTERS];
+	for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+		available[counter] = is_available((Counter) counter);
+	}
+	printf("Perf counters per frame over the run (%u frames, worker thread only):\n", run_frames);
+	print_totals(run_totals, run_frames, available);
+}
+
+const char* PerfCounters::get_counter_name(Counter counter) {
+	return COUNTER_NAMES[counter];
+}
+
+const char* PerfCounters::get_phase_name(Phase phase) {
+	return PHASE_NAMES[phase];
+}
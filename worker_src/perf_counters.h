@@ -0,0 +1,83 @@
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <inttypes.h>
+
+/**
+ * Hardware performance counters of the worker thread (perf_event_open), read around each phase of the simulation loop
+ * & accumulated per phase over an interval of frames and over the run. The counters are opened as one group, read with
+ * a single call at each phase boundary. Counters the kernel or the hardware does not provide (e.g. in containers) are
+ * left out, reading as unavailable, and sampling is off when none are
+ *
+ */
+class PerfCounters {
+
+	public:
+		enum Counter {
+			CYCLES,
+			INSTRUCTIONS,
+			L1D_MISSES,
+			LLC_MISSES,
+			BRANCH_MISSES,
+			NUM_COUNTERS
+		};
+
+		enum Phase {
+			CLEAR_GHOST_STRIPS,
+			UPDATE_POSITIONS,
+			HALO_EXCHANGE,
+			UPDATE_SENSORS,
+			SET_SPEEDS,
+			NUM_PHASES
+		};
+
+	private:
+		//Group members (-1: unavailable), the group leader & the position of each member within a group read
+		int fds[NUM_COUNTERS];
+		int leader_fd;
+		uint32_t num_open;
+		uint32_t read_index[NUM_COUNTERS];
+
+		//Counter values at the last phase boundary
+		uint64_t last[NUM_COUNTERS];
+
+		//Per phase totals & frames, over the current interval & the run
+		uint64_t interval_totals[NUM_PHASES][NUM_COUNTERS];
+		uint64_t run_totals[NUM_PHASES][NUM_COUNTERS];
+		uint32_t interval_frames;
+		uint32_t run_frames;
+
+		// Reads every counter (scaled when the group was multiplexed)
+		void read_counters(uint64_t *values);
+
+		static void print_totals(const uint64_t totals[NUM_PHASES][NUM_COUNTERS], uint32_t frames, bool *available);
+
+	public:
+		PerfCounters();
+		~PerfCounters();
+
+		// Opens the counters for the calling thread. Returns 0: at least one counter is counting, -1: none are
+		int open();
+
+		bool is_available(Counter counter);
+
+		// Marks the start of a frame's first phase
+		void start();
+
+		// Accounts the counts since the previous phase boundary to the phase, which ended now
+		void record(Phase phase);
+
+		void frame_completed();
+
+		// Prints the counters per frame of each phase over the interval, then starts a new interval
+		void print_interval(uint32_t last_frame);
+
+		// Prints the counters per frame of each phase over the run
+		void print_run();
+
+		static const char* get_counter_name(Counter counter);
+
+		static const char* get_phase_name(Phase phase);
+};
+
+#endif /* PERF_COUNTERS_H_ */
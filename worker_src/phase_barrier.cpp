@@ -0,0 +1,84 @@
+#include "phase_barrier.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+
+#include "frame_timings.h"
+#include "profiling.h"
+
+PhaseBarrier::PhaseBarrier(uint32_t num_parties) {
+	this->num_parties = num_parties;
+	release_sequence = 0;
+	arrivals = 0;
+	release_waiters = 0;
+	arrival_waiters = 0;
+	expected_arrivals = 0;
+
+	//Spinning only helps if the thread we are waiting on can run at the same time
+	spin_limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_LIMIT : 0;
+}
+
+void PhaseBarrier::advance(uint32_t *counter, uint32_t *waiters) {
+	__atomic_add_fetch(counter, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(waiters, __ATOMIC_SEQ_CST) > 0) {
+		syscall(SYS_futex, counter, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+	}
+}
+
+void PhaseBarrier::wait_until_reached(uint32_t *counter, uint32_t target, uint32_t *waiters) {
+#ifdef PROFILE_HOOKS
+	uint64_t start_ns = FrameTimings::get_monotonic_nanoseconds();
+	bool parked = false;
+#endif
+	for (uint32_t spins = 0; spins < spin_limit; spins++) {
+		if ((int32_t) (__atomic_load_n(counter, __ATOMIC_ACQUIRE) - target) >= 0) {
+			profiling::record_acquisition(profiling::PEER_BARRIER, false, 0);
+			return;
+		}
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+
+	// Register as parked before the final checks so that advance() is guaranteed to either see us or have its
+	// increment seen by us (the futex call itself fails if the counter has moved on)
+	__atomic_add_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+	while (true) {
+		uint32_t value = __atomic_load_n(counter, __ATOMIC_SEQ_CST);
+		if ((int32_t) (value - target) >= 0) {
+			break;
+		}
+		syscall(SYS_futex, counter, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#ifdef PROFILE_HOOKS
+		parked = true;
+#endif
+	}
+	__atomic_sub_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+#ifdef PROFILE_HOOKS
+	//Only parking counts as contended, spinning is the fast path
+	profiling::record_acquisition(profiling::PEER_BARRIER, parked,
+			parked ? FrameTimings::get_monotonic_nanoseconds() - start_ns : 0);
+#endif
+}
+
+void PhaseBarrier::release_and_wait() {
+	expected_arrivals += num_parties;
+	advance(&release_sequence, &release_waiters);
+	wait_until_reached(&arrivals, expected_arrivals, &arrival_waiters);
+}
+
+void PhaseBarrier::arrive_and_wait(uint32_t &num_arrivals) {
+	num_arrivals++;
+	advance(&arrivals, &arrival_waiters);
+	wait_until_reached(&release_sequence, num_arrivals + 1, &release_waiters);
+}
+
+void PhaseBarrier::wait_until_started() {
+	wait_until_reached(&release_sequence, 1, &release_waiters);
+}
+
+void PhaseBarrier::wait_for_release(uint32_t num_arrivals) {
+	wait_until_reached(&release_sequence, num_arrivals + 1, &release_waiters);
+}
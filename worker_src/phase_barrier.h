@@ -0,0 +1,57 @@
+#ifndef PHASE_BARRIER_H_
+#define PHASE_BARRIER_H_
+
+#include <inttypes.h>
+
+/**
+ * Lock-free handoff between a coordinating thread (the worker) and a fixed number of party threads (the peer
+ * connections). The coordinator releases the parties into their next phase by bumping a sequence counter and then
+ * waits for their arrivals on a second counter. Waiters spin for a bounded number of iterations before parking on a
+ * futex, and futex wakes are only issued when someone is actually parked
+ *
+ */
+class PhaseBarrier {
+
+	private:
+		//Iterations to spin before parking (only on machines with more than one CPU)
+		static const uint32_t SPIN_LIMIT = 4000;
+
+		uint32_t num_parties;
+		uint32_t spin_limit;
+
+		//Bumped by the coordinator once per release; counts every party arrival respectively
+		uint32_t release_sequence;
+		uint32_t arrivals;
+
+		//Number of threads parked on the respective counter
+		uint32_t release_waiters;
+		uint32_t arrival_waiters;
+
+		//Arrivals the coordinator is waiting for (coordinator only)
+		uint32_t expected_arrivals;
+
+		//Increments a counter and wakes up anyone parked on it
+		static void advance(uint32_t *counter, uint32_t *waiters);
+
+		//Waits until a counter reaches the target, spinning first and then parking
+		void wait_until_reached(uint32_t *counter, uint32_t target, uint32_t *waiters);
+
+	public:
+		PhaseBarrier(uint32_t num_parties);
+
+		//Coordinator: releases the parties into their next phase and waits until all of them have arrived
+		void release_and_wait();
+
+		//Party: arrives after finishing a phase and waits until released into the next one. num_arrivals is the
+		//party's own arrival count (starting at 0), which is updated
+		void arrive_and_wait(uint32_t &num_arrivals);
+
+		//Party: waits until the coordinator has released the parties at least once
+		void wait_until_started();
+
+		//Party: waits without arriving until released into the phase after num_arrivals arrivals, taking the place of
+		//a party that has arrived that often (& is released along with us, without arriving again)
+		void wait_for_release(uint32_t num_arrivals);
+};
+
+#endif /* PHASE_BARRIER_H_ */
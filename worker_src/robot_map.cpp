@@ -170,19 +170,53 @@ void RobotMap::clear_ghost_strips() {
 	}
 }
 
-uint32_t RobotMap::send_ghost_strip_message(int fd, uint32_t ghost_x_index) {
+void RobotMap::set_bounds(uint32_t left_x_bound, uint32_t right_x_bound, std::vector<Robot*> &removed_robots) {
+	clear_ghost_strips();
+	uint32_t new_width = right_x_bound - left_x_bound + 1;
+	for (unsigned int y = 0; y < num_blocks; y++) {
+		std::vector<Robot*> **row = new std::vector<Robot*>*[new_width + 2];
+		row[0] = grid[y][0];
+		row[new_width + 1] = grid[y][width + 1];
+		for (unsigned int x = 1; x <= new_width; x++) {
+			uint32_t x_index = left_x_bound + x - 1;
+			if (x_index >= this->left_x_bound && x_index <= this->right_x_bound) {
+				row[x] = grid[y][localize_coordinate(MapCoordinate(x_index, y)).first];
+			} else {
+				row[x] = new std::vector<Robot*>();
+			}
+		}
+		for (unsigned int x = 1; x <= width; x++) {
+			uint32_t x_index = unlocalize_coordinate(MapCoordinate(x, y)).first;
+			if (x_index < left_x_bound || x_index > right_x_bound) {
+				removed_robots.insert(removed_robots.end(), grid[y][x]->begin(), grid[y][x]->end());
+				delete grid[y][x];
+			}
+		}
+		delete[] grid[y];
+		grid[y] = row;
+	}
+	this->left_x_bound = left_x_bound;
+	this->right_x_bound = right_x_bound;
+	width = new_width;
+}
+
+uint32_t RobotMap::ghost_strip_message_size(uint32_t ghost_x_index) {
 	// Get the total count
 	uint32_t total_robot_count = 0;
 	for (unsigned int y = 0; y < num_blocks; y++) {
 		total_robot_count += grid[y][ghost_x_index]->size();
 	}
+	return (num_blocks * 12) + (total_robot_count * Robot::GHOST_SERIALIZED_LENGTH) + 13;
+}
 
-	// Create the message
-	uint32_t message_size = (num_blocks * 12) + (total_robot_count * Robot::GHOST_SERIALIZED_LENGTH) + 5;
-	unsigned char message[message_size];
+uint32_t RobotMap::write_ghost_strip_message(unsigned char* message, uint32_t ghost_x_index,
+		const RingState &ring_state) {
+	uint32_t message_size = ghost_strip_message_size(ghost_x_index);
 	netutils::insert_uint32_into_message(message_size - 4, message);
 	message[4] = protocol::GHOST_STRIP_MESSAGE;
-	uint64_t message_index = 5;
+	netutils::insert_uint32_into_message(ring_state.completed_frames, &message[5]);
+	netutils::insert_uint32_into_message(ring_state.reconfigure_frame, &message[9]);
+	uint64_t message_index = 13;
 
 	uint32_t count = 0;
 	for (unsigned int y = 0; y < num_blocks; y++) {
@@ -202,15 +236,50 @@ uint32_t RobotMap::send_ghost_strip_message(int fd, uint32_t ghost_x_index) {
 			count++;
 		}
 	}
-	protocol::send_message(fd, message, message_size);
 	return count;
 }
 
-uint32_t RobotMap::send_left_ghost_strip_message(int fd) {
-	return send_ghost_strip_message(fd, 1);
+uint32_t RobotMap::send_ghost_strip_message(int fd, uint32_t ghost_x_index, const RingState &ring_state,
+		MessageStats *stats) {
+	// Create the message
+	uint32_t message_size = ghost_strip_message_size(ghost_x_index);
+	unsigned char message[message_size];
+	uint32_t count = write_ghost_strip_message(message, ghost_x_index, ring_state);
+	protocol::send_message(fd, message, message_size, stats);
+	return count;
 }
-uint32_t RobotMap::send_right_ghost_strip_message(int fd) {
-	return send_ghost_strip_message(fd, width);
+
+uint32_t RobotMap::send_left_ghost_strip_message(int fd, const RingState &ring_state, MessageStats *stats) {
+	return send_ghost_strip_message(fd, 1, ring_state, stats);
+}
+uint32_t RobotMap::send_right_ghost_strip_message(int fd, const RingState &ring_state, MessageStats *stats) {
+	return send_ghost_strip_message(fd, width, ring_state, stats);
+}
+
+RingState RobotMap::get_ring_state(unsigned char* message) {
+	RingState ring_state;
+	ring_state.completed_frames = netutils::get_uint32_from_message(message + 1);
+	ring_state.reconfigure_frame = netutils::get_uint32_from_message(message + 5);
+	return ring_state;
+}
+
+uint32_t RobotMap::write_left_ghost_strip_message(unsigned char* buffer, uint32_t capacity,
+		const RingState &ring_state) {
+	uint32_t message_size = ghost_strip_message_size(1);
+	if (message_size > capacity) {
+		return 0;
+	}
+	write_ghost_strip_message(buffer, 1, ring_state);
+	return message_size;
+}
+uint32_t RobotMap::write_right_ghost_strip_message(unsigned char* buffer, uint32_t capacity,
+		const RingState &ring_state) {
+	uint32_t message_size = ghost_strip_message_size(width);
+	if (message_size > capacity) {
+		return 0;
+	}
+	write_ghost_strip_message(buffer, width, ring_state);
+	return message_size;
 }
 
 void RobotMap::add_ghost_strip_robot(Robot& robot, MapCoordinate coordinate, uint32_t ghost_x_index) {
@@ -224,17 +293,50 @@ void RobotMap::add_right_ghost_strip_robot(Robot& robot, MapCoordinate coordinat
 	add_ghost_strip_robot(robot, coordinate, width + 1);
 }
 
-uint32_t RobotMap::send_moved_robots(int fd, std::vector<std::pair<MapCoordinate, Robot*>>* robots, int flag) {
+void RobotMap::add_ghost_strip_message(unsigned char* message, uint32_t ghost_x_index) {
+	//Skip the type & ring state
+	uint64_t message_index = 9;
+	for (unsigned int i = 0; i < num_blocks; i++) {
+		uint32_t x_coordinate = netutils::get_uint32_from_message(message + message_index);
+		uint32_t y_coordinate = netutils::get_uint32_from_message(message + message_index + 4);
+		MapCoordinate coordinate = MapCoordinate(x_coordinate, y_coordinate);
+		uint32_t num_robots = netutils::get_uint32_from_message(message + message_index + 8);
+		message_index += 12;
+
+		for (unsigned int j = 0; j < num_robots; j++) {
+			Robot *robot = new Robot(message + message_index, Robot::GHOST_SERIALIZED_VERSION);
+			add_ghost_strip_robot(*robot, coordinate, ghost_x_index);
+			message_index += Robot::GHOST_SERIALIZED_LENGTH;
+		}
+	}
+}
+
+void RobotMap::add_left_ghost_strip_message(unsigned char* message) {
+	add_ghost_strip_message(message, 0);
+}
+void RobotMap::add_right_ghost_strip_message(unsigned char* message) {
+	add_ghost_strip_message(message, width + 1);
+}
+
+void RobotMap::add_robots_message(unsigned char* message) {
+	uint32_t num_robots = netutils::get_uint32_from_message(message + 1);
+	for (unsigned int i = 0; i < num_robots; i++) {
+		Robot *robot = new Robot(message + 5 + (i * Robot::LONG_SERIALIZED_LENGTH), Robot::LONG_SERIALIZED_VERSION);
+		add_robot(*robot);
+	}
+}
+
+void RobotMap::write_moved_robots(unsigned char* message, std::vector<std::pair<MapCoordinate, Robot*>>* robots,
+		int flag) {
 	uint32_t message_size = 9 + (robots->size() * Robot::LONG_SERIALIZED_LENGTH);
-	unsigned char send_message[message_size];
-	netutils::insert_uint32_into_message(message_size - 4, send_message);
-	send_message[4] = protocol::ADD_ROBOTS_MESSAGE;
-	netutils::insert_uint32_into_message(robots->size(), &send_message[5]);
+	netutils::insert_uint32_into_message(message_size - 4, message);
+	message[4] = protocol::ADD_ROBOTS_MESSAGE;
+	netutils::insert_uint32_into_message(robots->size(), &message[5]);
 
 	for (unsigned int i = 0; i < robots->size(); i++) {
 		MapCoordinate coordinate = robots->at(i).first;
 		Robot *robot = robots->at(i).second;
-		robot->serialize_long(&send_message[9 + (i * Robot::LONG_SERIALIZED_LENGTH)]);
+		robot->serialize_long(&message[9 + (i * Robot::LONG_SERIALIZED_LENGTH)]);
 
 		// Tricky: Insert these into our ghost strip. We held off sending these before ghost strip exchanges to avoid
 		// the overhead of getting them right back in the respective ghost strip
@@ -244,24 +346,53 @@ uint32_t RobotMap::send_moved_robots(int fd, std::vector<std::pair<MapCoordinate
 			add_right_ghost_strip_robot(*robot, coordinate);
 		}
 	}
-	protocol::send_message(fd, send_message, message_size);
+}
+
+uint32_t RobotMap::send_moved_robots(int fd, std::vector<std::pair<MapCoordinate, Robot*>>* robots, int flag,
+		MessageStats *stats) {
+	uint32_t message_size = 9 + (robots->size() * Robot::LONG_SERIALIZED_LENGTH);
+	unsigned char send_message[message_size];
+	write_moved_robots(send_message, robots, flag);
+	protocol::send_message(fd, send_message, message_size, stats);
 	return robots->size();
 }
 
-uint32_t RobotMap::send_left_moved_robots(int fd) {
-	return send_moved_robots(fd, &left_neighbours_robots, 0);
+uint32_t RobotMap::send_left_moved_robots(int fd, MessageStats *stats) {
+	return send_moved_robots(fd, &left_neighbours_robots, 0, stats);
+}
+uint32_t RobotMap::send_right_moved_robots(int fd, MessageStats *stats) {
+	return send_moved_robots(fd, &right_neighbours_robots, 1, stats);
+}
+
+uint32_t RobotMap::write_left_moved_robots(unsigned char* buffer, uint32_t capacity) {
+	uint32_t message_size = 9 + (left_neighbours_robots.size() * Robot::LONG_SERIALIZED_LENGTH);
+	if (message_size > capacity) {
+		return 0;
+	}
+	write_moved_robots(buffer, &left_neighbours_robots, 0);
+	return message_size;
 }
-uint32_t RobotMap::send_right_moved_robots(int fd) {
-	return send_moved_robots(fd, &right_neighbours_robots, 1);
+uint32_t RobotMap::write_right_moved_robots(unsigned char* buffer, uint32_t capacity) {
+	uint32_t message_size = 9 + (right_neighbours_robots.size() * Robot::LONG_SERIALIZED_LENGTH);
+	if (message_size > capacity) {
+		return 0;
+	}
+	write_moved_robots(buffer, &right_neighbours_robots, 1);
+	return message_size;
 }
 
-void RobotMap::send_final_positions_message(int fd) {
+uint32_t RobotMap::count_robots() {
 	uint32_t num_robots = 0;
 	for (unsigned int y = 0; y < num_blocks; y++) {
 		for (unsigned int x = 1; x <= width; x++) {
 			num_robots += grid[y][x]->size();
 		}
 	}
+	return num_robots;
+}
+
+void RobotMap::send_final_positions_message(int fd, MessageStats *stats) {
+	uint32_t num_robots = count_robots();
 
 	uint32_t message_size = 9 + (num_robots * Robot::NORMAL_SERIALIZED_LENGTH);
 	unsigned char message[message_size];
@@ -278,29 +409,46 @@ void RobotMap::send_final_positions_message(int fd) {
 			}
 		}
 	}
-	protocol::send_message(fd, message, message_size);
+	protocol::send_message(fd, message, message_size, stats);
 }
 
-void RobotMap::send_frame_stats_message(int fd) {
-	uint32_t total_local_blocks = num_blocks * width;
-	uint32_t message_size = 9 + (total_local_blocks * 12);
-	unsigned char message[message_size];
-	netutils::insert_uint32_into_message(message_size - 4, message);
-	message[4] = protocol::FRAME_FINISHED_WITH_STATS_MESSAGE;
-	netutils::insert_uint32_into_message(total_local_blocks, &message[5]);
+void RobotMap::get_robots(std::vector<Robot*> &robots) {
+	for (unsigned int y = 0; y < num_blocks; y++) {
+		for (unsigned int x = 1; x <= width; x++) {
+			robots.insert(robots.end(), grid[y][x]->begin(), grid[y][x]->end());
+		}
+	}
+}
+
+void RobotMap::send_frame_stats_message(int fd, uint32_t frame, uint32_t compute_us, uint32_t pool_size,
+		MessageStats *stats) {
+	uint32_t pooled_width = width / pool_size;
+	uint32_t pooled_height = num_blocks / pool_size;
 
-	uint32_t block_count = 0;
+	//Sum each k x k group of our blocks
+	pooled_counts.assign(pooled_width * pooled_height, 0);
 	for (uint32_t y = 0; y < num_blocks; y++) {
+		uint32_t *pooled_row = &pooled_counts[(y / pool_size) * pooled_width];
 		for (uint32_t x = 1; x <= width; x++) {
-			MapCoordinate coordinate = unlocalize_coordinate(MapCoordinate(x, y));
-			uint32_t offset = block_count * 12;
-			netutils::insert_uint32_into_message(coordinate.first, &message[9 + offset]);
-			netutils::insert_uint32_into_message(coordinate.second, &message[13 + offset]);
-			netutils::insert_uint32_into_message(grid[y][x]->size(), &message[17 + offset]);
-			block_count++;
+			pooled_row[(x - 1) / pool_size] += grid[y][x]->size();
 		}
 	}
-	protocol::send_message(fd, message, message_size);
+
+	//Coordinates are implied by our bounds, so only the counts are sent
+	uint32_t message_size = 25 + (pooled_counts.size() * 4);
+	frame_stats_message.resize(message_size);
+	unsigned char *message = &frame_stats_message[0];
+	netutils::insert_uint32_into_message(message_size - 4, message);
+	message[4] = protocol::FRAME_FINISHED_WITH_STATS_MESSAGE;
+	netutils::insert_uint32_into_message(frame, &message[5]);
+	netutils::insert_uint32_into_message(compute_us, &message[9]);
+	netutils::insert_uint32_into_message(unlocalize_coordinate(MapCoordinate(1, 0)).first / pool_size, &message[13]);
+	netutils::insert_uint32_into_message(pooled_width, &message[17]);
+	netutils::insert_uint32_into_message(pooled_height, &message[21]);
+	for (uint32_t i = 0; i < pooled_counts.size(); i++) {
+		netutils::insert_uint32_into_message(pooled_counts[i], &message[25 + (i * 4)]);
+	}
+	protocol::send_message(fd, message, message_size, stats);
 }
 
 void RobotMap::dump_map() {
@@ -5,6 +5,18 @@
 #include <inttypes.h>
 
 #include "robot.h"
+#include "message_stats.h"
+
+/**
+ * Counts passed from worker to worker along the ring (from worker 1 rightwards) inside ghost strips
+ *
+ */
+struct RingState {
+	//Frames completed by every worker from worker 1 up to the sender
+	uint32_t completed_frames;
+	//The frame (number of frames simulated) after which the ring is reconfigured (0: none)
+	uint32_t reconfigure_frame;
+};
 
 /**
  *
@@ -24,6 +36,10 @@ class RobotMap {
 		std::vector<std::pair<MapCoordinate, Robot*>> left_neighbours_robots;
 		std::vector<std::pair<MapCoordinate, Robot*>> right_neighbours_robots;
 
+		// Reused buffers for FRAME_FINISHED_WITH_STATS_MESSAGE
+		std::vector<uint32_t> pooled_counts;
+		std::vector<unsigned char> frame_stats_message;
+
 		MapCoordinate localize_coordinate(MapCoordinate coordinate);
 		MapCoordinate unlocalize_coordinate(MapCoordinate coordinate);
 		int32_t wrap_y_coordinate(int32_t y);
@@ -31,11 +47,17 @@ class RobotMap {
 		// Compares a robot to all robots within the specified block
 		void compare_robot_to_block(Robot *robot, MapCoordinate localized_coordinate);
 
-		uint32_t send_ghost_strip_message(int fd, uint32_t ghost_x_index);
+		uint32_t ghost_strip_message_size(uint32_t ghost_x_index);
+		uint32_t write_ghost_strip_message(unsigned char* message, uint32_t ghost_x_index, const RingState &ring_state);
+		uint32_t send_ghost_strip_message(int fd, uint32_t ghost_x_index, const RingState &ring_state,
+				MessageStats *stats);
 
 		void add_ghost_strip_robot(Robot& robot, MapCoordinate coordinate, uint32_t ghost_x_index);
+		void add_ghost_strip_message(unsigned char* message, uint32_t ghost_x_index);
 
-		uint32_t send_moved_robots(int fd, std::vector<std::pair<MapCoordinate, Robot*>>* robots, int flag);
+		void write_moved_robots(unsigned char* message, std::vector<std::pair<MapCoordinate, Robot*>>* robots, int flag);
+		uint32_t send_moved_robots(int fd, std::vector<std::pair<MapCoordinate, Robot*>>* robots, int flag,
+				MessageStats *stats);
 
 	public:
 		RobotMap(uint32_t num_blocks, uint32_t left_x_bound, uint32_t right_x_bound);
@@ -47,6 +69,13 @@ class RobotMap {
 		void add_left_ghost_strip_robot(Robot& robot, MapCoordinate coordinate);
 		void add_right_ghost_strip_robot(Robot& robot, MapCoordinate coordinate);
 
+		// Adds the ghost robots of a received GHOST_STRIP_MESSAGE (starting at the message type) to a ghost strip
+		void add_left_ghost_strip_message(unsigned char* message);
+		void add_right_ghost_strip_message(unsigned char* message);
+
+		// Takes ownership of the robots of a received ADD_ROBOTS_MESSAGE (starting at the message type)
+		void add_robots_message(unsigned char* message);
+
 		// Updates all robot positions according to their current speed (1)
 		void update_robot_positions_and_reset_sensors();
 
@@ -58,17 +87,41 @@ class RobotMap {
 
 		void clear_ghost_strips();
 
-		uint32_t send_left_ghost_strip_message(int fd);
-		uint32_t send_right_ghost_strip_message(int fd);
+		// Moves our bounds to the block columns given (between frames, overlapping columns keep their robots). The ghost
+		// strips are cleared & the robots of the columns given up are added to the collection, for the caller to hand
+		// over or delete
+		void set_bounds(uint32_t left_x_bound, uint32_t right_x_bound, std::vector<Robot*> &removed_robots);
+
+		// Ghost strip messages also carry the sending worker's ring state
+		uint32_t send_left_ghost_strip_message(int fd, const RingState &ring_state, MessageStats *stats);
+		uint32_t send_right_ghost_strip_message(int fd, const RingState &ring_state, MessageStats *stats);
+
+		// Reads the ring state of a received GHOST_STRIP_MESSAGE (starting at the message type)
+		static RingState get_ring_state(unsigned char* message);
 
-		uint32_t send_left_moved_robots(int fd);
-		uint32_t send_right_moved_robots(int fd);
+		uint32_t send_left_moved_robots(int fd, MessageStats *stats);
+		uint32_t send_right_moved_robots(int fd, MessageStats *stats);
 
-		// Creates and sends a FRAME_FINISHED_WITH_STATS_MESSAGE using the contents of the map
-		void send_frame_stats_message(int fd);
+		// Writes the complete message (length header included) into the buffer instead of sending it. Returns the
+		// message size, or 0 if the message does not fit within the buffer capacity
+		uint32_t write_left_ghost_strip_message(unsigned char* buffer, uint32_t capacity, const RingState &ring_state);
+		uint32_t write_right_ghost_strip_message(unsigned char* buffer, uint32_t capacity, const RingState &ring_state);
+		uint32_t write_left_moved_robots(unsigned char* buffer, uint32_t capacity);
+		uint32_t write_right_moved_robots(unsigned char* buffer, uint32_t capacity);
+
+		// Creates and sends a FRAME_FINISHED_WITH_STATS_MESSAGE using the contents of the map, pooling k x k blocks
+		// (after the given number of frames simulated, the frame having taken compute_us apart from halo waits)
+		void send_frame_stats_message(int fd, uint32_t frame, uint32_t compute_us, uint32_t pool_size,
+				MessageStats *stats);
 
 		// Creates and sends a FINAL_POSITIONS_MESSAGE using the contents of the map
-		void send_final_positions_message(int fd);
+		void send_final_positions_message(int fd, MessageStats *stats);
+
+		// Adds every robot owned by this map (ghost strips excluded) to the collection
+		void get_robots(std::vector<Robot*> &robots);
+
+		// Number of robots owned by this map (ghost strips excluded)
+		uint32_t count_robots();
 
 		void dump_map();
 
@@ -0,0 +1,229 @@
+#include "uring_halo_exchange.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "netutils.h"
+#include "protocol.h"
+
+UringHaloExchange::UringHaloExchange(RobotMap &map, int left_fd, int right_fd, TraceBuffer &trace) {
+	this->map = &map;
+	this->trace = &trace;
+	fds[LEFT] = left_fd;
+	fds[RIGHT] = right_fd;
+
+	for (int side = 0; side < 2; side++) {
+		send_buffers[side] = new unsigned char[BUFFER_SIZE];
+		recv_buffers[side] = new unsigned char[BUFFER_SIZE];
+		send_lengths[side] = 0;
+		bytes_sent[side] = 0;
+		bytes_received[side] = 0;
+		total_bytes_received[side] = 0;
+		last_receive_ns[side] = 0;
+	}
+	timings.send_ns = 0;
+	timings.receive_ns = 0;
+}
+
+UringHaloExchange::~UringHaloExchange() {
+	for (int side = 0; side < 2; side++) {
+		delete[] send_buffers[side];
+		delete[] recv_buffers[side];
+	}
+}
+
+int UringHaloExchange::init() {
+	if (ring.init(RING_ENTRIES) != 0) {
+		return -1;
+	}
+
+	struct iovec buffers[4];
+	for (int side = 0; side < 2; side++) {
+		buffers[side].iov_base = send_buffers[side];
+		buffers[side].iov_len = BUFFER_SIZE;
+		buffers[side + 2].iov_base = recv_buffers[side];
+		buffers[side + 2].iov_len = BUFFER_SIZE;
+	}
+	return ring.register_buffers(buffers, 4);
+}
+
+uint32_t UringHaloExchange::complete_message_length(int side) {
+	if (bytes_received[side] < 4) {
+		return 0;
+	}
+	uint32_t message_length = netutils::get_uint32_from_message(recv_buffers[side]) + 4;
+	if (bytes_received[side] < message_length) {
+		return 0;
+	}
+	return message_length;
+}
+
+void UringHaloExchange::consume_message(int side, uint64_t handle_start_ns) {
+	uint32_t message_length = complete_message_length(side);
+	stats[side].record_received(recv_buffers[side][4], message_length, handle_start_ns - last_receive_ns[side]);
+	bytes_received[side] -= message_length;
+	if (bytes_received[side] > 0) {
+		memmove(recv_buffers[side], recv_buffers[side] + message_length, bytes_received[side]);
+	}
+}
+
+void UringHaloExchange::exchange(unsigned char expected_message_type) {
+
+	// Completions are identified by (side << 1) | is_read
+	uint64_t submit_ns = FrameTimings::get_monotonic_nanoseconds();
+	unsigned pending = 0;
+	for (int side = 0; side < 2; side++) {
+		bytes_sent[side] = 0;
+		ring.queue_write_fixed(fds[side], send_buffers[side], send_lengths[side], side, side << 1);
+		pending++;
+		if (complete_message_length(side) == 0) {
+			ring.queue_read_fixed(fds[side], recv_buffers[side] + bytes_received[side],
+					BUFFER_SIZE - bytes_received[side], side + 2, (side << 1) | 1);
+			pending++;
+		}
+	}
+
+	while (pending > 0) {
+		if (ring.submit_and_wait(1) != 0) {
+			fprintf(stderr, "[Err] Failed to submit io_uring requests\n");
+			exit(EXIT_FAILURE);
+		}
+
+		uint64_t user_data;
+		int32_t result;
+		while (ring.pop_completion(user_data, result)) {
+			pending--;
+			int side = user_data >> 1;
+			bool is_read = user_data & 1;
+
+			if (result <= 0) {
+				if (result == 0 && is_read) {
+					fprintf(stderr, "[Err] %s neighbour closed the connection\n", side == LEFT ? "Left" : "Right");
+				} else {
+					fprintf(stderr, "[Err] io_uring %s failed: %s\n", is_read ? "receive" : "send", strerror(-result));
+				}
+				exit(EXIT_FAILURE);
+			}
+
+			if (is_read) {
+				bytes_received[side] += result;
+				total_bytes_received[side] += result;
+				last_receive_ns[side] = FrameTimings::get_monotonic_nanoseconds();
+				if (complete_message_length(side) == 0) {
+					if (bytes_received[side] == BUFFER_SIZE) {
+						fprintf(stderr, "[Err] io_uring receive buffer size is too small for incoming messages\n");
+						exit(EXIT_FAILURE);
+					}
+					ring.queue_read_fixed(fds[side], recv_buffers[side] + bytes_received[side],
+							BUFFER_SIZE - bytes_received[side], side + 2, user_data);
+					pending++;
+				}
+			} else {
+				bytes_sent[side] += result;
+				if (bytes_sent[side] < send_lengths[side]) {
+					ring.queue_write_fixed(fds[side], send_buffers[side] + bytes_sent[side],
+							send_lengths[side] - bytes_sent[side], side, user_data);
+					pending++;
+				} else {
+					stats[side].record_sent(send_buffers[side][4], send_lengths[side],
+							FrameTimings::get_monotonic_nanoseconds() - submit_ns);
+				}
+			}
+		}
+	}
+
+	for (int side = 0; side < 2; side++) {
+		unsigned char message_type = recv_buffers[side][4];
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received '%s' message from %s neighbour\n",
+				protocol::get_message_type_name(message_type).c_str(), side == LEFT ? "left" : "right");
+#endif
+		if (message_type != expected_message_type) {
+			fprintf(stderr, "[Err] Received '%s' message from %s neighbour when expecting '%s'\n",
+					protocol::get_message_type_name(message_type).c_str(), side == LEFT ? "left" : "right",
+					protocol::get_message_type_name(expected_message_type).c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+RingState UringHaloExchange::exchange_halos(const RingState &ring_state) {
+
+	//(1) Send ghost strips & (2) receive ghost strips
+	uint64_t write_start_ns = FrameTimings::get_monotonic_nanoseconds();
+	send_lengths[LEFT] = map->write_left_ghost_strip_message(send_buffers[LEFT], BUFFER_SIZE, ring_state);
+	send_lengths[RIGHT] = map->write_right_ghost_strip_message(send_buffers[RIGHT], BUFFER_SIZE, ring_state);
+	if (send_lengths[LEFT] == 0 || send_lengths[RIGHT] == 0) {
+		fprintf(stderr, "[Err] io_uring send buffer size is too small for ghost strips\n");
+		exit(EXIT_FAILURE);
+	}
+	uint64_t wait_start_ns = FrameTimings::get_monotonic_nanoseconds();
+	exchange(protocol::GHOST_STRIP_MESSAGE);
+	uint64_t add_start_ns = FrameTimings::get_monotonic_nanoseconds();
+	RingState left_ring_state = RobotMap::get_ring_state(recv_buffers[LEFT] + 4);
+	map->add_left_ghost_strip_message(recv_buffers[LEFT] + 4);
+	map->add_right_ghost_strip_message(recv_buffers[RIGHT] + 4);
+	consume_message(LEFT, add_start_ns);
+	consume_message(RIGHT, add_start_ns);
+	uint64_t end_ns = FrameTimings::get_monotonic_nanoseconds();
+	timings.send_ns = wait_start_ns - write_start_ns;
+	timings.receive_ns = end_ns - add_start_ns;
+	trace->record_span(TraceBuffer::WRITE_HALOS, write_start_ns, wait_start_ns, 0);
+	trace->record_span(TraceBuffer::WAIT_ON_NEIGHBOURS, wait_start_ns, add_start_ns, 0);
+	trace->record_span(TraceBuffer::ADD_HALOS, add_start_ns, end_ns, 0);
+
+	//(3) Send robots (transfers) & (4) receive robots
+	write_start_ns = end_ns;
+	send_lengths[LEFT] = map->write_left_moved_robots(send_buffers[LEFT], BUFFER_SIZE);
+	send_lengths[RIGHT] = map->write_right_moved_robots(send_buffers[RIGHT], BUFFER_SIZE);
+	if (send_lengths[LEFT] == 0 || send_lengths[RIGHT] == 0) {
+		fprintf(stderr, "[Err] io_uring send buffer size is too small for moved robots\n");
+		exit(EXIT_FAILURE);
+	}
+	wait_start_ns = FrameTimings::get_monotonic_nanoseconds();
+	exchange(protocol::ADD_ROBOTS_MESSAGE);
+	add_start_ns = FrameTimings::get_monotonic_nanoseconds();
+	map->add_robots_message(recv_buffers[LEFT] + 4);
+	map->add_robots_message(recv_buffers[RIGHT] + 4);
+	consume_message(LEFT, add_start_ns);
+	consume_message(RIGHT, add_start_ns);
+	end_ns = FrameTimings::get_monotonic_nanoseconds();
+	timings.send_ns += wait_start_ns - write_start_ns;
+	timings.receive_ns += end_ns - add_start_ns;
+	trace->record_span(TraceBuffer::WRITE_HALOS, write_start_ns, wait_start_ns, 1);
+	trace->record_span(TraceBuffer::WAIT_ON_NEIGHBOURS, wait_start_ns, add_start_ns, 1);
+	trace->record_span(TraceBuffer::ADD_HALOS, add_start_ns, end_ns, 1);
+
+	return left_ring_state;
+}
+
+void UringHaloExchange::add_received_bytes(uint32_t connection_type, const std::vector<unsigned char> &bytes) {
+	if (bytes_received[connection_type] + bytes.size() > BUFFER_SIZE) {
+		fprintf(stderr, "[Err] io_uring receive buffer size is too small for incoming messages\n");
+		exit(EXIT_FAILURE);
+	}
+	memcpy(recv_buffers[connection_type] + bytes_received[connection_type], bytes.data(), bytes.size());
+	bytes_received[connection_type] += bytes.size();
+}
+
+void UringHaloExchange::set_fd(uint32_t connection_type, int fd) {
+	if (bytes_received[connection_type] > 0) {
+		fprintf(stderr, "[Err] Received more than the halo exchange from the %s neighbour being replaced\n",
+				connection_type == LEFT ? "left" : "right");
+		exit(EXIT_FAILURE);
+	}
+	fds[connection_type] = fd;
+}
+
+uint64_t UringHaloExchange::get_bytes_received(uint32_t connection_type) {
+	return total_bytes_received[connection_type];
+}
+
+const MessageStats& UringHaloExchange::get_stats(uint32_t connection_type) {
+	return stats[connection_type];
+}
+
+HaloTimings UringHaloExchange::get_timings() {
+	return timings;
+}
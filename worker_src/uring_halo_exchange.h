@@ -0,0 +1,97 @@
+#ifndef URING_HALO_EXCHANGE_H_
+#define URING_HALO_EXCHANGE_H_
+
+#include <inttypes.h>
+#include <vector>
+
+#include "uring.h"
+#include "robot_map.h"
+#include "frame_timings.h"
+#include "trace_buffer.h"
+#include "message_stats.h"
+
+/**
+ * io_uring backend for the per frame halo exchange. Runs on the worker thread in place of the two peer connection
+ * threads: the sends and receives for both neighbours are submitted as one batch per exchange (ghost strips, then moved
+ * robots), using pre-registered send & receive buffers. The wire protocol is unchanged, so neighbours may use either
+ * backend
+ *
+ */
+class UringHaloExchange {
+
+	private:
+		//Size of each send & receive buffer (matching the ConnectionHandler receive buffer)
+		static const uint32_t BUFFER_SIZE = 12582912;
+
+		static const unsigned RING_ENTRIES = 8;
+
+		//Indexes into the per neighbour arrays below (same as the PeerConnection connection types)
+		static const int LEFT = 0;
+		static const int RIGHT = 1;
+
+		RobotMap *map;
+		Uring ring;
+
+		//The worker thread's trace events (tracing runs)
+		TraceBuffer *trace;
+		int fds[2];
+
+		//Registered buffers: send buffers use indexes 0 & 1, receive buffers 2 & 3
+		unsigned char *send_buffers[2];
+		unsigned char *recv_buffers[2];
+
+		uint32_t send_lengths[2];
+		uint32_t bytes_sent[2];
+		uint32_t bytes_received[2];
+
+		//Total bytes received from each neighbour
+		uint64_t total_bytes_received[2];
+
+		//Messages exchanged with each neighbour (a send lasts until its completion is reaped, which may wait on the
+		//receives), and when the last read from each completed
+		MessageStats stats[2];
+		uint64_t last_receive_ns[2];
+
+		//Time spent preparing & adding messages during the last exchange
+		HaloTimings timings;
+
+		//Returns the length of the first buffered message (header included) if it has been fully received, else 0
+		uint32_t complete_message_length(int side);
+
+		//Removes the first buffered message (handled from the given time), keeping any bytes of the next one
+		void consume_message(int side, uint64_t handle_start_ns);
+
+		//Sends the prepared message to each neighbour while receiving the expected message from each
+		void exchange(unsigned char expected_message_type);
+
+	public:
+		UringHaloExchange(RobotMap &map, int left_fd, int right_fd, TraceBuffer &trace);
+		~UringHaloExchange();
+
+		//Sets up the ring & registers buffers. Returns 0: success, -1: io_uring unavailable
+		int init();
+
+		//Exchanges ghost strips and then moved robots with both neighbours for the current frame. Ghost strips carry
+		//the ring state, returns the left neighbour's ring state
+		RingState exchange_halos(const RingState &ring_state);
+
+		//Starts from what a peer connection thread read off the socket before the exchange took it over (by PeerConnection
+		//connection type)
+		void add_received_bytes(uint32_t connection_type, const std::vector<unsigned char> &bytes);
+
+		//Exchanges with a new neighbour over the socket from the next exchange on (by PeerConnection connection type),
+		//once everything received from the previous one has been handled. The previous socket is left to the caller
+		void set_fd(uint32_t connection_type, int fd);
+
+		//Total bytes received from a neighbour (by PeerConnection connection type)
+		uint64_t get_bytes_received(uint32_t connection_type);
+
+		//Messages exchanged with a neighbour (by PeerConnection connection type)
+		const MessageStats& get_stats(uint32_t connection_type);
+
+		//Time spent writing the messages sent & adding those received during the last exchange (the rest was spent
+		//waiting on the sends & receives)
+		HaloTimings get_timings();
+};
+
+#endif /* URING_HALO_EXCHANGE_H_ */
@@ -2,6 +2,8 @@
 #include <sys/socket.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
 #include <cstdlib>
 #include <cstring>
 #include <cstdio>
@@ -10,8 +12,13 @@
 #include "netutils.h"
 #include "protocol.h"
 #include "robot.h"
+#include "population_file.h"
+#include "profiling.h"
 
-Worker::Worker(std::string& master_location) {
+volatile sig_atomic_t Worker::leave_signalled = 0;
+
+Worker::Worker(std::string& master_location) :
+		peer_barrier(2) {
 
 	//Load up address structs with getaddrinfo
 	struct addrinfo hints, *res;
@@ -70,40 +77,60 @@ Worker::Worker(std::string& master_location) {
 	block_size = 0;
 	id = 0;
 	num_workers = 0;
+	first_column = 0;
+	num_columns = 0;
 	listening = false;
+	listen_fd = -1;
+	listen_port = 0;
 	left_neighbour = NULL;
 	right_neighbour = NULL;
-	num_peer_connections_working = 2;
-	peer_connections_working[0] = true;
-	peer_connections_working[1] = true;
+	peer_connection_arrivals[0] = 0;
+	peer_connection_arrivals[1] = 0;
 	map = NULL;
+	halo_exchange = NULL;
 	visualization_enabled = false;
+	stats_pool_size = 1;
+	stats_interval = 1;
+	frame_aggregation_enabled = false;
+	completed_frames_from_left = 0;
+	completed_frames_to_right = 0;
+	progress_frames = 0;
+	progress_ms = 0;
+	perf_counters_interval = 0;
+	checkpoint_interval = 0;
+	committed_checkpoint_frame = 0;
+	elastic_enabled = false;
+	reconfigure_frame = 0;
+	reconfigure_frame_from_left = 0;
+	leave_requested = false;
+	relinked_bytes_received[0] = 0;
+	relinked_bytes_received[1] = 0;
+	clock_offset_ns = 0;
 
 	if (pthread_mutex_init(&listening_mutex, NULL) != 0 || pthread_mutex_init(&left_neighbour_mutex, NULL) != 0
-			|| pthread_mutex_init(&right_neighbour_mutex, NULL) != 0
-			|| pthread_mutex_init(&synchronization, NULL) != 0) {
+			|| pthread_mutex_init(&right_neighbour_mutex, NULL) != 0) {
 		fprintf(stderr, "[Err] Failed to initialize mutexes\n");
 		exit(EXIT_FAILURE);
 	}
-	if (pthread_cond_init(&listening_for_neighbour, NULL) != 0 || pthread_cond_init(&worker_done, NULL) != 0
-			|| pthread_cond_init(&both_peer_connections_done, NULL) != 0) {
+	if (pthread_cond_init(&listening_for_neighbour, NULL) != 0) {
 		fprintf(stderr, "[Err] Failed to initialize condition\n");
 		exit(EXIT_FAILURE);
 	}
-
-	//Get synchonization lock
-	pthread_mutex_lock(&synchronization);
 }
 
 void Worker::send_message_to_master(std::vector<unsigned char> &message) {
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending '%s' message to master\n", protocol::get_message_type_name(message.at(0)).c_str());
 #endif
-	protocol::send_message(master_fd, message);
+	protocol::send_message(master_fd, message, &master_stats);
 }
 
 void Worker::recieve_message_from_master(std::vector<unsigned char> &message, unsigned char expected_message_type) {
-	protocol::recieve_message(master_fd, message);
+	protocol::recieve_message(master_fd, message, &master_stats);
+	verify_message_from_master(message, expected_message_type);
+}
+
+void Worker::verify_message_from_master(std::vector<unsigned char> &message, unsigned char expected_message_type) {
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Received '%s' message from master\n", protocol::get_message_type_name(message.at(0)).c_str());
 #endif
@@ -117,6 +144,440 @@ void Worker::recieve_message_from_master(std::vector<unsigned char> &message, un
 	}
 }
 
+int32_t Worker::get_slice_start() {
+	return first_column * block_size;
+}
+
+int32_t Worker::get_slice_end() {
+	return (first_column + num_columns) * block_size;
+}
+
+bool Worker::is_within_slice(int32_t x_position) {
+	if (x_position < get_slice_start()) {
+		return false;
+	}
+	return x_position < get_slice_end() || first_column + num_columns == num_blocks;
+}
+
+void Worker::generate_robots(uint32_t population_size, uint32_t seed) {
+	//Every worker draws every robot's position, which is cheap compared to sending it
+	for (uint32_t robot_id = 1; robot_id <= population_size; robot_id++) {
+		Robot robot = Robot::generate(robot_id, seed);
+		if (is_within_slice(robot.get_x_position())) {
+			map->add_robot(*new Robot(robot));
+		}
+	}
+}
+
+void Worker::load_robots(const char *path) {
+	PopulationFile population_file;
+	if (population_file.open(path) != 0) {
+		exit(EXIT_FAILURE);
+	}
+
+	//Only our columns of the file are read
+	uint32_t num_records;
+	unsigned char *records = population_file.get_records_overlapping(get_slice_start(), get_slice_end(), num_records);
+	for (uint32_t i = 0; i < num_records; i++) {
+		unsigned char *record = records + ((uint64_t) i * Robot::LONG_SERIALIZED_LENGTH);
+		if (is_within_slice(Robot::get_x_position_from_serialized(record))) {
+			map->add_robot(*new Robot(record, Robot::LONG_SERIALIZED_VERSION));
+		}
+	}
+}
+
+void Worker::checkpoint(uint32_t frame) {
+	char file_name[48];
+	snprintf(file_name, sizeof file_name, protocol::CHECKPOINT_FILE_FORMAT, frame, id);
+
+	std::vector<Robot*> robots;
+	map->get_robots(robots);
+	PopulationFile::serialize(Robot::get_world_size(), num_blocks, frame, robots, checkpoint_snapshot);
+	checkpoint_writer.write(checkpoint_dir + "/" + file_name, frame, robots.size(), checkpoint_snapshot);
+	checkpoint_shards.push_back(std::make_pair(frame, id));
+}
+
+void Worker::report_checkpoint_written() {
+	uint32_t frame, num_robots;
+	if (!checkpoint_writer.take_completed(frame, num_robots)) {
+		return;
+	}
+	std::vector<unsigned char> message(9);
+	message.at(0) = protocol::CHECKPOINT_WRITTEN_MESSAGE;
+	netutils::insert_uint32_into_message(frame, &message[1]);
+	netutils::insert_uint32_into_message(num_robots, &message[5]);
+	send_message_to_master(message);
+}
+
+void Worker::poll_master_messages() {
+	unsigned char byte;
+	while (recv(master_fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 1) {
+		std::vector<unsigned char> message;
+		protocol::recieve_message(master_fd, message, &master_stats);
+		handle_master_message(message);
+	}
+}
+
+void Worker::handle_master_message(std::vector<unsigned char> &message) {
+#ifdef NET_DEBUG
+	printf("[NET_DEBUG] Received '%s' message from master\n", protocol::get_message_type_name(message.at(0)).c_str());
+#endif
+
+	if (message.at(0) == protocol::RECONFIGURE_MESSAGE && elastic_enabled && reconfiguration.empty()) {
+		reconfiguration = message;
+
+		//Far enough ahead for the last worker to have learnt of it (one hop along the ring per frame)
+		if (id == 1 && reconfigure_frame == 0) {
+			reconfigure_frame = update_count + num_workers;
+		}
+	} else if (message.at(0) == protocol::CHECKPOINT_COMMITTED_MESSAGE && message.size() >= 9
+			&& message.size() == 9 + netutils::get_uint32_from_message(&message[5]) * 8) {
+		committed_checkpoint_frame = netutils::get_uint32_from_message(&message[1]);
+		uint32_t num_orphaned = netutils::get_uint32_from_message(&message[5]);
+
+		//Our checkpoints before the committed one & the shards left behind by workers that have left
+		std::vector<std::string> paths;
+		char file_name[48];
+		while (!checkpoint_shards.empty() && checkpoint_shards.front().first < committed_checkpoint_frame) {
+			snprintf(file_name, sizeof file_name, protocol::CHECKPOINT_FILE_FORMAT, checkpoint_shards.front().first,
+					checkpoint_shards.front().second);
+			paths.push_back(checkpoint_dir + "/" + file_name);
+			checkpoint_shards.erase(checkpoint_shards.begin());
+		}
+		for (uint32_t i = 0; i < num_orphaned; i++) {
+			snprintf(file_name, sizeof file_name, protocol::CHECKPOINT_FILE_FORMAT,
+					netutils::get_uint32_from_message(&message[9 + (i * 8)]),
+					netutils::get_uint32_from_message(&message[13 + (i * 8)]));
+			paths.push_back(checkpoint_dir + "/" + file_name);
+		}
+		checkpoint_writer.remove(paths);
+	} else {
+		fprintf(stderr, "[Err] Received unexpected '%s' message from master\n",
+				protocol::get_message_type_name(message.at(0)).c_str());
+		close(master_fd);
+		exit(EXIT_FAILURE);
+	}
+}
+
+void Worker::wait_for_checkpoint_committed() {
+	while (!checkpoint_shards.empty() && committed_checkpoint_frame < checkpoint_shards.back().first) {
+		std::vector<unsigned char> message;
+		protocol::recieve_message(master_fd, message, &master_stats);
+		handle_master_message(message);
+	}
+	checkpoint_writer.wait_until_done();
+}
+
+bool Worker::reconfigure() {
+	uint32_t frame = reconfigure_frame;
+	while (reconfiguration.empty()) {
+		std::vector<unsigned char> message;
+		protocol::recieve_message(master_fd, message, &master_stats);
+		handle_master_message(message);
+	}
+
+	//Checkpoints up to the frame are reported under our previous id
+	if (checkpoint_interval > 0) {
+		checkpoint_writer.wait_until_done();
+		report_checkpoint_written();
+	}
+
+	uint32_t new_id = netutils::get_uint32_from_message(&reconfiguration[1]);
+	uint32_t new_num_workers = netutils::get_uint32_from_message(&reconfiguration[5]);
+	uint32_t new_first_column = netutils::get_uint32_from_message(&reconfiguration[9]);
+	uint32_t new_num_columns = netutils::get_uint32_from_message(&reconfiguration[13]);
+	bool accept_left = netutils::get_uint32_from_message(&reconfiguration[17]) == 1;
+	bool accept_columns = netutils::get_uint32_from_message(&reconfiguration[21]) == 1;
+	uint32_t ip_addr_len = netutils::get_uint32_from_message(&reconfiguration[25]);
+	char *ip_address = NULL;
+	uint32_t port = 0;
+	if (ip_addr_len > 0) {
+		ip_address = new char[ip_addr_len];
+		memcpy(ip_address, &reconfiguration[29], ip_addr_len);
+		port = netutils::get_uint32_from_message(&reconfiguration[29 + ip_addr_len]);
+	}
+
+	std::vector<unsigned char> message(5);
+	message.at(0) = protocol::RECONFIGURED_MESSAGE;
+	netutils::insert_uint32_into_message(frame, &message[1]);
+
+	//Leaving: our columns go to the neighbour next to them, our listen port is free for whoever joins next
+	if (new_id == 0) {
+		int fd = connect_to_worker(ip_address, port);
+		send_columns(fd, first_column);
+		close(fd);
+		delete[] ip_address;
+		close(listen_fd);
+		listen_fd = -1;
+		if (checkpoint_interval > 0) {
+			wait_for_checkpoint_committed();
+		}
+		send_message_to_master(message);
+		printf("Handed block columns %u-%u over after frame %u\n", first_column, first_column + num_columns - 1, frame);
+		return false;
+	}
+
+	//Neighbours connect to us first, while the neighbour we connect to (if any) may wait on its own
+	if (accept_left || accept_columns) {
+		accept_peers(accept_left, accept_columns, new_id == 1 ? new_num_workers : new_id - 1);
+	}
+	if (ip_address != NULL) {
+		int fd = connect_to_worker(ip_address, port);
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Sending 'NEIGHBOUR_REQUEST' message to '%s'\n", ip_address);
+#endif
+		std::vector<unsigned char> request_msg = { protocol::NEIGHBOUR_REQUEST_MESSAGE };
+		protocol::send_message(fd, request_msg, NULL);
+		std::vector<unsigned char> ack_msg;
+		protocol::recieve_message(fd, ack_msg, NULL);
+		if (ack_msg.at(0) != protocol::NEIGHBOUR_REQUEST_ACK_MESSAGE) {
+			fprintf(stderr, "[Err] Received '%s' message from new right neighbour '%s' when expecting '%s'\n",
+					protocol::get_message_type_name(ack_msg.at(0)).c_str(), ip_address,
+					protocol::get_message_type_name(protocol::NEIGHBOUR_REQUEST_ACK_MESSAGE).c_str());
+			exit(EXIT_FAILURE);
+		}
+
+		//A joining neighbour takes the columns right of our new slice
+		if (new_first_column + new_num_columns < first_column + num_columns) {
+			send_columns(fd, new_first_column + new_num_columns);
+		}
+		replace_neighbour(PeerConnection::RIGHT_PEER_CONNECTION, fd, ip_address,
+				new_id == new_num_workers ? 1 : new_id + 1);
+	}
+	if (first_column != new_first_column || num_columns != new_num_columns) {
+		fprintf(stderr, "[Err] Reconfigured to block columns %u-%u, expected %u-%u\n", first_column,
+				first_column + num_columns - 1, new_first_column, new_first_column + new_num_columns - 1);
+		exit(EXIT_FAILURE);
+	}
+
+	id = new_id;
+	num_workers = new_num_workers;
+	reconfigure_frame = 0;
+	reconfigure_frame_from_left = 0;
+	reconfiguration.clear();
+	send_message_to_master(message);
+	printf("Reconfigured after frame %u as worker %u of %u (block columns %u-%u)\n", frame, id, num_workers,
+			first_column, first_column + num_columns - 1);
+	return true;
+}
+
+void Worker::accept_peers(bool accept_left, bool accept_columns, uint32_t left_neighbour_id) {
+	struct sockaddr_storage new_addr;
+	socklen_t addr_len;
+	while (accept_left || accept_columns) {
+		addr_len = sizeof(new_addr);
+		int new_fd = accept(listen_fd, (sockaddr *) &new_addr, &addr_len);
+		if (new_fd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fprintf(stderr, "[Err] Failed to accept a neighbour's connection\n");
+			exit(EXIT_FAILURE);
+		}
+
+		std::vector<unsigned char> message;
+		protocol::recieve_message(new_fd, message, NULL);
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received '%s' message on our listen port\n",
+				protocol::get_message_type_name(message.at(0)).c_str());
+#endif
+		if (message.at(0) == protocol::NEIGHBOUR_REQUEST_MESSAGE && accept_left) {
+			if (netutils::disable_nagle_algorithm(new_fd) != 0) {
+				fprintf(stderr, "[Err] Failed to set TCP_NODELAY flag on socket\n");
+				exit(EXIT_FAILURE);
+			}
+			if (netutils::set_bdp(new_fd) != 0) {
+				fprintf(stderr, "[Err] Failed to set BDP size on socket\n");
+				exit(EXIT_FAILURE);
+			}
+			std::vector<unsigned char> ack_msg = { protocol::NEIGHBOUR_REQUEST_ACK_MESSAGE };
+			protocol::send_message(new_fd, ack_msg, NULL);
+
+			char* ip_address = new char[netutils::IP_ADDRESS_LENGTH];
+			netutils::get_ip_textual(&new_addr, ip_address);
+			replace_neighbour(PeerConnection::LEFT_PEER_CONNECTION, new_fd, ip_address, left_neighbour_id);
+			accept_left = false;
+		} else if (message.at(0) == protocol::COLUMN_TRANSFER_MESSAGE && accept_columns) {
+			uint32_t frame = netutils::get_uint32_from_message(&message[1]);
+			if (frame != (uint32_t) update_count + 1) {
+				fprintf(stderr, "[Err] Received block columns after frame %u, expected frame %u\n", frame,
+						update_count + 1);
+				exit(EXIT_FAILURE);
+			}
+			take_columns(message);
+			close(new_fd);
+			accept_columns = false;
+		} else {
+			fprintf(stderr, "[Err] Received unexpected '%s' message on our listen port while reconfiguring\n",
+					protocol::get_message_type_name(message.at(0)).c_str());
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+void Worker::send_columns(int fd, uint32_t first_transferred_column) {
+	//Leaving workers hand over all of their robots, the rest drop the columns handed over
+	std::vector<Robot*> robots;
+	uint32_t last_column = first_column + num_columns - 1;
+	if (first_transferred_column == first_column) {
+		map->get_robots(robots);
+	} else {
+		map->set_bounds(first_column, first_transferred_column - 1, robots);
+		num_columns = first_transferred_column - first_column;
+	}
+
+	std::vector<unsigned char> message(17 + (robots.size() * Robot::LONG_SERIALIZED_LENGTH));
+	message.at(0) = protocol::COLUMN_TRANSFER_MESSAGE;
+	netutils::insert_uint32_into_message(update_count + 1, &message[1]);
+	netutils::insert_uint32_into_message(first_transferred_column, &message[5]);
+	netutils::insert_uint32_into_message(last_column - first_transferred_column + 1, &message[9]);
+	netutils::insert_uint32_into_message(robots.size(), &message[13]);
+	for (unsigned int i = 0; i < robots.size(); i++) {
+		robots.at(i)->serialize_long(&message[17 + (i * Robot::LONG_SERIALIZED_LENGTH)]);
+	}
+#ifdef NET_DEBUG
+	printf("[NET_DEBUG] Sending 'COLUMN_TRANSFER_MESSAGE' of block columns %u-%u (%lu robots)\n",
+			first_transferred_column, last_column, robots.size());
+#endif
+	protocol::send_message(fd, message, NULL);
+
+	if (first_transferred_column != first_column) {
+		for (unsigned int i = 0; i < robots.size(); i++) {
+			delete robots.at(i);
+		}
+	}
+}
+
+void Worker::take_columns(std::vector<unsigned char> &message) {
+	uint32_t transferred_first_column = netutils::get_uint32_from_message(&message[5]);
+	uint32_t transferred_num_columns = netutils::get_uint32_from_message(&message[9]);
+	uint32_t num_robots = netutils::get_uint32_from_message(&message[13]);
+
+	//The columns extend our slice on either side (or are the slice we were given to join the ring with)
+	uint32_t new_first_column = first_column;
+	if (transferred_first_column == first_column + num_columns) {
+		num_columns += transferred_num_columns;
+	} else if (transferred_first_column + transferred_num_columns == first_column) {
+		new_first_column = transferred_first_column;
+		num_columns += transferred_num_columns;
+	} else if (transferred_first_column != first_column || transferred_num_columns != num_columns) {
+		fprintf(stderr, "[Err] Received block columns %u-%u, which are not next to ours (%u-%u)\n",
+				transferred_first_column, transferred_first_column + transferred_num_columns - 1, first_column,
+				first_column + num_columns - 1);
+		exit(EXIT_FAILURE);
+	}
+	if (new_first_column != first_column || transferred_first_column != first_column) {
+		first_column = new_first_column;
+		std::vector<Robot*> removed_robots;
+		map->set_bounds(first_column, first_column + num_columns - 1, removed_robots);
+	}
+
+	for (uint32_t i = 0; i < num_robots; i++) {
+		map->add_robot(*new Robot(&message[17 + (i * Robot::LONG_SERIALIZED_LENGTH)], Robot::LONG_SERIALIZED_VERSION));
+	}
+}
+
+void Worker::replace_neighbour(uint32_t connection_type, int fd, char* ip_address, uint32_t neighbour_id) {
+	bool left = connection_type == PeerConnection::LEFT_PEER_CONNECTION;
+	PeerConnection *previous = left ? left_neighbour : right_neighbour;
+	relinked_stats[connection_type].add(previous->get_stats());
+	relinked_bytes_received[connection_type] += previous->get_bytes_received();
+	previous->retire();
+
+	PeerConnection *pc = new PeerConnection(fd, *this, ip_address, neighbour_id, protocol::GHOST_STRIP_MESSAGE);
+	pc->relink(connection_type);
+	if (trace.is_enabled()) {
+		pc->get_trace().enable();
+	}
+	profiling::lock(left ? &left_neighbour_mutex : &right_neighbour_mutex,
+			left ? profiling::LEFT_NEIGHBOUR_LOCK : profiling::RIGHT_NEIGHBOUR_LOCK);
+	if (left) {
+		left_neighbour = pc;
+	} else {
+		right_neighbour = pc;
+	}
+	pthread_mutex_unlock(left ? &left_neighbour_mutex : &right_neighbour_mutex);
+
+	//io_uring exchanges over the new socket from the next frame (the parked peer connection threads never wake up
+	//again), otherwise the new connection's thread takes over from the previous one's
+	if (halo_exchange != NULL) {
+		halo_exchange->set_fd(connection_type, fd);
+		close(previous->get_fd());
+		return;
+	}
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, &handle_peer_connection, (void*) pc) != 0) {
+		fprintf(stderr, "[Err] Failed to create thread to handle peer connection\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void Worker::synchronize_clock() {
+	std::vector<unsigned char> request = { protocol::CLOCK_SYNC_MESSAGE };
+	std::vector<unsigned char> reply;
+	uint64_t best_round_trip_ns = UINT64_MAX;
+	for (uint32_t i = 0; i < CLOCK_SYNC_SAMPLES; i++) {
+		uint64_t sent_ns = FrameTimings::get_monotonic_nanoseconds();
+		send_message_to_master(request);
+		recieve_message_from_master(reply, protocol::CLOCK_SYNC_MESSAGE);
+		uint64_t received_ns = FrameTimings::get_monotonic_nanoseconds();
+
+		//Master stamped its reply half way through the shortest round trip
+		uint64_t round_trip_ns = received_ns - sent_ns;
+		if (round_trip_ns < best_round_trip_ns) {
+			uint64_t master_ns = ((uint64_t) netutils::get_uint32_from_message(&reply[1]) << 32)
+					| netutils::get_uint32_from_message(&reply[5]);
+			clock_offset_ns = (int64_t) master_ns - (int64_t) (sent_ns + round_trip_ns / 2);
+			best_round_trip_ns = round_trip_ns;
+		}
+	}
+	printf("Tracing, clock offset from master %.3f ms (+/- %.3f ms)\n", clock_offset_ns / 1e6,
+			best_round_trip_ns / 2e6);
+}
+
+void Worker::send_trace() {
+	TraceBuffer *traces[3] = { &trace, &left_neighbour->get_trace(), &right_neighbour->get_trace() };
+	std::vector<TraceBuffer::Record> records[3];
+	size_t length = 5;
+	for (int thread = 0; thread < 3; thread++) {
+		traces[thread]->get_records(records[thread]);
+		length += 8 + records[thread].size() * TraceBuffer::SERIALIZED_RECORD_LENGTH;
+	}
+
+	std::vector<unsigned char> message(length);
+	message.at(0) = protocol::TRACE_MESSAGE;
+	netutils::insert_uint32_into_message(3, &message[1]);
+	size_t offset = 5;
+	for (int thread = 0; thread < 3; thread++) {
+		netutils::insert_uint32_into_message(thread, &message[offset]);
+		netutils::insert_uint32_into_message(records[thread].size(), &message[offset + 4]);
+		offset += 8;
+		offset += TraceBuffer::serialize(records[thread], clock_offset_ns, &message[offset]);
+	}
+	send_message_to_master(message);
+}
+
+void Worker::handle_leave_signal(int signum) {
+	leave_signalled = 1;
+}
+
+void Worker::write_positions_shard() {
+	char file_name[32];
+	snprintf(file_name, sizeof file_name, protocol::SHARD_FILE_FORMAT, id);
+	std::string path = positions_output_dir + "/" + file_name;
+
+	std::vector<Robot*> robots;
+	map->get_robots(robots);
+	if (PopulationFile::write(path.c_str(), Robot::get_world_size(), num_blocks, update_count, robots) != 0) {
+		exit(EXIT_FAILURE);
+	}
+
+	std::vector<unsigned char> message(5);
+	message.at(0) = protocol::POSITIONS_WRITTEN_MESSAGE;
+	netutils::insert_uint32_into_message(robots.size(), &message[1]);
+	send_message_to_master(message);
+}
+
 void Worker::join() {
 
 	//Send JOIN message to master
@@ -127,8 +588,13 @@ void Worker::join() {
 	recieve_message_from_master(message, protocol::JOIN_ACK_MESSAGE);
 	id = netutils::get_uint32_from_message(&message[1]);
 	num_workers = netutils::get_uint32_from_message(&message[5]);
+	listen_port = netutils::get_uint32_from_message(&message[9]);
+	first_column = netutils::get_uint32_from_message(&message[13]);
+	num_columns = netutils::get_uint32_from_message(&message[17]);
+	bool joining_running_ring = netutils::get_uint32_from_message(&message[21]) == 1;
 
-	printf("Connected to master as worker %d of %d\n", id, num_workers);
+	printf("Connected to master as worker %d of %d%s\n", id, num_workers,
+			joining_running_ring ? ", joining the running simulation" : "");
 
 	//Set up listening socket for left neighbour
 	pthread_t thread;
@@ -138,7 +604,7 @@ void Worker::join() {
 	}
 
 	//Wait until we are listening for our left neighbour
-	pthread_mutex_lock(&listening_mutex);
+	profiling::lock(&listening_mutex, profiling::LISTENING_LOCK);
 	while (!listening) {
 		pthread_cond_wait(&listening_for_neighbour, &listening_mutex);
 	}
@@ -153,13 +619,14 @@ void Worker::join() {
 	uint32_t ip_addr_len = netutils::get_uint32_from_message(&message[1]);
 	char *right_neighbour_ip = new char[ip_addr_len];
 	memcpy(right_neighbour_ip, &message[5], ip_addr_len);
+	uint32_t right_neighbour_port = netutils::get_uint32_from_message(&message[5 + ip_addr_len]);
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Our right neighbour can be found at '%s'\n", right_neighbour_ip);
 #endif
-	connect_to_neighbour(right_neighbour_ip);
+	connect_to_neighbour(right_neighbour_ip, right_neighbour_port);
 
 	//Allow peer connections to start and wait until they are set
-	start_wait_peer_connections();
+	wait_on_peer_connections();
 
 	printf("Peer worker connections established\n");
 
@@ -176,23 +643,114 @@ void Worker::join() {
 	visualization_enabled = netutils::get_uint32_from_message(&message[17]) == 1 ? true : false;
 	Robot::set_fov(netutils::get_uint32_from_message(&message[21]));
 	Robot::invert_direction = netutils::get_uint32_from_message(&message[25]) == 1 ? true : false;
+	bool io_uring_enabled = netutils::get_uint32_from_message(&message[29]) == 1 ? true : false;
+	frame_aggregation_enabled = netutils::get_uint32_from_message(&message[33]) == 1 ? true : false;
+	progress_frames = netutils::get_uint32_from_message(&message[37]);
+	progress_ms = netutils::get_uint32_from_message(&message[41]);
+	stats_pool_size = netutils::get_uint32_from_message(&message[45]);
+	stats_interval = netutils::get_uint32_from_message(&message[49]);
+	elastic_enabled = netutils::get_uint32_from_message(&message[57]) == 1 ? true : false;
+	bool tracing_enabled = netutils::get_uint32_from_message(&message[61]) == 1 ? true : false;
+	perf_counters_interval = netutils::get_uint32_from_message(&message[65]);
+
+	//Restarts carry on from the checkpointed frame
+	update_count = netutils::get_uint32_from_message(&message[53]);
+	completed_frames_from_left = update_count;
 	block_size = Robot::get_world_size() / num_blocks;
+	map = new RobotMap(num_blocks, first_column, first_column + num_columns - 1);
 
-	uint32_t blocks_per_slice = num_blocks / num_workers;
-	uint32_t leftmost_x_index = blocks_per_slice * (id - 1);
-	uint32_t rightmost_x_index = (blocks_per_slice * id) - 1;
-	map = new RobotMap(num_blocks, leftmost_x_index, rightmost_x_index);
+	//Only elastic runs take on neighbours later on
+	if (!elastic_enabled) {
+		close(listen_fd);
+		listen_fd = -1;
+	}
+
+	//Take over the halo exchange from the peer connection threads if io_uring is available
+	if (io_uring_enabled) {
+		halo_exchange = new UringHaloExchange(*map, left_neighbour->get_fd(), right_neighbour->get_fd(), trace);
+		if (halo_exchange->init() == 0) {
+			printf("Using io_uring for the halo exchange\n");
+
+			//A running neighbour may follow its handshake straight on with the next frame's ghost strip
+			std::vector<unsigned char> bytes;
+			left_neighbour->take_unhandled_bytes(bytes);
+			halo_exchange->add_received_bytes(PeerConnection::LEFT_PEER_CONNECTION, bytes);
+			right_neighbour->take_unhandled_bytes(bytes);
+			halo_exchange->add_received_bytes(PeerConnection::RIGHT_PEER_CONNECTION, bytes);
+		} else {
+			printf("io_uring is unavailable, falling back to sockets for the halo exchange\n");
+			delete halo_exchange;
+			halo_exchange = NULL;
+		}
+	}
+
+	//Counters are per thread, opened from the thread running the simulation loop
+	if (perf_counters_interval > 0) {
+		if (perf_counters.open() == 0) {
+			printf("Sampling hardware performance counters:");
+			for (int counter = 0; counter < PerfCounters::NUM_COUNTERS; counter++) {
+				printf(" %s%s", PerfCounters::get_counter_name((PerfCounters::Counter) counter),
+						perf_counters.is_available((PerfCounters::Counter) counter) ? "" : " (unavailable)");
+			}
+			printf("\n");
+		} else {
+			printf("Hardware performance counters are unavailable, not sampling them\n");
+			perf_counters_interval = 0;
+		}
+	}
+
+	//The peer connection threads are waiting on us, so their traces can be enabled from here
+	if (tracing_enabled) {
+		trace.enable();
+		left_neighbour->get_trace().enable();
+		right_neighbour->get_trace().enable();
+		synchronize_clock();
+	}
 
 	//Notify master that parameters are set
 	message = {protocol::UNIVERSE_PARAMETERS_SET_MESSAGE};
 	send_message_to_master(message);
 
-	//Receive our robots
-	recieve_message_from_master(message, protocol::SET_ROBOTS_MESSAGE);
-	uint32_t num_robots = netutils::get_uint32_from_message(&message[1]);
-	for (unsigned int i = 0; i < num_robots; i++) {
-		Robot *robot = new Robot(&message[5 + (i * Robot::LONG_SERIALIZED_LENGTH)], Robot::LONG_SERIALIZED_VERSION);
-		map->add_robot(*robot);
+	//Receive our robots, or the seed to generate them from. Joining the running simulation, our left neighbour hands
+	//us our columns as of the frame it has reached instead (before the peer connection threads take over the socket)
+	if (joining_running_ring) {
+		protocol::recieve_message(left_neighbour->get_fd(), message, NULL);
+	} else {
+		protocol::recieve_message(master_fd, message, &master_stats);
+	}
+	if (message.at(0) == protocol::COLUMN_TRANSFER_MESSAGE && joining_running_ring) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'COLUMN_TRANSFER_MESSAGE' message from left neighbour\n");
+#endif
+		update_count = netutils::get_uint32_from_message(&message[1]);
+		completed_frames_from_left = update_count;
+		take_columns(message);
+	} else if (message.at(0) == protocol::GENERATE_ROBOTS_MESSAGE) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'GENERATE_ROBOTS_MESSAGE' message from master\n");
+#endif
+		generate_robots(netutils::get_uint32_from_message(&message[1]), netutils::get_uint32_from_message(&message[5]));
+	} else if (message.at(0) == protocol::LOAD_ROBOTS_MESSAGE) {
+#ifdef NET_DEBUG
+		printf("[NET_DEBUG] Received 'LOAD_ROBOTS_MESSAGE' message from master\n");
+#endif
+		std::string path((char *) &message[5], netutils::get_uint32_from_message(&message[1]));
+		load_robots(path.c_str());
+	} else {
+		//Add each chunk of robots as it arrives
+		verify_message_from_master(message, protocol::SET_ROBOTS_MESSAGE);
+		while (true) {
+			uint32_t num_robots = netutils::get_uint32_from_message(&message[1]);
+			for (unsigned int i = 0; i < num_robots; i++) {
+				Robot *robot = new Robot(&message[9 + (i * Robot::LONG_SERIALIZED_LENGTH)],
+						Robot::LONG_SERIALIZED_VERSION);
+				map->add_robot(*robot);
+			}
+			if (netutils::get_uint32_from_message(&message[5]) == 1) {
+				break;
+			}
+			recieve_message_from_master(message, protocol::SET_ROBOTS_MESSAGE);
+		}
 	}
 
 	printf("Created and populated data structures\n");
@@ -204,56 +762,261 @@ void Worker::join() {
 	//Wait for master to tell us to start the simulation
 	printf("Waiting for master to initiate simulation...\n");
 	recieve_message_from_master(message, protocol::START_SIMULATION_MESSAGE);
+	uint32_t path_length = netutils::get_uint32_from_message(&message[1]);
+	positions_output_dir.assign((char *) &message[5], path_length);
+	checkpoint_interval = netutils::get_uint32_from_message(&message[5 + path_length]);
+	checkpoint_dir.assign((char *) &message[13 + path_length],
+			netutils::get_uint32_from_message(&message[9 + path_length]));
+	if (checkpoint_interval > 0) {
+		checkpoint_writer.start();
+	}
+	if (elastic_enabled) {
+		signal(SIGTERM, &handle_leave_signal);
+	}
 	printf("Running\n");
 	simulation_loop();
 }
 
 void Worker::simulation_loop() {
 
-	unsigned char frame_finished_messaged[5];
-	netutils::insert_uint32_into_message(1, frame_finished_messaged);
+	unsigned char frame_finished_messaged[9];
+	netutils::insert_uint32_into_message(5, frame_finished_messaged);
 	frame_finished_messaged[4] = protocol::FRAME_FINISHED_MESSAGE;
 
+	unsigned char frames_completed_message[9];
+	netutils::insert_uint32_into_message(5, frames_completed_message);
+	frames_completed_message[4] = protocol::FRAMES_COMPLETED_MESSAGE;
+
+	std::vector<unsigned char> progress_message;
+	bool progress_reporting_enabled = progress_frames > 0 || progress_ms > 0;
+
+	//Phase timings accumulated since the last progress record
+	FrameTimings progress_timings;
+	uint64_t last_progress_ns = FrameTimings::get_monotonic_nanoseconds();
+	bool perf_counters_enabled = perf_counters_interval > 0;
+
+	int32_t first_update = update_count;
+#ifdef PROFILE_HOOKS
+	profiling::Counts profile_start = profiling::get_counts();
+	int32_t profile_first_update = update_count;
+#endif
 	bool running = num_updates != 0;
 	while (running) {
 		if (num_updates > 0 && update_count > num_updates) {
 			break;
 		}
+#ifdef PROFILE_HOOKS
+		if (update_count == first_update + PROFILE_WARMUP_FRAMES) {
+			profile_start = profiling::get_counts();
+			profile_first_update = update_count;
+		}
+#endif
 
+		if (elastic_enabled) {
+			poll_master_messages();
+			if (leave_signalled && !leave_requested) {
+				std::vector<unsigned char> message = { protocol::LEAVE_REQUEST_MESSAGE };
+				send_message_to_master(message);
+				leave_requested = true;
+				printf("Leaving at the next reconfiguration\n");
+			}
+		}
+
+		uint64_t phase_start_ns = FrameTimings::get_monotonic_nanoseconds();
+		uint64_t frame_start_ns = phase_start_ns;
+		uint64_t trace_start_ns = trace.start();
+		if (perf_counters_enabled) {
+			perf_counters.start();
+		}
 		map->clear_ghost_strips();
+		trace_start_ns = trace.record(TraceBuffer::CLEAR_GHOST_STRIPS, trace_start_ns, update_count);
+		if (progress_reporting_enabled) {
+			phase_start_ns = progress_timings.record_since(FrameTimings::CLEAR_GHOST_STRIPS, phase_start_ns);
+		}
+		if (perf_counters_enabled) {
+			perf_counters.record(PerfCounters::CLEAR_GHOST_STRIPS);
+		}
 		map->update_robot_positions_and_reset_sensors();
+		trace_start_ns = trace.record(TraceBuffer::UPDATE_POSITIONS, trace_start_ns, update_count);
+		if (progress_reporting_enabled) {
+			phase_start_ns = progress_timings.record_since(FrameTimings::UPDATE_POSITIONS, phase_start_ns);
+		}
+		if (perf_counters_enabled) {
+			perf_counters.record(PerfCounters::UPDATE_POSITIONS);
+		}
+
+		// Frames completed by everyone from worker 1 up to us, as of the previous frame's exchange (worker 1 starts it)
+		if (id == 1 || completed_frames_from_left > (uint32_t) update_count) {
+			completed_frames_to_right = update_count;
+		} else {
+			completed_frames_to_right = completed_frames_from_left;
+		}
 
-		// Wait while peer connections do:
+		if (!progress_reporting_enabled) {
+			phase_start_ns = FrameTimings::get_monotonic_nanoseconds();
+		}
+
+		// Exchange halos via io_uring, or wait while peer connections do:
 		//   (1) Send ghost strips
 		//   (2) Receive ghost strips
 		//   (3) Send robots (transfers)
 		//   (4) Receive robots
-		wait_on_peer_connections();
+		if (halo_exchange != NULL) {
+			set_ring_state_from_left(halo_exchange->exchange_halos(get_ring_state_to_right()));
+		} else {
+			wait_on_peer_connections();
+		}
+		trace_start_ns = trace.record(TraceBuffer::HALO_EXCHANGE, trace_start_ns, update_count);
+		if (perf_counters_enabled) {
+			perf_counters.record(PerfCounters::HALO_EXCHANGE);
+		}
+		if (reconfigure_frame_from_left > reconfigure_frame) {
+			reconfigure_frame = reconfigure_frame_from_left;
+		}
+		//Whatever the exchange did not spend sending & adding halos, it spent waiting on our neighbours
+		uint64_t now_ns = FrameTimings::get_monotonic_nanoseconds();
+		uint64_t halo_exchange_ns = now_ns - phase_start_ns;
+		HaloTimings halo_timings = take_halo_timings();
+		uint64_t halo_work_ns = halo_timings.send_ns + halo_timings.receive_ns;
+		uint64_t peer_wait_ns = halo_exchange_ns > halo_work_ns ? halo_exchange_ns - halo_work_ns : 0;
+		if (progress_reporting_enabled) {
+			progress_timings.record(FrameTimings::HALO_SEND, halo_timings.send_ns);
+			progress_timings.record(FrameTimings::HALO_RECEIVE, halo_timings.receive_ns);
+			progress_timings.record(FrameTimings::HALO_PEER_WAIT, peer_wait_ns);
+		}
+		phase_start_ns = now_ns;
 
 		map->update_robot_sensors();
+		trace_start_ns = trace.record(TraceBuffer::UPDATE_SENSORS, trace_start_ns, update_count);
+		if (progress_reporting_enabled) {
+			phase_start_ns = progress_timings.record_since(FrameTimings::UPDATE_SENSORS, phase_start_ns);
+		}
+		if (perf_counters_enabled) {
+			perf_counters.record(PerfCounters::UPDATE_SENSORS);
+		}
 		map->set_robot_speeds_and_directions();
+		trace.record(TraceBuffer::SET_SPEEDS, trace_start_ns, update_count);
+		if (perf_counters_enabled) {
+			perf_counters.record(PerfCounters::SET_SPEEDS);
+			perf_counters.frame_completed();
+			if ((update_count + 1 - first_update) % perf_counters_interval == 0) {
+				perf_counters.print_interval(update_count);
+			}
+		}
 
 		if (num_updates < 0 || update_count <= num_updates - 1) {
 			//Send frame completed
-			if (visualization_enabled) {
+			if (progress_reporting_enabled) {
+				uint64_t now_ns = progress_timings.record_since(FrameTimings::SET_SPEEDS, phase_start_ns);
+				progress_timings.frame_completed();
+
+				//Report once an interval has passed, and always for the final frame
+				if ((progress_frames > 0 && progress_timings.get_num_frames() >= progress_frames)
+						|| (progress_ms > 0 && now_ns - last_progress_ns >= progress_ms * 1000000ULL)
+						|| update_count == num_updates - 1) {
+					write_progress_message(progress_message, update_count + 1, progress_timings);
+#ifdef NET_DEBUG
+					printf("[NET_DEBUG] Sending 'PROGRESS_MESSAGE' message to master\n");
+#endif
+					protocol::send_message(master_fd, &progress_message[0], progress_message.size(), &master_stats);
+					progress_timings.reset();
+					last_progress_ns = now_ns;
+				}
+			} else if (frame_aggregation_enabled) {
+				//Only the last worker in the ring reports, on behalf of everyone
+				if (id == num_workers) {
+					uint32_t completed_frames = update_count + 1;
+					if (completed_frames_from_left < completed_frames) {
+						completed_frames = completed_frames_from_left;
+					}
+					netutils::insert_uint32_into_message(completed_frames, &frames_completed_message[5]);
+#ifdef NET_DEBUG
+					printf("[NET_DEBUG] Sending 'FRAMES_COMPLETED_MESSAGE' message to master\n");
+#endif
+					protocol::send_message(master_fd, frames_completed_message, 9, &master_stats);
+				}
+			} else if (visualization_enabled && update_count % stats_interval == 0) {
 #ifdef NET_DEBUG
 				printf("[NET_DEBUG] Sending 'FRAME_FINISHED_WITH_STATS_MESSAGE' message to master\n");
 #endif
-				map->send_frame_stats_message(master_fd);
+				map->send_frame_stats_message(master_fd, update_count + 1, get_compute_us(frame_start_ns, peer_wait_ns),
+						stats_pool_size, &master_stats);
 			} else {
 #ifdef NET_DEBUG
 				printf("[NET_DEBUG] Sending 'FRAME_FINISHED_MESSAGE' message to master\n");
 #endif
-				protocol::send_message(master_fd, frame_finished_messaged, 5);
+				netutils::insert_uint32_into_message(get_compute_us(frame_start_ns, peer_wait_ns),
+						&frame_finished_messaged[5]);
+				protocol::send_message(master_fd, frame_finished_messaged, 9, &master_stats);
+			}
+		}
+
+		//Checkpoint every interval frames (the final state is written out anyway)
+		if (checkpoint_interval > 0) {
+			report_checkpoint_written();
+			if ((update_count + 1) % checkpoint_interval == 0 && (num_updates < 0 || update_count < num_updates)) {
+				poll_master_messages();
+				checkpoint(update_count + 1);
+			}
+		}
+
+		//Everyone reconfigures after the same frame, unless the run would have ended by then
+		if (reconfigure_frame == (uint32_t) update_count + 1 && (num_updates < 0 || update_count < num_updates)) {
+			if (!reconfigure()) {
+				return;
 			}
 		}
 		update_count++;
 	}
+#ifdef PROFILE_HOOKS
+	profiling::Counts profile_end = profiling::get_counts();
+#endif
+	if (checkpoint_interval > 0) {
+		checkpoint_writer.wait_until_done();
+		report_checkpoint_written();
+		wait_for_checkpoint_committed();
+	}
+	if (trace.is_enabled()) {
+		send_trace();
+	}
+	if (positions_output_dir.empty()) {
 #ifdef NET_DEBUG
-	printf("[NET_DEBUG] Sending 'FINAL_POSITIONS_MESSAGE' message to master\n");
+		printf("[NET_DEBUG] Sending 'FINAL_POSITIONS_MESSAGE' message to master\n");
 #endif
-	map->send_final_positions_message(master_fd);
+		map->send_final_positions_message(master_fd, &master_stats);
+	} else {
+		write_positions_shard();
+	}
 	printf("Done simulation\n");
+
+	//Halo traffic per frame, over each neighbour link (including the neighbour handshake & any links replaced)
+	uint64_t left_bytes = left_neighbour->get_bytes_received()
+			+ relinked_bytes_received[PeerConnection::LEFT_PEER_CONNECTION];
+	uint64_t right_bytes = right_neighbour->get_bytes_received()
+			+ relinked_bytes_received[PeerConnection::RIGHT_PEER_CONNECTION];
+	if (halo_exchange != NULL) {
+		left_bytes += halo_exchange->get_bytes_received(PeerConnection::LEFT_PEER_CONNECTION);
+		right_bytes += halo_exchange->get_bytes_received(PeerConnection::RIGHT_PEER_CONNECTION);
+	}
+	uint32_t num_frames = update_count - first_update;
+	if (num_frames > 0) {
+		printf("Halo bytes received per frame: left %.1f, right %.1f (%u frames)\n", (double) left_bytes / num_frames,
+				(double) right_bytes / num_frames, num_frames);
+	}
+	for (int connection = 0; connection < MessageStats::NUM_CONNECTIONS; connection++) {
+		MessageStats snapshot;
+		add_message_stats((MessageStats::Connection) connection, snapshot);
+		printf("Messages exchanged with %s:\n", MessageStats::get_connection_name((MessageStats::Connection) connection));
+		snapshot.print("   ", num_frames);
+	}
+	if (perf_counters_enabled) {
+		perf_counters.print_run();
+	}
+#ifdef PROFILE_HOOKS
+	printf("Allocations & locks over frames %d-%d (after up to %d warm-up frames):\n", profile_first_update,
+			update_count - 1, PROFILE_WARMUP_FRAMES);
+	profiling::print_counts(profile_start, profile_end, update_count - profile_first_update);
+#endif
 	exit(EXIT_SUCCESS);
 }
 
@@ -272,8 +1035,8 @@ void* Worker::listen_for_neighbour(void* arg) {
 	hints.ai_socktype = SOCK_STREAM;
 	hints.ai_flags = AI_PASSIVE;
 
-	//Figure our which port we should be listening at for our neighbour according to our id
-	int listen_port = protocol::BASE_NEIGHBOUR_PORT + worker->id;
+	//The port master assigned us (the base port plus our id at startup)
+	int listen_port = worker->listen_port;
 
 	if (getaddrinfo(NULL, std::to_string(listen_port).c_str(), &hints, &res) != 0) {
 		fprintf(stderr, "[Err] Failed to get address info\n");
@@ -326,8 +1089,9 @@ void* Worker::listen_for_neighbour(void* arg) {
 #endif
 
 	//We are now listening for our neighbour, notify main thread
-	pthread_mutex_lock(&(worker->listening_mutex));
+	profiling::lock(&(worker->listening_mutex), profiling::LISTENING_LOCK);
 	worker->listening = true;
+	worker->listen_fd = listen_fd;
 	pthread_cond_signal(&(worker->listening_for_neighbour));
 	pthread_mutex_unlock(&(worker->listening_mutex));
 
@@ -339,12 +1103,18 @@ void* Worker::listen_for_neighbour(void* arg) {
 		left_neighbour_id = worker->id - 1;
 	}
 
-	//Accepting connections...
-	while (worker->left_neighbour == NULL) {
+	//Accepting connections until one is a neighbour request (peeked at, for the peer connection to handle)
+	while (true) {
 		int new_fd = accept(listen_fd, (sockaddr *) &new_addr, &addr_len);
 		if (new_fd < 0) {
 			continue;
 		}
+		unsigned char header[5];
+		if (recv(new_fd, header, sizeof header, MSG_PEEK | MSG_WAITALL) != sizeof header
+				|| header[4] != protocol::NEIGHBOUR_REQUEST_MESSAGE) {
+			close(new_fd);
+			continue;
+		}
 
 		//Set TCP no delay on socket for performance
 		if (netutils::disable_nagle_algorithm(new_fd) != 0) {
@@ -367,9 +1137,10 @@ void* Worker::listen_for_neighbour(void* arg) {
 			fprintf(stderr, "[Err] Failed to create thread to handle peer connection\n");
 			exit(EXIT_FAILURE);
 		}
+		break;
 	}
-	close(listen_fd);
 
+	//The listen socket is left to the worker, which closes it unless neighbours may change later on (elastic runs)
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Stopped listening for our left neighbour\n");
 #endif
@@ -377,8 +1148,8 @@ void* Worker::listen_for_neighbour(void* arg) {
 	return NULL;
 }
 
-void Worker::connect_to_neighbour(char* ip_address) {
-	int right_fd;
+int Worker::connect_to_worker(const char* ip_address, uint32_t port) {
+	int fd;
 
 	//Load up address structs with getaddrinfo
 	struct addrinfo hints, *res;
@@ -387,21 +1158,11 @@ void Worker::connect_to_neighbour(char* ip_address) {
 	hints.ai_socktype = SOCK_STREAM;
 	hints.ai_flags = AI_PASSIVE;
 
-	//What's the ID/listen port of our right neighbour?
-	int right_neighbour_id;
-	if (id == num_workers) {
-		right_neighbour_id = 1;
-	} else {
-		right_neighbour_id = id + 1;
-	}
-	std::string right_listen_port = std::to_string(protocol::BASE_NEIGHBOUR_PORT + right_neighbour_id);
-
 #ifdef NET_DEBUG
-	printf("[NET_DEBUG] Connecting to our right neighbour '%s'(%d) at port %s\n", ip_address, right_neighbour_id,
-			right_listen_port.c_str());
+	printf("[NET_DEBUG] Connecting to worker '%s' at port %u\n", ip_address, port);
 #endif
 
-	if (getaddrinfo(ip_address, right_listen_port.c_str(), &hints, &res) != 0) {
+	if (getaddrinfo(ip_address, std::to_string(port).c_str(), &hints, &res) != 0) {
 		fprintf(stderr, "[Err] Failed to get address info\n");
 		exit(EXIT_FAILURE);
 	}
@@ -411,12 +1172,12 @@ void Worker::connect_to_neighbour(char* ip_address) {
 	for (p = res; p != NULL; p = p->ai_next) {
 
 		//Get the socket
-		if ((right_fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) {
+		if ((fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) {
 			continue;
 		}
 
-		if (connect(right_fd, p->ai_addr, p->ai_addrlen) == -1) {
-			close(right_fd);
+		if (connect(fd, p->ai_addr, p->ai_addrlen) == -1) {
+			close(fd);
 			continue;
 		}
 
@@ -424,27 +1185,43 @@ void Worker::connect_to_neighbour(char* ip_address) {
 	}
 
 	if (p == NULL) {
-		fprintf(stderr, "[Err] Failed to connect to right neighbour\n");
+		fprintf(stderr, "[Err] Failed to connect to worker '%s' at port %u\n", ip_address, port);
 		exit(EXIT_FAILURE);
 	}
 
 	//Set TCP no delay on socket for performance
-	if (netutils::disable_nagle_algorithm(right_fd) != 0) {
+	if (netutils::disable_nagle_algorithm(fd) != 0) {
 		fprintf(stderr, "[Err] Failed to set TCP_NODELAY flag on socket\n");
 		exit(EXIT_FAILURE);
 	}
 
-	if (netutils::set_bdp(right_fd) != 0) {
+	if (netutils::set_bdp(fd) != 0) {
 		fprintf(stderr, "[Err] Failed to set BDP size on socket\n");
 		exit(EXIT_FAILURE);
 	}
 
+	//All done with this
+	freeaddrinfo(res);
+	return fd;
+}
+
+void Worker::connect_to_neighbour(char* ip_address, uint32_t port) {
+
+	//What's the ID of our right neighbour?
+	int right_neighbour_id;
+	if (id == num_workers) {
+		right_neighbour_id = 1;
+	} else {
+		right_neighbour_id = id + 1;
+	}
+	int right_fd = connect_to_worker(ip_address, port);
+
 	//Send NEIGHBOUR_REQUEST message to start
 #ifdef NET_DEBUG
 	printf("[NET_DEBUG] Sending 'NEIGHBOUR_REQUEST' message to '%s'(%d)\n", ip_address, right_neighbour_id);
 #endif
 	std::vector<unsigned char> request_msg = { protocol::NEIGHBOUR_REQUEST_MESSAGE };
-	protocol::send_message(right_fd, request_msg);
+	protocol::send_message(right_fd, request_msg, NULL);
 
 	pthread_t thread;
 	PeerConnection *pc = new PeerConnection(right_fd, *this, ip_address, right_neighbour_id,
@@ -454,9 +1231,6 @@ void Worker::connect_to_neighbour(char* ip_address) {
 		fprintf(stderr, "[Err] Failed to create thread to handle peer connection\n");
 		exit(EXIT_FAILURE);
 	}
-
-	//All done with this
-	freeaddrinfo(res);
 }
 
 void* Worker::handle_peer_connection(void* pc) {
@@ -469,12 +1243,17 @@ void* Worker::handle_peer_connection(void* pc) {
 	connection->start();
 
 	close(connection->get_fd());
+
+	//Connections replaced by a reconfiguration are no longer referenced by the worker
+	if (connection->is_retired()) {
+		delete connection;
+	}
 	return NULL;
 }
 
 int Worker::set_left_neighbour(PeerConnection& left_neighbour) {
 	int return_value = 0;
-	pthread_mutex_lock(&left_neighbour_mutex);
+	profiling::lock(&left_neighbour_mutex, profiling::LEFT_NEIGHBOUR_LOCK);
 	if (this->left_neighbour == NULL) {
 		this->left_neighbour = &left_neighbour;
 	} else {
@@ -486,7 +1265,7 @@ int Worker::set_left_neighbour(PeerConnection& left_neighbour) {
 
 int Worker::set_right_neighbour(PeerConnection& right_neighbour) {
 	int return_value = 0;
-	pthread_mutex_lock(&right_neighbour_mutex);
+	profiling::lock(&right_neighbour_mutex, profiling::RIGHT_NEIGHBOUR_LOCK);
 	if (this->right_neighbour == NULL) {
 		this->right_neighbour = &right_neighbour;
 	} else {
@@ -496,61 +1275,108 @@ int Worker::set_right_neighbour(PeerConnection& right_neighbour) {
 	return return_value;
 }
 
-void Worker::start_wait_peer_connections() {
+void Worker::wait_on_peer_connections() {
 #ifdef THREAD_DEBUG
-	printf("[THREAD_DEBUG] Worker (%lu): Finished task, signaling peer connections and sleeping...\n", pthread_self());
+	printf("[THREAD_DEBUG] Worker (%lu): Finished task, signaling peer connections and waiting...\n", pthread_self());
 #endif
-	peer_connections_working[0] = true;
-	peer_connections_working[1] = true;
-	num_peer_connections_working = 2;
-	pthread_cond_broadcast(&worker_done);
-	while (num_peer_connections_working > 0) {
-		pthread_cond_wait(&both_peer_connections_done, &synchronization);
-	}
+	peer_barrier.release_and_wait();
 #ifdef THREAD_DEBUG
 	printf("[THREAD_DEBUG] Worker (%lu): Peer connections finished tasks, resuming...\n", pthread_self());
 #endif
-	pthread_mutex_unlock(&synchronization);
-}
-
-void Worker::wait_on_peer_connections() {
-	pthread_mutex_lock(&synchronization);
-	start_wait_peer_connections();
 }
 
 void Worker::wait_on_worker(uint32_t connection_type) {
-
-	pthread_mutex_lock(&synchronization);
-	peer_connections_working[connection_type] = false;
-	num_peer_connections_working--;
-	if (num_peer_connections_working == 0) {
 #ifdef THREAD_DEBUG
-		printf("[THREAD_DEBUG] PeerConnection (%lu): Finished task. Signaling worker and sleeping...\n", pthread_self());
+	printf("[THREAD_DEBUG] PeerConnection (%lu): Finished task, signaling worker and waiting...\n", pthread_self());
 #endif
-		pthread_cond_signal(&both_peer_connections_done);
-	} else {
+	peer_barrier.arrive_and_wait(peer_connection_arrivals[connection_type]);
 #ifdef THREAD_DEBUG
-		printf("[THREAD_DEBUG] PeerConnection (%lu): Finished task, sleeping...\n", pthread_self());
+	printf("[THREAD_DEBUG] PeerConnection (%lu): Worker finished task, resuming...\n", pthread_self());
 #endif
-	}
-	while (!peer_connections_working[connection_type]) {
-		pthread_cond_wait(&worker_done, &synchronization);
-	}
-#ifdef THREAD_DEBUG
-	printf("[THREAD_DEBUG] WorkerConnection (%lu): Worker finished task, resuming...\n", pthread_self());
-#endif
-	pthread_mutex_unlock(&synchronization);
 }
 
-void Worker::get_and_release_lock() {
-	pthread_mutex_lock(&synchronization);
-	pthread_mutex_unlock(&synchronization);
+void Worker::wait_to_rejoin(uint32_t connection_type) {
+	peer_barrier.wait_for_release(peer_connection_arrivals[connection_type]);
+}
+
+void Worker::wait_until_started() {
+	peer_barrier.wait_until_started();
 }
 
 uint32_t Worker::get_num_blocks() {
 	return num_blocks;
 }
 
+uint32_t Worker::get_compute_us(uint64_t frame_start_ns, uint64_t peer_wait_ns) {
+	uint64_t frame_ns = FrameTimings::get_monotonic_nanoseconds() - frame_start_ns;
+	return frame_ns > peer_wait_ns ? (frame_ns - peer_wait_ns) / 1000 : 0;
+}
+
+HaloTimings Worker::take_halo_timings() {
+	if (halo_exchange != NULL) {
+		return halo_exchange->get_timings();
+	}
+
+	//The peer connections exchange with each neighbour concurrently, the busier one holds up the exchange
+	HaloTimings left_timings = left_neighbour->take_timings();
+	HaloTimings right_timings = right_neighbour->take_timings();
+	if (left_timings.send_ns + left_timings.receive_ns >= right_timings.send_ns + right_timings.receive_ns) {
+		return left_timings;
+	}
+	return right_timings;
+}
+
+void Worker::add_message_stats(MessageStats::Connection connection, MessageStats &snapshot) {
+	if (connection == MessageStats::MASTER_CONNECTION) {
+		snapshot.add(master_stats);
+		return;
+	}
+	uint32_t connection_type = connection == MessageStats::LEFT_CONNECTION ?
+			PeerConnection::LEFT_PEER_CONNECTION : PeerConnection::RIGHT_PEER_CONNECTION;
+	snapshot.add(connection == MessageStats::LEFT_CONNECTION ? left_neighbour->get_stats() : right_neighbour->get_stats());
+	snapshot.add(relinked_stats[connection_type]);
+	if (halo_exchange != NULL) {
+		snapshot.add(halo_exchange->get_stats(connection_type));
+	}
+}
+
+void Worker::write_progress_message(std::vector<unsigned char> &message, uint32_t completed_frames,
+		const FrameTimings &timings) {
+	MessageStats snapshots[MessageStats::NUM_CONNECTIONS];
+	uint32_t message_size = 17 + FrameTimings::SERIALIZED_LENGTH;
+	for (int connection = 0; connection < MessageStats::NUM_CONNECTIONS; connection++) {
+		add_message_stats((MessageStats::Connection) connection, snapshots[connection]);
+		message_size += 4 + snapshots[connection].get_serialized_length();
+	}
+
+	message.resize(message_size);
+	netutils::insert_uint32_into_message(message_size - 4, &message[0]);
+	message[4] = protocol::PROGRESS_MESSAGE;
+	netutils::insert_uint32_into_message(completed_frames, &message[5]);
+	netutils::insert_uint32_into_message(map->count_robots(), &message[9]);
+	timings.serialize(&message[13]);
+	uint32_t index = 13 + FrameTimings::SERIALIZED_LENGTH;
+	netutils::insert_uint32_into_message(MessageStats::NUM_CONNECTIONS, &message[index]);
+	index += 4;
+	for (int connection = 0; connection < MessageStats::NUM_CONNECTIONS; connection++) {
+		netutils::insert_uint32_into_message(connection, &message[index]);
+		index += 4;
+		index += snapshots[connection].serialize(&message[index]);
+	}
+}
+
+RingState Worker::get_ring_state_to_right() {
+	RingState ring_state;
+	ring_state.completed_frames = completed_frames_to_right;
+	ring_state.reconfigure_frame = reconfigure_frame;
+	return ring_state;
+}
+
+void Worker::set_ring_state_from_left(const RingState &ring_state) {
+	completed_frames_from_left = ring_state.completed_frames;
+	reconfigure_frame_from_left = ring_state.reconfigure_frame;
+}
+
 RobotMap& Worker::get_map() {
 	return *map;
 }
@@ -3,10 +3,18 @@
 
 #include <inttypes.h>
 #include <pthread.h>
+#include <signal.h>
+#include <string>
 
 #include "peer_connection.h"
 
 #include "robot_map.h"
+#include "phase_barrier.h"
+#include "uring_halo_exchange.h"
+#include "checkpoint_writer.h"
+#include "trace_buffer.h"
+#include "message_stats.h"
+#include "perf_counters.h"
 
 //Forward declaration
 class PeerConnection;
@@ -15,6 +23,12 @@ class Worker {
 
 	private:
 
+		//Round trips to master sampled to find the clock offset (tracing runs)
+		static const uint32_t CLOCK_SYNC_SAMPLES = 16;
+
+		//Frames left out of allocation & lock counts, while buffers grow to their steady state (profiling builds)
+		static const int32_t PROFILE_WARMUP_FRAMES = 10;
+
 		//Socket connection to master
 		int master_fd;
 
@@ -25,15 +39,20 @@ class Worker {
 		uint32_t id;
 		uint32_t num_workers;
 
+		//Our slice: the block columns we own (the first & how many, workers joining or leaving resize them)
+		uint32_t first_column;
+		uint32_t num_columns;
+
 		// Our data structures for robots
 		RobotMap *map;
 
-		//Mutexes, conditions, and variables for synchronization of work/wait between worker and peer connections
-		pthread_mutex_t synchronization;
-		pthread_cond_t worker_done;
-		pthread_cond_t both_peer_connections_done;
-		unsigned int num_peer_connections_working;
-		bool peer_connections_working[2];
+		//io_uring halo exchange. When set, the peer connection threads stay parked after the neighbour handshake
+		//(NULL: the peer connection threads exchange halos over sockets)
+		UringHaloExchange *halo_exchange;
+
+		//Barrier & per peer connection arrival counts for synchronizing work/wait between worker and peer connections
+		PhaseBarrier peer_barrier;
+		uint32_t peer_connection_arrivals[2];
 
 		//Number of updates to perform (-1: No limit)
 		int32_t num_updates;
@@ -43,44 +62,179 @@ class Worker {
 		uint32_t num_blocks;
 		uint32_t block_size;
 
-		//Is visualization enabled?
+		//Is visualization enabled? Stats pool k x k blocks & are sent every N frames
 		bool visualization_enabled;
-
-		//Are we currently listening for our left neighbour?
+		uint32_t stats_pool_size;
+		uint32_t stats_interval;
+
+		//Is frame completion aggregated along the ring? Counts of frames completed by all workers from worker 1 up to
+		//our left neighbour (as received) and up to us (as sent on to our right neighbour)
+		bool frame_aggregation_enabled;
+		uint32_t completed_frames_from_left;
+		uint32_t completed_frames_to_right;
+
+		//Progress reporting intervals in frames & milliseconds (both 0: FRAME_FINISHED every frame)
+		uint32_t progress_frames;
+		uint32_t progress_ms;
+
+		//Hardware performance counters of our phases, printed every N frames (0: not sampled)
+		PerfCounters perf_counters;
+		uint32_t perf_counters_interval;
+
+		//Directory to write our final positions shard to (empty: send final positions to master)
+		std::string positions_output_dir;
+
+		//Checkpoint our robots every N frames (0: no checkpoints) to the directory, written in the background from a
+		//reused snapshot buffer
+		uint32_t checkpoint_interval;
+		std::string checkpoint_dir;
+		CheckpointWriter checkpoint_writer;
+		std::vector<unsigned char> checkpoint_snapshot;
+
+		//Our checkpoints not yet removed (oldest first) as the frame & the id each was written under, and the frame of
+		//the latest checkpoint master has committed to its manifest (0: none)
+		std::vector<std::pair<uint32_t, uint32_t>> checkpoint_shards;
+		uint32_t committed_checkpoint_frame;
+
+		//Can workers join or leave during the run? The frame after which the ring is reconfigured (0: none yet), as
+		//learnt from master (worker 1) or from our left neighbour, & our part of it (RECONFIGURE message, empty until
+		//master has sent it)
+		bool elastic_enabled;
+		uint32_t reconfigure_frame;
+		uint32_t reconfigure_frame_from_left;
+		std::vector<unsigned char> reconfiguration;
+
+		//Have we been asked to leave (SIGTERM, elastic runs only) & have we told master?
+		static volatile sig_atomic_t leave_signalled;
+		bool leave_requested;
+
+		//Are we currently listening for our left neighbour? (& the listen socket on the port master assigned us, kept
+		//open for later neighbours in elastic runs, -1 once closed)
 		bool listening;
+		int listen_fd;
+		uint32_t listen_port;
 		pthread_mutex_t listening_mutex;
 		pthread_cond_t listening_for_neighbour;
 
+		//Trace events of the worker thread (tracing runs) & the offset from our monotonic clock to master's
+		TraceBuffer trace;
+		int64_t clock_offset_ns;
+
+		//Messages exchanged with master
+		MessageStats master_stats;
+
 		//Peer connections
 		PeerConnection *left_neighbour;
 		PeerConnection *right_neighbour;
 		pthread_mutex_t left_neighbour_mutex;
 		pthread_mutex_t right_neighbour_mutex;
 
+		//Messages exchanged & bytes received over the peer connections replaced during the run (by connection type)
+		MessageStats relinked_stats[2];
+		uint64_t relinked_bytes_received[2];
+
 		// Sends a message to master
 		void send_message_to_master(std::vector<unsigned char> &message);
 
 		// Receives a message to master after validating
 		void recieve_message_from_master(std::vector<unsigned char> &message, unsigned char expected_message_type);
 
+		// Validates a message received from master
+		void verify_message_from_master(std::vector<unsigned char> &message, unsigned char expected_message_type);
+
+		// Generates every robot of the population from the seed and adds those within our slice
+		void generate_robots(uint32_t population_size, uint32_t seed);
+
+		// Maps the (shared) population file and adds the robots within our slice
+		void load_robots(const char *path);
+
+		// Snapshots our robots after the given number of frames & hands the snapshot to the checkpoint writer
+		void checkpoint(uint32_t frame);
+
+		// Tells master about the last checkpoint written in the background (if any since)
+		void report_checkpoint_written();
+
+		// Takes the messages master sent during the simulation (if any) without waiting for them
+		void poll_master_messages();
+
+		// Handles a message master sent during the simulation: RECONFIGURE (kept until the reconfiguration frame, worker
+		// 1 picks the frame) or CHECKPOINT_COMMITTED (removes our checkpoints it replaced)
+		void handle_master_message(std::vector<unsigned char> &message);
+
+		// Waits until master has committed our latest checkpoint & the checkpoint it replaced has been removed
+		void wait_for_checkpoint_committed();
+
+		// Applies our part of the reconfiguration after its frame: hands over or takes block columns, replaces the links
+		// to neighbours that change & takes on our new id. Returns false if we have left the ring
+		bool reconfigure();
+
+		// Accepts the connections of the reconfiguration on our listen socket: a new left neighbour (of the id given) &
+		// (or) a leaving neighbour handing us its columns
+		void accept_peers(bool accept_left, bool accept_columns, uint32_t left_neighbour_id);
+
+		// Sends the robots of our columns from the first column given on (all of them or those right of our new last
+		// column) in a COLUMN_TRANSFER message & drops the columns from our map
+		void send_columns(int fd, uint32_t first_transferred_column);
+
+		// Adds the columns & robots of a received COLUMN_TRANSFER message (starting at the message type) to our map
+		void take_columns(std::vector<unsigned char> &message);
+
+		// Replaces our connection to a neighbour by a new one to the worker at the ip address (the neighbour handshake
+		// done), between frames
+		void replace_neighbour(uint32_t connection_type, int fd, char* ip_address, uint32_t neighbour_id);
+
+		// Samples the offset from our clock to master's (tracing runs)
+		void synchronize_clock();
+
+		// Sends master the trace events of our threads, on master's clock (tracing runs)
+		void send_trace();
+
+		// SIGTERM handler (elastic runs)
+		static void handle_leave_signal(int signum);
+
+		// Writes our final positions to a shard in the output directory & tells master how many robots it holds
+		void write_positions_shard();
+
+		// Is a position within our slice? (The last slice also holds positions equal to the world size)
+		bool is_within_slice(int32_t x_position);
+
+		// Our slice's x positions from & up to (excluding)
+		int32_t get_slice_start();
+		int32_t get_slice_end();
+
 		//Thread routine for listening for right neighbour connection
 		static void* listen_for_neighbour(void* worker);
 
 		//Thread routine for handling peer connection
 		static void* handle_peer_connection(void* pc);
 
-		//Signals the peer connections to do work while we wait (this is called only the first time)
-		void start_wait_peer_connections();
-
 		//Signals the peer connections to do work while we wait
 		void wait_on_peer_connections();
 
-		//Connects to our right neighbour at the specified ip
-		void connect_to_neighbour(char* ip_address);
+		//Connects to a worker's listen port. Returns the socket
+		int connect_to_worker(const char* ip_address, uint32_t port);
+
+		//Connects to our right neighbour at the specified ip & listen port
+		void connect_to_neighbour(char* ip_address, uint32_t port);
 
 		// Runs the main simulation loop
 		void simulation_loop();
 
+		// Time spent sending & adding halos during the last exchange (by the busier peer connection when not using
+		// io_uring), resetting the peer connections' timings
+		HaloTimings take_halo_timings();
+
+		// Time the current frame has taken so far apart from waiting on our neighbours (microseconds)
+		uint32_t get_compute_us(uint64_t frame_start_ns, uint64_t peer_wait_ns);
+
+		// Adds the messages exchanged so far over one of our connections to the snapshot (by either backend for our
+		// neighbours)
+		void add_message_stats(MessageStats::Connection connection, MessageStats &snapshot);
+
+		// Writes a PROGRESS record for the frames completed into the message (length header included)
+		void write_progress_message(std::vector<unsigned char> &message, uint32_t completed_frames,
+				const FrameTimings &timings);
+
 	public:
 
 		Worker(std::string& master_location);
@@ -90,18 +244,25 @@ class Worker {
 		int set_right_neighbour(PeerConnection& right_neighbour);
 
 		//Initiates the "join" procedure to master. This puts the worker to work indefinitely or until the update limit
-		//is reached (if applicable)
+		//is reached (if applicable), or returns once the worker has left the ring (elastic runs)
 		void join();
 
 		// Signals the worker thread to do work while calling routine (peer connection) waits
 		void wait_on_worker(uint32_t connection_type);
 
-		// Quick lock & release for synchronization b/w worker and peer connections. Peer connections should be created
-		// with worker already having ownership of the lock
-		void get_and_release_lock();
+		// Waits until the worker first signals the peer connections (after connecting to its right neighbour)
+		void wait_until_started();
+
+		// Waits until the worker signals the peer connections into its next frame, for a connection taking over from the
+		// previous one of its type (which is signalled along with it)
+		void wait_to_rejoin(uint32_t connection_type);
 
 		uint32_t get_num_blocks();
 
+		// Ring state carried by ghost strips (see FRAMES_COMPLETED_MESSAGE & RECONFIGURE_MESSAGE)
+		RingState get_ring_state_to_right();
+		void set_ring_state_from_left(const RingState &ring_state);
+
 		RobotMap& get_map();
 };
 